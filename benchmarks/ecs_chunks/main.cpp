@@ -0,0 +1,205 @@
+#include "runtime/ecs/ecs.h"
+
+#include "core/system/simulation.h"
+#include "core/system/task_system.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+namespace
+{
+struct body_component : runtime::component_impl<body_component>
+{
+	float position[3] = {0.0f, 0.0f, 0.0f};
+	float velocity[3] = {0.0f, 0.0f, 0.0f};
+};
+
+struct drag_component : runtime::component_impl<drag_component>
+{
+	float coefficient = 0.0f;
+};
+
+// The same data as chunk components.
+struct body_chunk_component : runtime::chunk_component<body_chunk_component>
+{
+	float position[3] = {0.0f, 0.0f, 0.0f};
+	float velocity[3] = {0.0f, 0.0f, 0.0f};
+};
+
+struct drag_chunk_component : runtime::chunk_component<drag_chunk_component>
+{
+	float coefficient = 0.0f;
+};
+
+/// simulated steps per measurement
+constexpr int steps = 10;
+/// repetitions of every measurement, the best one is kept
+constexpr int repeats = 5;
+
+float drag_coefficient(std::uint32_t index)
+{
+	return 0.01f * float(index % 7);
+}
+
+template <typename Body>
+void reset(Body& body, std::uint32_t index)
+{
+	for(int axis = 0; axis < 3; ++axis)
+	{
+		body.position[axis] = float(index % 97) * 0.25f * float(axis + 1);
+		body.velocity[axis] = float(index % 13) - 6.0f;
+	}
+}
+
+template <typename Body, typename Drag>
+void integrate(Body& body, const Drag& drag)
+{
+	constexpr float dt = 1.0f / 60.0f;
+	for(int axis = 0; axis < 3; ++axis)
+	{
+		const float speed = body.velocity[axis];
+		body.velocity[axis] -= drag.coefficient * speed * std::sqrt(std::abs(speed)) * dt;
+		body.position[axis] += body.velocity[axis] * dt;
+	}
+}
+
+void integrate_chunk(const runtime::chunk_view& chunk, body_chunk_component* bodies,
+					 drag_chunk_component* drags)
+{
+	for(std::size_t i = 0; i < chunk.size(); ++i)
+		integrate(bodies[i], drags[i]);
+}
+
+template <typename F>
+double measure(F&& fn)
+{
+	double best = 0.0;
+	for(int i = 0; i < repeats; ++i)
+	{
+		const auto begin = std::chrono::steady_clock::now();
+		fn();
+		const auto end = std::chrono::steady_clock::now();
+		const double ms = std::chrono::duration<double, std::milli>(end - begin).count();
+		best = (i == 0) ? ms : std::min(best, ms);
+	}
+	return best;
+}
+
+//-----------------------------------------------------------------------------
+//  Name : run_scene ()
+/// <summary>
+/// Creates a scene of count bodies, every second one with drag, once with
+/// regular components and once with chunk components. Times the same steps
+/// with each, for_each_chunk and par_for_each_chunk. Returns false when they
+/// disagree on any body.
+/// </summary>
+//-----------------------------------------------------------------------------
+bool run_scene(runtime::entity_component_system& ecs, std::size_t count)
+{
+	std::vector<runtime::entity> entities;
+	ecs.create_many(count, entities);
+	for(auto& e : entities)
+	{
+		e.assign<body_component>();
+		e.assign<body_chunk_component>();
+		if(e.id().index() % 2 == 0)
+		{
+			e.assign<drag_component>().lock()->coefficient = drag_coefficient(e.id().index());
+			e.assign<drag_chunk_component>()->coefficient = drag_coefficient(e.id().index());
+		}
+	}
+
+	// Positions by entity index, so that the iteration order does not matter.
+	auto positions = [&ecs](std::vector<float>& out) {
+		out.assign(ecs.capacity() * 3, 0.0f);
+		ecs.for_each_chunk<body_chunk_component>(
+			[&out](const runtime::chunk_view& chunk, body_chunk_component* bodies) {
+				for(std::size_t i = 0; i < chunk.size(); ++i)
+					std::copy(bodies[i].position, bodies[i].position + 3, &out[chunk.indices()[i] * 3]);
+			});
+	};
+	auto reset_chunks = [&ecs]() {
+		ecs.for_each_chunk<body_chunk_component>(
+			[](const runtime::chunk_view& chunk, body_chunk_component* bodies) {
+				for(std::size_t i = 0; i < chunk.size(); ++i)
+					reset(bodies[i], chunk.indices()[i]);
+			});
+	};
+
+	std::vector<float> each_positions;
+	const double each_ms = measure([&]() {
+		ecs.each<body_component>(
+			[](runtime::entity e, body_component& body) { reset(body, e.id().index()); });
+		for(int step = 0; step < steps; ++step)
+			ecs.each<body_component, drag_component>(
+				[](runtime::entity, body_component& body, drag_component& drag) { integrate(body, drag); });
+	});
+	each_positions.assign(ecs.capacity() * 3, 0.0f);
+	ecs.each<body_component>([&each_positions](runtime::entity e, body_component& body) {
+		std::copy(body.position, body.position + 3, &each_positions[e.id().index() * 3]);
+	});
+
+	std::vector<float> chunk_positions;
+	const double chunk_ms = measure([&]() {
+		reset_chunks();
+		for(int step = 0; step < steps; ++step)
+			ecs.for_each_chunk<body_chunk_component, drag_chunk_component>(integrate_chunk);
+	});
+	positions(chunk_positions);
+
+	std::vector<float> parallel_positions;
+	const double parallel_ms = measure([&]() {
+		reset_chunks();
+		for(int step = 0; step < steps; ++step)
+			ecs.par_for_each_chunk<body_chunk_component, drag_chunk_component>(integrate_chunk);
+	});
+	positions(parallel_positions);
+
+	std::printf("%8zu entities  each %8.2f ms  for_each_chunk %8.2f ms  par_for_each_chunk %8.2f ms\n", count,
+				each_ms, chunk_ms, parallel_ms);
+
+	std::vector<runtime::entity::id_t> ids;
+	for(auto& e : entities)
+		ids.push_back(e.id());
+	ecs.destroy_many(ids);
+
+	return each_positions == chunk_positions && chunk_positions == parallel_positions;
+}
+}
+
+//-----------------------------------------------------------------------------
+// Usage: ecs_chunks_benchmark [threads]
+// The task system uses all hardware threads unless a count is given.
+//-----------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+	std::size_t threads = std::thread::hardware_concurrency();
+	if(argc > 1)
+		threads = std::size_t(std::max(1, std::atoi(argv[1])));
+
+	core::details::initialize();
+	core::add_subsystem<core::simulation>();
+	core::add_subsystem<core::task_system>(threads);
+	auto& ecs = core::add_subsystem<runtime::entity_component_system>();
+
+	std::printf("threads %zu\n", threads);
+
+	bool valid = true;
+	for(std::size_t count : {10000, 100000})
+		valid &= run_scene(ecs, count);
+
+	core::details::dispose();
+
+	if(!valid)
+	{
+		std::printf("error: chunk iteration results differ from each\n");
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,156 @@
+#include "runtime/ecs/ecs.h"
+
+#include "core/system/simulation.h"
+#include "core/system/task_system.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+namespace
+{
+struct body_component : runtime::component_impl<body_component>
+{
+	float position[3] = {0.0f, 0.0f, 0.0f};
+	float velocity[3] = {0.0f, 0.0f, 0.0f};
+};
+
+struct drag_component : runtime::component_impl<drag_component>
+{
+	float coefficient = 0.0f;
+};
+
+/// simulated steps per measurement
+constexpr int steps = 10;
+/// repetitions of every measurement, the best one is kept
+constexpr int repeats = 5;
+
+void reset(body_component& body, std::uint32_t index)
+{
+	for(int axis = 0; axis < 3; ++axis)
+	{
+		body.position[axis] = float(index % 97) * 0.25f * float(axis + 1);
+		body.velocity[axis] = float(index % 13) - 6.0f;
+	}
+}
+
+void integrate(body_component& body, const drag_component& drag)
+{
+	constexpr float dt = 1.0f / 60.0f;
+	for(int axis = 0; axis < 3; ++axis)
+	{
+		const float speed = body.velocity[axis];
+		body.velocity[axis] -= drag.coefficient * speed * std::sqrt(std::abs(speed)) * dt;
+		body.position[axis] += body.velocity[axis] * dt;
+	}
+}
+
+template <typename F>
+double measure(F&& fn)
+{
+	double best = 0.0;
+	for(int i = 0; i < repeats; ++i)
+	{
+		const auto begin = std::chrono::steady_clock::now();
+		fn();
+		const auto end = std::chrono::steady_clock::now();
+		const double ms = std::chrono::duration<double, std::milli>(end - begin).count();
+		best = (i == 0) ? ms : std::min(best, ms);
+	}
+	return best;
+}
+
+//-----------------------------------------------------------------------------
+//  Name : run_scene ()
+/// <summary>
+/// Creates a scene of count bodies, every second one with drag, and times the
+/// same steps with each and with par_for_each. Returns false when the two
+/// disagree on any body.
+/// </summary>
+//-----------------------------------------------------------------------------
+bool run_scene(runtime::entity_component_system& ecs, std::size_t count)
+{
+	std::vector<runtime::entity> entities;
+	ecs.create_many(count, entities);
+	for(auto& e : entities)
+	{
+		e.assign<body_component>();
+		if(e.id().index() % 2 == 0)
+			e.assign<drag_component>().lock()->coefficient = 0.01f * float(e.id().index() % 7);
+	}
+
+	auto reset_all = [&ecs]() {
+		ecs.each<body_component>(
+			[](runtime::entity e, body_component& body) { reset(body, e.id().index()); });
+	};
+
+	std::vector<float> serial_positions;
+	const double serial_ms = measure([&]() {
+		reset_all();
+		for(int step = 0; step < steps; ++step)
+			ecs.each<body_component, drag_component>(
+				[](runtime::entity, body_component& body, drag_component& drag) { integrate(body, drag); });
+	});
+	ecs.each<body_component>([&serial_positions](runtime::entity, body_component& body) {
+		serial_positions.insert(serial_positions.end(), body.position, body.position + 3);
+	});
+
+	std::vector<float> parallel_positions;
+	const double parallel_ms = measure([&]() {
+		reset_all();
+		for(int step = 0; step < steps; ++step)
+			ecs.par_for_each<body_component, drag_component>(
+				[](runtime::entity, body_component& body, drag_component& drag) { integrate(body, drag); });
+	});
+	ecs.each<body_component>([&parallel_positions](runtime::entity, body_component& body) {
+		parallel_positions.insert(parallel_positions.end(), body.position, body.position + 3);
+	});
+
+	std::printf("%8zu entities  each %8.2f ms  par_for_each %8.2f ms  speedup %.2fx\n", count, serial_ms,
+				parallel_ms, serial_ms / parallel_ms);
+
+	std::vector<runtime::entity::id_t> ids;
+	for(auto& e : entities)
+		ids.push_back(e.id());
+	ecs.destroy_many(ids);
+
+	return serial_positions == parallel_positions;
+}
+}
+
+//-----------------------------------------------------------------------------
+// Usage: ecs_par_for_each_benchmark [threads]
+// The task system uses all hardware threads unless a count is given, run it
+// once per count to see the scaling.
+//-----------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+	std::size_t threads = std::thread::hardware_concurrency();
+	if(argc > 1)
+		threads = std::size_t(std::max(1, std::atoi(argv[1])));
+
+	core::details::initialize();
+	core::add_subsystem<core::simulation>();
+	core::add_subsystem<core::task_system>(threads);
+	auto& ecs = core::add_subsystem<runtime::entity_component_system>();
+
+	std::printf("threads %zu\n", threads);
+
+	bool valid = true;
+	for(std::size_t count : {10000, 100000})
+		valid &= run_scene(ecs, count);
+
+	core::details::dispose();
+
+	if(!valid)
+	{
+		std::printf("error: par_for_each results differ from each\n");
+		return 1;
+	}
+
+	return 0;
+}
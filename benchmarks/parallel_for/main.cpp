@@ -0,0 +1,107 @@
+#include "core/system/parallel.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+namespace
+{
+/// elements of the flat loops
+constexpr std::size_t element_count = 4000000;
+/// outer and inner iterations of the nested loop
+constexpr std::size_t nested_count = 2000;
+/// repetitions of every measurement, the best one is kept
+constexpr int repeats = 5;
+
+float work(std::size_t i)
+{
+	return std::sqrt(float(i)) * std::sin(float(i));
+}
+
+template <typename F>
+double measure(F&& fn)
+{
+	double best = 0.0;
+	for(int i = 0; i < repeats; ++i)
+	{
+		const auto begin = std::chrono::steady_clock::now();
+		fn();
+		const auto end = std::chrono::steady_clock::now();
+		const double ms = std::chrono::duration<double, std::milli>(end - begin).count();
+		best = (i == 0) ? ms : std::min(best, ms);
+	}
+	return best;
+}
+}
+
+int main()
+{
+	const std::size_t max_threads = std::max<std::size_t>(4, std::thread::hardware_concurrency());
+
+	std::vector<float> reference(element_count);
+	const double serial_for_ms = measure([&reference]() {
+		for(std::size_t i = 0; i < element_count; ++i)
+			reference[i] = work(i);
+	});
+
+	std::uint64_t reference_sum = 0;
+	const double serial_reduce_ms = measure([&reference_sum]() {
+		reference_sum = 0;
+		for(std::size_t i = 0; i < element_count; ++i)
+			reference_sum += std::uint64_t(std::sqrt(double(i)));
+	});
+
+	std::vector<float> nested_reference(nested_count * nested_count);
+	for(std::size_t i = 0; i < nested_reference.size(); ++i)
+		nested_reference[i] = work(i);
+
+	std::printf("%-8s %12s %12s %12s\n", "threads", "for ms", "reduce ms", "nested ms");
+	std::printf("%-8s %12.2f %12.2f %12s\n", "serial", serial_for_ms, serial_reduce_ms, "-");
+
+	bool valid = true;
+	for(std::size_t threads = 1; threads <= max_threads; threads *= 2)
+	{
+		core::task_system ts(threads);
+
+		std::vector<float> values(element_count);
+		const double for_ms = measure([&ts, &values]() {
+			core::parallel_for(ts, 0, element_count, 0, [&values](std::size_t i) { values[i] = work(i); });
+		});
+		valid &= values == reference;
+
+		std::uint64_t sum = 0;
+		const double reduce_ms = measure([&ts, &sum]() {
+			sum = core::parallel_reduce(ts, 0, element_count, 0, std::uint64_t(0),
+										[](std::size_t i) { return std::uint64_t(std::sqrt(double(i))); },
+										[](std::uint64_t lhs, std::uint64_t rhs) { return lhs + rhs; });
+		});
+		valid &= sum == reference_sum;
+
+		// The inner loops are joined from worker threads, which keep running
+		// tasks while they wait.
+		std::vector<float> nested(nested_count * nested_count);
+		const double nested_ms = measure([&ts, &nested]() {
+			core::parallel_for(ts, 0, nested_count, 1, [&ts, &nested](std::size_t i) {
+				core::parallel_for(ts, 0, nested_count, 0, [&nested, i](std::size_t j) {
+					const auto idx = i * nested_count + j;
+					nested[idx] = work(idx);
+				});
+			});
+		});
+		valid &= nested == nested_reference;
+
+		std::printf("%-8zu %12.2f %12.2f %12.2f\n", threads, for_ms, reduce_ms, nested_ms);
+	}
+
+	if(!valid)
+	{
+		std::printf("error: the parallel results differ from the serial ones\n");
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,142 @@
+#include "runtime/ecs/components/transform_component.h"
+#include "runtime/ecs/system_scheduler.h"
+#include "runtime/ecs/systems/scene_graph.h"
+#include "runtime/system/events.h"
+
+#include "core/system/simulation.h"
+#include "core/system/task_system.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace
+{
+/// characters in the scene
+constexpr std::size_t character_count = 2000;
+/// transforms per character, parented randomly below its root
+constexpr std::size_t bone_count = 50;
+/// measured frames per case
+constexpr int frames = 20;
+
+math::vec3 offset(std::size_t seed)
+{
+	return math::vec3(float(seed % 13) * 0.5f, float(seed % 7) * 0.25f, float(seed % 5));
+}
+
+//-----------------------------------------------------------------------------
+//  Name : is_resolved ()
+/// <summary>
+/// Compares every world transform with the one computed serially from the
+/// local transforms, parents first. The results must be identical whatever
+/// the number of threads and whichever nodes were skipped.
+/// </summary>
+//-----------------------------------------------------------------------------
+bool is_resolved(runtime::scene_graph& graph, std::vector<math::transform>& expected)
+{
+	const auto& nodes = graph.get_nodes();
+	const auto& parents = graph.get_parents();
+
+	expected.resize(nodes.size());
+	for(std::size_t i = 0; i < nodes.size(); ++i)
+	{
+		auto transform_comp = nodes[i].get_component<transform_component>().lock();
+		const auto& local = transform_comp->get_local_transform();
+		expected[i] = parents[i] == runtime::scene_graph::npos ? local : expected[parents[i]] * local;
+
+		if(transform_comp->get_transform() != expected[i])
+		{
+			std::printf("error: node %zu differs from the serial result\n", i);
+			return false;
+		}
+	}
+	return true;
+}
+}
+
+//-----------------------------------------------------------------------------
+// Usage: scene_graph_benchmark [threads]
+// The task system uses all hardware threads unless a count is given, run it
+// once per count to see the scaling.
+//-----------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+	std::size_t threads = std::thread::hardware_concurrency();
+	if(argc > 1)
+		threads = std::size_t(std::max(1, std::atoi(argv[1])));
+
+	core::details::initialize();
+	core::add_subsystem<core::simulation>();
+	core::add_subsystem<core::task_system>(threads);
+	auto& ecs = core::add_subsystem<runtime::entity_component_system>();
+	core::add_subsystem<runtime::system_scheduler>();
+	auto& graph = core::add_subsystem<runtime::scene_graph>();
+
+	std::mt19937 rng(7);
+	std::vector<runtime::entity> roots;
+	std::vector<runtime::entity> entities;
+	for(std::size_t c = 0; c < character_count; ++c)
+	{
+		std::vector<runtime::entity> bones;
+		ecs.create_many(bone_count, bones);
+		for(std::size_t b = 0; b < bones.size(); ++b)
+		{
+			auto transform_comp = bones[b].assign<transform_component>().lock();
+			transform_comp->set_local_position(offset(rng()));
+			if(b > 0)
+				transform_comp->set_parent(bones[rng() % b]);
+		}
+		roots.push_back(bones.front());
+		entities.insert(entities.end(), bones.begin(), bones.end());
+	}
+
+	const std::chrono::duration<float> dt(1.0f / 60.0f);
+	auto step = [&graph, dt]() {
+		const auto begin = std::chrono::steady_clock::now();
+		graph.frame_update(dt);
+		const auto end = std::chrono::steady_clock::now();
+		runtime::on_frame_end(dt);
+		return std::chrono::duration<double, std::milli>(end - begin).count();
+	};
+
+	std::vector<math::transform> expected;
+	const double rebuild_ms = step();
+	bool valid = is_resolved(graph, expected);
+
+	// Every root moves, so the whole scene is resolved.
+	double all_ms = 0.0;
+	for(int frame = 0; frame < frames && valid; ++frame)
+	{
+		for(auto& root : roots)
+			root.get_component<transform_component>().lock()->move(offset(rng()));
+		all_ms += step();
+		valid &= is_resolved(graph, expected);
+	}
+
+	// One bone in a hundred moves, only the subtrees below them are resolved.
+	double sparse_ms = 0.0;
+	for(int frame = 0; frame < frames && valid; ++frame)
+	{
+		for(std::size_t i = 0; i < entities.size() / 100; ++i)
+		{
+			auto& e = entities[rng() % entities.size()];
+			e.get_component<transform_component>().lock()->set_local_position(offset(rng()));
+		}
+		sparse_ms += step();
+		valid &= is_resolved(graph, expected);
+	}
+
+	std::printf("threads %zu, %zu nodes in %zu levels\n", threads, graph.get_nodes().size(),
+				graph.get_levels().size() - 1);
+	std::printf("rebuild          %8.3f ms\n", rebuild_ms);
+	std::printf("all moved        %8.3f ms/frame\n", all_ms / frames);
+	std::printf("1%% moved         %8.3f ms/frame\n", sparse_ms / frames);
+
+	core::details::dispose();
+
+	return valid ? 0 : 1;
+}
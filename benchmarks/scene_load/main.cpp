@@ -0,0 +1,133 @@
+#include "runtime/ecs/components/transform_component.h"
+#include "runtime/ecs/utils.h"
+#include "runtime/meta/ecs/components/transform_component.hpp"
+
+#include "core/system/simulation.h"
+
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+namespace
+{
+/// children of the root
+constexpr std::size_t branch_count = 1000;
+/// children of every branch, the scene has 100k entities in all
+constexpr std::size_t leaf_count = 99;
+
+struct created_counter
+{
+	std::size_t single = 0;
+	std::size_t batches = 0;
+	std::size_t batched = 0;
+
+	void created(runtime::entity)
+	{
+		++single;
+	}
+
+	void created_many(const std::vector<runtime::entity>& entities)
+	{
+		++batches;
+		batched += entities.size();
+	}
+};
+
+// Ids of the entity and everything below it, parents first.
+std::vector<runtime::entity::id_t> collect(const runtime::entity& root)
+{
+	std::vector<runtime::entity> entities{root};
+	for(std::size_t i = 0; i < entities.size(); ++i)
+	{
+		auto transform_comp = entities[i].get_component<transform_component>().lock();
+		const auto& children = transform_comp->get_children();
+		entities.insert(entities.end(), children.begin(), children.end());
+	}
+
+	std::vector<runtime::entity::id_t> ids;
+	ids.reserve(entities.size());
+	for(const auto& e : entities)
+		ids.push_back(e.id());
+	return ids;
+}
+
+double elapsed_ms(std::chrono::steady_clock::time_point begin)
+{
+	const auto end = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::milli>(end - begin).count();
+}
+}
+
+int main()
+{
+	core::details::initialize();
+	core::add_subsystem<core::simulation>();
+	auto& ecs = core::add_subsystem<runtime::entity_component_system>();
+
+	auto root = ecs.create();
+	root.assign<transform_component>();
+	for(std::size_t b = 0; b < branch_count; ++b)
+	{
+		auto branch = ecs.create();
+		branch.assign<transform_component>().lock()->set_parent(root);
+		for(std::size_t l = 0; l < leaf_count; ++l)
+		{
+			auto leaf = ecs.create();
+			leaf.assign<transform_component>().lock()->set_parent(branch);
+		}
+	}
+	const auto scene_size = collect(root).size();
+
+	created_counter counter;
+	runtime::on_entity_created.connect(&counter, &created_counter::created);
+	runtime::on_entities_created.connect(&counter, &created_counter::created_many);
+
+	// Cloning goes through the same archive code as loading a scene file,
+	// without the file.
+	auto begin = std::chrono::steady_clock::now();
+	const auto loaded = ecs::utils::clone_entity(root);
+	const double load_ms = elapsed_ms(begin);
+
+	const auto loaded_ids = collect(loaded);
+	bool valid = loaded_ids.size() == scene_size;
+	if(counter.single != 0 || counter.batches != 1 || counter.batched != scene_size)
+	{
+		std::printf("error: loading announced %zu entities one by one and %zu in %zu batches\n",
+					counter.single, counter.batched, counter.batches);
+		valid = false;
+	}
+
+	begin = std::chrono::steady_clock::now();
+	ecs.destroy_many(loaded_ids);
+	const double unload_ms = elapsed_ms(begin);
+	valid &= ecs.size() == scene_size;
+
+	// The same scene destroyed one entity at a time, leaves first.
+	const auto reloaded_ids = collect(ecs::utils::clone_entity(root));
+	begin = std::chrono::steady_clock::now();
+	for(auto it = reloaded_ids.rbegin(); it != reloaded_ids.rend(); ++it)
+	{
+		if(ecs.valid(*it))
+			ecs.destroy(*it);
+	}
+	const double unload_single_ms = elapsed_ms(begin);
+	valid &= ecs.size() == scene_size;
+
+	runtime::on_entity_created.disconnect(&counter, &created_counter::created);
+	runtime::on_entities_created.disconnect(&counter, &created_counter::created_many);
+
+	std::printf("%zu entities\n", scene_size);
+	std::printf("load                %8.2f ms\n", load_ms);
+	std::printf("unload destroy_many %8.2f ms\n", unload_ms);
+	std::printf("unload one by one   %8.2f ms\n", unload_single_ms);
+
+	core::details::dispose();
+
+	if(!valid)
+	{
+		std::printf("error: the loaded scene differs from the saved one\n");
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,321 @@
+#include "core/math/glm_includes.h"
+#include "core/math/simd.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <limits>
+#include <random>
+#include <vector>
+
+namespace
+{
+/// matrices, points and boxes per kernel
+constexpr std::size_t element_count = 10000;
+/// repetitions of every timed loop
+constexpr int repeats = 200;
+/// largest error allowed, relative to the magnitude of the glm result
+constexpr float tolerance = 1e-4f;
+
+std::mt19937 rng(7);
+
+float random(float min, float max)
+{
+	return std::uniform_real_distribution<float>(min, max)(rng);
+}
+
+glm::vec3 random_vec3(float min, float max)
+{
+	return glm::vec3(random(min, max), random(min, max), random(min, max));
+}
+
+// Random affine matrix, kept well conditioned so that its inverse is
+// meaningful.
+glm::mat4 random_affine()
+{
+	glm::mat4 m(1.0f);
+	for(int c = 0; c < 3; ++c)
+	{
+		for(int r = 0; r < 3; ++r)
+			m[c][r] = random(-1.0f, 1.0f) + (c == r ? 3.0f : 0.0f);
+	}
+	m[3] = glm::vec4(random_vec3(-10.0f, 10.0f), 1.0f);
+	return m;
+}
+
+struct kernel_check
+{
+	const char* name = nullptr;
+	float max_error = 0.0f;
+	double simd_ns = 0.0;
+	double glm_ns = 0.0;
+
+	void compare(float value, float expected)
+	{
+		const float error = std::abs(value - expected) / std::max(1.0f, std::abs(expected));
+		max_error = std::max(max_error, error);
+	}
+
+	template <std::size_t N>
+	void compare(const float* values, const float* expected)
+	{
+		for(std::size_t i = 0; i < N; ++i)
+			compare(values[i], expected[i]);
+	}
+};
+
+/// keeps the timed results alive
+volatile float sink = 0.0f;
+
+template <typename F>
+double measure(std::size_t ops, F&& fn)
+{
+	const auto begin = std::chrono::steady_clock::now();
+	for(int i = 0; i < repeats; ++i)
+		fn();
+	const auto end = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::nano>(end - begin).count() / (double(ops) * repeats);
+}
+
+kernel_check check_mul(const std::vector<glm::mat4>& a, const std::vector<glm::mat4>& b)
+{
+	kernel_check check;
+	check.name = "mul";
+
+	std::vector<glm::mat4> out(a.size());
+	std::vector<glm::mat4> expected(a.size());
+	check.simd_ns = measure(a.size(), [&]() {
+		for(std::size_t i = 0; i < a.size(); ++i)
+			math::simd::mul(glm::value_ptr(a[i]), glm::value_ptr(b[i]), glm::value_ptr(out[i]));
+		sink = out[0][0][0];
+	});
+	check.glm_ns = measure(a.size(), [&]() {
+		for(std::size_t i = 0; i < a.size(); ++i)
+			expected[i] = a[i] * b[i];
+		sink = expected[0][0][0];
+	});
+
+	for(std::size_t i = 0; i < a.size(); ++i)
+		check.compare<16>(glm::value_ptr(out[i]), glm::value_ptr(expected[i]));
+	return check;
+}
+
+kernel_check check_inverse(const std::vector<glm::mat4>& m)
+{
+	kernel_check check;
+	check.name = "inverse_affine";
+
+	std::vector<glm::mat4> out(m.size());
+	std::vector<glm::mat4> expected(m.size());
+	bool inverted = true;
+	check.simd_ns = measure(m.size(), [&]() {
+		for(std::size_t i = 0; i < m.size(); ++i)
+			inverted &= math::simd::inverse_affine(glm::value_ptr(m[i]), glm::value_ptr(out[i]));
+		sink = out[0][0][0];
+	});
+	check.glm_ns = measure(m.size(), [&]() {
+		for(std::size_t i = 0; i < m.size(); ++i)
+			expected[i] = glm::affineInverse(m[i]);
+		sink = expected[0][0][0];
+	});
+
+	for(std::size_t i = 0; i < m.size(); ++i)
+		check.compare<16>(glm::value_ptr(out[i]), glm::value_ptr(expected[i]));
+	if(!inverted)
+		check.max_error = 1.0f;
+	return check;
+}
+
+kernel_check check_points(const glm::mat4& m, const std::vector<glm::vec3>& points, bool normals)
+{
+	kernel_check check;
+	check.name = normals ? "transform_normals" : "transform_points";
+
+	std::vector<glm::vec3> out(points.size());
+	std::vector<glm::vec3> expected(points.size());
+	check.simd_ns = measure(points.size(), [&]() {
+		if(normals)
+			math::simd::transform_normals(glm::value_ptr(m), glm::value_ptr(points[0]), glm::value_ptr(out[0]),
+										  points.size());
+		else
+			math::simd::transform_points(glm::value_ptr(m), glm::value_ptr(points[0]), glm::value_ptr(out[0]),
+										 points.size());
+		sink = out[0].x;
+	});
+	check.glm_ns = measure(points.size(), [&]() {
+		for(std::size_t i = 0; i < points.size(); ++i)
+		{
+			if(normals)
+			{
+				expected[i] = glm::vec3(m * glm::vec4(points[i], 0.0f));
+			}
+			else
+			{
+				const glm::vec4 p = m * glm::vec4(points[i], 1.0f);
+				expected[i] = glm::vec3(p) / p.w;
+			}
+		}
+		sink = expected[0].x;
+	});
+
+	for(std::size_t i = 0; i < points.size(); ++i)
+		check.compare<3>(glm::value_ptr(out[i]), glm::value_ptr(expected[i]));
+	return check;
+}
+
+kernel_check check_aabbs(const std::vector<glm::mat4>& m, const std::vector<glm::vec3>& min,
+						 const std::vector<glm::vec3>& max)
+{
+	kernel_check check;
+	check.name = "transform_aabb";
+
+	std::vector<glm::vec3> out_min(m.size());
+	std::vector<glm::vec3> out_max(m.size());
+	std::vector<glm::vec3> expected_min(m.size());
+	std::vector<glm::vec3> expected_max(m.size());
+	check.simd_ns = measure(m.size(), [&]() {
+		for(std::size_t i = 0; i < m.size(); ++i)
+			math::simd::transform_aabb(glm::value_ptr(m[i]), glm::value_ptr(min[i]), glm::value_ptr(max[i]),
+									   glm::value_ptr(out_min[i]), glm::value_ptr(out_max[i]));
+		sink = out_min[0].x;
+	});
+	check.glm_ns = measure(m.size(), [&]() {
+		for(std::size_t i = 0; i < m.size(); ++i)
+		{
+			// Box around the eight transformed corners.
+			glm::vec3 lo(std::numeric_limits<float>::max());
+			glm::vec3 hi(-std::numeric_limits<float>::max());
+			for(int corner = 0; corner < 8; ++corner)
+			{
+				const glm::vec3 p((corner & 1) ? max[i].x : min[i].x, (corner & 2) ? max[i].y : min[i].y,
+								  (corner & 4) ? max[i].z : min[i].z);
+				const glm::vec3 q(m[i] * glm::vec4(p, 1.0f));
+				lo = glm::min(lo, q);
+				hi = glm::max(hi, q);
+			}
+			expected_min[i] = lo;
+			expected_max[i] = hi;
+		}
+		sink = expected_min[0].x;
+	});
+
+	for(std::size_t i = 0; i < m.size(); ++i)
+	{
+		check.compare<3>(glm::value_ptr(out_min[i]), glm::value_ptr(expected_min[i]));
+		check.compare<3>(glm::value_ptr(out_max[i]), glm::value_ptr(expected_max[i]));
+	}
+	return check;
+}
+
+kernel_check check_cull(const std::vector<glm::vec4>& planes, const std::vector<glm::vec3>& centers,
+						const std::vector<glm::vec3>& extents)
+{
+	kernel_check check;
+	check.name = "cull_aabbs";
+
+	std::vector<float> soa[6];
+	for(int axis = 0; axis < 3; ++axis)
+	{
+		for(std::size_t i = 0; i < centers.size(); ++i)
+		{
+			soa[axis].push_back(centers[i][axis]);
+			soa[axis + 3].push_back(extents[i][axis]);
+		}
+	}
+	const float* center[3] = {soa[0].data(), soa[1].data(), soa[2].data()};
+	const float* extent[3] = {soa[3].data(), soa[4].data(), soa[5].data()};
+
+	std::vector<std::uint32_t> visible((centers.size() + 31) / 32);
+	std::vector<std::uint8_t> expected(centers.size());
+	// Boxes touching a plane within the tolerance may go either way.
+	std::vector<std::uint8_t> borderline(centers.size());
+	check.simd_ns = measure(centers.size(), [&]() {
+		math::simd::cull_aabbs(glm::value_ptr(planes[0]), planes.size(), center, extent, centers.size(),
+							   visible.data());
+		sink = float(visible[0]);
+	});
+	check.glm_ns = measure(centers.size(), [&]() {
+		for(std::size_t i = 0; i < centers.size(); ++i)
+		{
+			bool outside = false;
+			for(const auto& plane : planes)
+			{
+				const glm::vec3 normal(plane);
+				const float distance = glm::dot(normal, centers[i]) + plane.w;
+				const float radius = glm::dot(glm::abs(normal), extents[i]);
+				outside |= distance > radius;
+				borderline[i] |= std::abs(distance - radius) < tolerance;
+			}
+			expected[i] = !outside;
+		}
+		sink = float(expected[0]);
+	});
+
+	for(std::size_t i = 0; i < centers.size(); ++i)
+	{
+		const bool is_visible = (visible[i / 32] >> (i % 32)) & 1u;
+		if(is_visible != bool(expected[i]) && !borderline[i])
+			check.max_error = 1.0f;
+	}
+	return check;
+}
+}
+
+int main()
+{
+	std::vector<glm::mat4> a(element_count);
+	std::vector<glm::mat4> b(element_count);
+	std::vector<glm::vec3> points(element_count);
+	std::vector<glm::vec3> min(element_count);
+	std::vector<glm::vec3> max(element_count);
+	for(std::size_t i = 0; i < element_count; ++i)
+	{
+		a[i] = random_affine();
+		b[i] = random_affine();
+		b[i][0][3] = random(-1.0f, 1.0f);
+		points[i] = random_vec3(-10.0f, 10.0f);
+		min[i] = random_vec3(-10.0f, 10.0f);
+		max[i] = min[i] + random_vec3(0.0f, 5.0f);
+	}
+
+	std::vector<glm::vec3> centers(element_count);
+	std::vector<glm::vec3> extents(element_count);
+	for(std::size_t i = 0; i < element_count; ++i)
+	{
+		centers[i] = (min[i] + max[i]) * 0.5f;
+		extents[i] = (max[i] - min[i]) * 0.5f;
+	}
+
+	std::vector<glm::vec4> planes;
+	for(int i = 0; i < 6; ++i)
+	{
+		const glm::vec3 normal = glm::normalize(random_vec3(-1.0f, 1.0f));
+		planes.emplace_back(normal, random(-5.0f, 5.0f));
+	}
+
+	const kernel_check checks[] = {check_mul(a, b),
+								   check_inverse(a),
+								   check_points(a[0], points, false),
+								   check_points(a[0], points, true),
+								   check_aabbs(a, min, max),
+								   check_cull(planes, centers, extents)};
+
+	std::printf("instruction set %s\n", math::simd::get_instruction_set());
+	std::printf("%-20s %10s %10s %9s %12s\n", "kernel", "simd ns", "glm ns", "speedup", "max error");
+
+	bool valid = true;
+	for(const auto& check : checks)
+	{
+		std::printf("%-20s %10.2f %10.2f %8.2fx %12g\n", check.name, check.simd_ns, check.glm_ns,
+					check.glm_ns / check.simd_ns, double(check.max_error));
+		if(check.max_error > tolerance)
+		{
+			std::printf("error: %s is off by more than %g\n", check.name, double(tolerance));
+			valid = false;
+		}
+	}
+
+	return valid ? 0 : 1;
+}
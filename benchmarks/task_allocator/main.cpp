@@ -0,0 +1,159 @@
+#include "core/system/task_system.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+namespace
+{
+/// number of calls to the global operator new
+std::atomic<std::size_t> heap_allocations{0};
+
+void* counted_allocate(std::size_t size)
+{
+	heap_allocations.fetch_add(1, std::memory_order_relaxed);
+	if(void* p = std::malloc(size ? size : 1))
+		return p;
+
+	throw std::bad_alloc();
+}
+}
+
+void* operator new(std::size_t size)
+{
+	return counted_allocate(size);
+}
+
+void* operator new[](std::size_t size)
+{
+	return counted_allocate(size);
+}
+
+void operator delete(void* p) noexcept
+{
+	std::free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+	std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+	std::free(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept
+{
+	std::free(p);
+}
+
+namespace
+{
+/// tasks pushed per round, half of them awaiting the other half
+constexpr int tasks_per_round = 2000;
+/// rounds run before measuring, to warm the thread caches
+constexpr int warmup_rounds = 50;
+/// measured rounds
+constexpr int measured_rounds = 200;
+/// allocations of the raw allocator comparison
+constexpr std::size_t block_count = 1000000;
+
+long run_round(core::task_system& ts, std::vector<core::task_future<int>>& futures)
+{
+	futures.clear();
+	for(int i = 0; i < tasks_per_round / 2; ++i)
+	{
+		auto value = ts.push_on_worker_thread([i]() { return i; });
+		futures.push_back(ts.push_on_worker_thread([](int x, int y) { return x + y; }, value, 3));
+	}
+
+	long sum = 0;
+	for(auto& future : futures)
+		sum += future.get();
+	return sum;
+}
+
+template <typename Allocate, typename Deallocate>
+double measure_blocks(Allocate&& allocate, Deallocate&& deallocate)
+{
+	std::vector<void*> blocks(1024);
+	const auto begin = std::chrono::steady_clock::now();
+	for(std::size_t i = 0; i < block_count; i += blocks.size())
+	{
+		for(auto& block : blocks)
+			block = allocate();
+		for(auto block : blocks)
+			deallocate(block);
+	}
+	const auto end = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::nano>(end - begin).count() / block_count;
+}
+}
+
+int main()
+{
+	using core::details::task_allocator;
+
+	bool valid = true;
+	{
+		core::task_system ts(4);
+		std::vector<core::task_future<int>> futures;
+		futures.reserve(tasks_per_round / 2);
+
+		for(int i = 0; i < warmup_rounds; ++i)
+			run_round(ts, futures);
+
+		const auto allocations_before = heap_allocations.load();
+		const auto stats_before = task_allocator::get_stats();
+		const auto begin = std::chrono::steady_clock::now();
+
+		long sum = 0;
+		for(int i = 0; i < measured_rounds; ++i)
+			sum += run_round(ts, futures);
+
+		const auto end = std::chrono::steady_clock::now();
+		const auto allocations = heap_allocations.load() - allocations_before;
+		const auto stats = task_allocator::get_stats();
+
+		long expected = 0;
+		for(int i = 0; i < tasks_per_round / 2; ++i)
+			expected += i + 3;
+		expected *= measured_rounds;
+		if(sum != expected)
+		{
+			std::printf("error: wrong task results\n");
+			valid = false;
+		}
+
+		const double seconds = std::chrono::duration<double>(end - begin).count();
+		std::printf("tasks pushed          %d\n", tasks_per_round * measured_rounds);
+		std::printf("tasks per second      %.2f M\n", tasks_per_round * measured_rounds / seconds / 1e6);
+		std::printf("heap allocations      %zu\n", allocations);
+		std::printf("slab allocations      %zu\n", stats.system_allocations - stats_before.system_allocations);
+		std::printf("reserved bytes        %zu\n", stats.reserved_bytes);
+
+		if(allocations != 0)
+		{
+			std::printf("error: pushing tasks allocated from the heap in steady state\n");
+			valid = false;
+		}
+	}
+
+	constexpr std::size_t block_size = 96;
+	const double pooled_ns = measure_blocks([]() { return task_allocator::allocate(block_size); },
+											[](void* p) { task_allocator::deallocate(p, block_size); });
+	const double heap_ns =
+		measure_blocks([]() { return std::malloc(block_size); }, [](void* p) { std::free(p); });
+	std::printf("task_allocator        %.2f ns per block\n", pooled_ns);
+	std::printf("malloc                %.2f ns per block\n", heap_ns);
+
+	if(!valid)
+		return 1;
+
+	return 0;
+}
@@ -0,0 +1,147 @@
+#include "core/system/task_system.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+namespace
+{
+/// pushes measured per case
+constexpr int samples = 200;
+/// pushes measured while the target worker is busy, each one waits for it
+constexpr int busy_samples = 40;
+
+double elapsed_us(std::chrono::steady_clock::time_point begin)
+{
+	return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - begin).count();
+}
+
+struct latency
+{
+	double median = 0.0;
+	double p90 = 0.0;
+	double max = 0.0;
+};
+
+latency summarize(std::vector<double>& values)
+{
+	std::sort(values.begin(), values.end());
+	latency result;
+	result.median = values[values.size() / 2];
+	result.p90 = values[values.size() * 9 / 10];
+	result.max = values.back();
+	return result;
+}
+
+//-----------------------------------------------------------------------------
+//  Name : idle_push ()
+/// <summary>
+/// Time from a push to the start of the task when every worker is idle.
+/// </summary>
+//-----------------------------------------------------------------------------
+latency idle_push(core::task_system& ts)
+{
+	std::vector<double> values;
+	for(int i = 0; i < samples; ++i)
+	{
+		// Lets the workers go idle.
+		std::this_thread::sleep_for(std::chrono::milliseconds(2));
+		const auto begin = std::chrono::steady_clock::now();
+		values.push_back(ts.push_on_worker_thread([begin]() { return elapsed_us(begin); }).get());
+	}
+	return summarize(values);
+}
+
+//-----------------------------------------------------------------------------
+//  Name : cross_queue_push ()
+/// <summary>
+/// Time from a push to the queue of another worker, from inside a task that
+/// stays busy afterwards, to the start of the task.
+/// </summary>
+//-----------------------------------------------------------------------------
+latency cross_queue_push(core::task_system& ts)
+{
+	std::vector<double> values;
+	for(int i = 0; i < samples; ++i)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		auto outer = ts.push_on_worker_thread([&ts]() {
+			const auto queue = ts.get_any_worker_thread_idx() % (ts.get_threads_count() - 1) + 1;
+			const auto begin = std::chrono::steady_clock::now();
+			auto inner = ts.push_on_thread(queue, [begin]() { return elapsed_us(begin); });
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			return inner.get();
+		});
+		values.push_back(outer.get());
+	}
+	return summarize(values);
+}
+
+//-----------------------------------------------------------------------------
+//  Name : busy_worker_push ()
+/// <summary>
+/// Time from a push to the queue of a worker that is stuck in a long task
+/// to the start of the task, which another worker has to take over.
+/// </summary>
+//-----------------------------------------------------------------------------
+latency busy_worker_push(core::task_system& ts)
+{
+	const std::size_t queue = 1;
+	std::vector<double> values;
+	for(int i = 0; i < busy_samples; ++i)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(2));
+		std::atomic<bool> release{false};
+		auto blocker = ts.push_on_thread(queue, [&release]() {
+			while(!release)
+				std::this_thread::sleep_for(std::chrono::microseconds(200));
+		});
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+		const auto begin = std::chrono::steady_clock::now();
+		auto task = ts.push_on_thread(queue, [begin]() { return elapsed_us(begin); });
+		while(!task.is_ready())
+			std::this_thread::sleep_for(std::chrono::microseconds(100));
+		release = true;
+		blocker.get();
+		values.push_back(task.get());
+	}
+	return summarize(values);
+}
+}
+
+//-----------------------------------------------------------------------------
+// Usage: task_latency_benchmark
+// Every case runs with free and with pinned worker threads.
+//-----------------------------------------------------------------------------
+int main()
+{
+	const std::size_t threads = std::max<std::size_t>(4, std::thread::hardware_concurrency());
+
+	std::printf("threads %zu, push to start in us\n", threads);
+	std::printf("%-22s %-8s %10s %10s %10s\n", "case", "workers", "median", "p90", "max");
+
+	for(bool pinned : {false, true})
+	{
+		core::task_system ts(threads, 2, pinned);
+
+		const struct
+		{
+			const char* name;
+			latency result;
+		} cases[] = {{"idle push", idle_push(ts)},
+					 {"cross queue push", cross_queue_push(ts)},
+					 {"push to busy worker", busy_worker_push(ts)}};
+
+		for(const auto& c : cases)
+		{
+			std::printf("%-22s %-8s %10.1f %10.1f %10.1f\n", c.name, pinned ? "pinned" : "free", c.result.median,
+						c.result.p90, c.result.max);
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,126 @@
+#include "core/system/task_system.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <sstream>
+#include <vector>
+
+namespace
+{
+/// tasks pushed per round
+constexpr int tasks_per_round = 10000;
+/// rounds per measurement, traced and untraced rounds alternate
+constexpr int rounds = 50;
+/// overhead per task the tracing is meant to stay below
+constexpr double budget_ns = 100.0;
+
+/// keeps the timed results alive
+volatile std::int64_t sink = 0;
+
+//-----------------------------------------------------------------------------
+//  Name : run_round ()
+/// <summary>
+/// Pushes tiny tasks to the workers and waits for all of them. Returns the
+/// time per task in nanoseconds.
+/// </summary>
+//-----------------------------------------------------------------------------
+double run_round(core::task_system& ts, std::vector<core::task_future<int>>& futures)
+{
+	futures.clear();
+	const auto begin = std::chrono::steady_clock::now();
+	for(int i = 0; i < tasks_per_round; ++i)
+		futures.push_back(ts.push_on_worker_thread([i]() { return i; }));
+	for(auto& future : futures)
+		future.wait();
+	const auto end = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::nano>(end - begin).count() / tasks_per_round;
+}
+
+#if TASK_SYSTEM_TRACING
+//-----------------------------------------------------------------------------
+//  Name : measure_clock ()
+/// <summary>
+/// Time of one trace timestamp in nanoseconds, three are taken per task.
+/// The cycle counter is slow to read in some virtual machines.
+/// </summary>
+//-----------------------------------------------------------------------------
+double measure_clock()
+{
+	std::int64_t sum = 0;
+	const auto begin = std::chrono::steady_clock::now();
+	for(int i = 0; i < tasks_per_round * rounds; ++i)
+		sum += core::details::task_trace::now();
+	const auto end = std::chrono::steady_clock::now();
+	sink = sum;
+	return std::chrono::duration<double, std::nano>(end - begin).count() / (tasks_per_round * rounds);
+}
+#endif
+}
+
+//-----------------------------------------------------------------------------
+// Usage: task_trace_benchmark
+// Tracing is compiled in with the cmake option TASK_SYSTEM_TRACING. Without
+// it only the untraced time per task is reported.
+//-----------------------------------------------------------------------------
+int main()
+{
+	// Tasks pushed to the workers of a single thread system run on the owner
+	// thread, so the difference is not lost in the noise of the scheduling.
+	core::task_system ts(1);
+	std::vector<core::task_future<int>> futures;
+	futures.reserve(tasks_per_round);
+
+	// Warms the task allocator and the trace buffers of the threads.
+	core::task_tracer::start();
+	run_round(ts, futures);
+	core::task_tracer::stop();
+	run_round(ts, futures);
+
+	// The best round of each kind, alternating so that both see the same
+	// machine load.
+	double untraced_ns = 0.0;
+	double traced_ns = 0.0;
+	for(int i = 0; i < rounds; ++i)
+	{
+		const double untraced = run_round(ts, futures);
+		untraced_ns = (i == 0) ? untraced : std::min(untraced_ns, untraced);
+
+		if(!core::task_tracer::is_available())
+			continue;
+
+		core::task_tracer::start();
+		const double traced = run_round(ts, futures);
+		core::task_tracer::stop();
+		traced_ns = (i == 0) ? traced : std::min(traced_ns, traced);
+	}
+
+	std::printf("untraced              %8.1f ns per task\n", untraced_ns);
+	if(!core::task_tracer::is_available())
+	{
+		std::printf("tracing not compiled in, configure with -DTASK_SYSTEM_TRACING=ON\n");
+		return 0;
+	}
+
+	const double overhead_ns = traced_ns - untraced_ns;
+	std::printf("traced                %8.1f ns per task\n", traced_ns);
+	std::printf("overhead              %8.1f ns per task (budget %.0f ns)\n", overhead_ns, budget_ns);
+#if TASK_SYSTEM_TRACING
+	std::printf("3 trace timestamps    %8.1f ns\n", 3.0 * measure_clock());
+#endif
+
+	std::ostringstream trace;
+	const auto written = core::task_tracer::write_chrome_trace(trace);
+	std::printf("tasks in the capture  %8zu\n", written);
+	if(written == 0)
+	{
+		std::printf("error: the capture holds no tasks\n");
+		return 1;
+	}
+
+	if(overhead_ns > budget_ns)
+		std::printf("warning: tracing costs more than the budget\n");
+
+	return 0;
+}
@@ -0,0 +1,213 @@
+#include "core/system/work_stealing_deque.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace
+{
+//-----------------------------------------------------------------------------
+//  Name : locked_queue (Class)
+/// <summary>
+/// The mutex guarded deque the task queues used before the work stealing
+/// deque, with the same push/pop/steal interface.
+/// </summary>
+//-----------------------------------------------------------------------------
+template <typename T>
+class locked_queue
+{
+public:
+	void push(T item)
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_items.push_back(item);
+	}
+
+	bool pop(T& item)
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		if(_items.empty())
+			return false;
+
+		item = _items.back();
+		_items.pop_back();
+		return true;
+	}
+
+	bool steal(T& item)
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		if(_items.empty())
+			return false;
+
+		item = _items.front();
+		_items.pop_front();
+		return true;
+	}
+
+private:
+	std::mutex _mutex;
+	std::deque<T> _items;
+};
+
+/// items pushed by every worker per round
+constexpr std::uint32_t batch_size = 256;
+/// rounds per worker
+constexpr std::uint32_t rounds = 2000;
+
+struct result
+{
+	double seconds = 0.0;
+	std::uint64_t processed = 0;
+	std::uint64_t stolen = 0;
+	std::uint64_t checksum = 0;
+};
+
+//-----------------------------------------------------------------------------
+//  Name : run ()
+/// <summary>
+/// Every worker pushes a batch on its own queue and drains it, stealing from
+/// the other queues whenever its own is empty, like the task system workers
+/// do. Worker 0 pushes twice as much so that the others have work to steal.
+/// </summary>
+//-----------------------------------------------------------------------------
+template <typename Queue>
+result run(std::size_t workers)
+{
+	std::vector<std::unique_ptr<Queue>> queues;
+	for(std::size_t i = 0; i < workers; ++i)
+		queues.emplace_back(new Queue());
+
+	std::uint64_t expected = 0;
+	for(std::size_t i = 0; i < workers; ++i)
+		expected += (i == 0 ? 2 : 1) * std::uint64_t(batch_size) * rounds;
+
+	std::atomic<std::uint64_t> processed{0};
+	std::atomic<std::uint64_t> stolen{0};
+	std::atomic<std::uint64_t> checksum{0};
+	std::atomic<bool> start{false};
+
+	auto worker = [&](std::size_t idx) {
+		auto& own = *queues[idx];
+		const std::uint32_t count = (idx == 0 ? 2 : 1) * batch_size;
+		std::uint64_t local_processed = 0;
+		std::uint64_t local_stolen = 0;
+		std::uint64_t local_checksum = 0;
+
+		while(!start.load(std::memory_order_acquire))
+			std::this_thread::yield();
+
+		auto consume = [&](std::uint32_t item) {
+			local_checksum += item;
+			++local_processed;
+		};
+
+		for(std::uint32_t round = 0; round < rounds; ++round)
+		{
+			for(std::uint32_t i = 0; i < count; ++i)
+				own.push(round * count + i + 1);
+
+			std::uint32_t item = 0;
+			while(own.pop(item))
+				consume(item);
+
+			for(std::size_t i = 1; i < workers; ++i)
+			{
+				if(queues[(idx + i) % workers]->steal(item))
+				{
+					consume(item);
+					++local_stolen;
+				}
+			}
+		}
+
+		processed.fetch_add(local_processed, std::memory_order_relaxed);
+		stolen.fetch_add(local_stolen, std::memory_order_relaxed);
+		checksum.fetch_add(local_checksum, std::memory_order_relaxed);
+	};
+
+	std::vector<std::thread> threads;
+	for(std::size_t i = 0; i < workers; ++i)
+		threads.emplace_back(worker, i);
+
+	const auto begin = std::chrono::steady_clock::now();
+	start.store(true, std::memory_order_release);
+	for(auto& thread : threads)
+		thread.join();
+	const auto end = std::chrono::steady_clock::now();
+
+	// Whatever the thieves left behind.
+	for(auto& queue : queues)
+	{
+		std::uint32_t item = 0;
+		while(queue->steal(item))
+		{
+			checksum += item;
+			++processed;
+		}
+	}
+
+	result res;
+	res.seconds = std::chrono::duration<double>(end - begin).count();
+	res.processed = processed;
+	res.stolen = stolen;
+	res.checksum = checksum;
+	if(res.processed != expected)
+	{
+		std::printf("error: processed %llu items, expected %llu\n",
+					static_cast<unsigned long long>(res.processed),
+					static_cast<unsigned long long>(expected));
+	}
+	return res;
+}
+
+std::uint64_t expected_checksum(std::size_t workers)
+{
+	std::uint64_t sum = 0;
+	for(std::size_t i = 0; i < workers; ++i)
+	{
+		const std::uint64_t n = (i == 0 ? 2 : 1) * std::uint64_t(batch_size) * rounds;
+		sum += n * (n + 1) / 2;
+	}
+	return sum;
+}
+
+void print(const char* name, std::size_t workers, const result& res)
+{
+	std::printf("%-20s workers %2zu  %8.2f Mitems/s  stolen %10llu\n", name, workers,
+				double(res.processed) / res.seconds / 1e6, static_cast<unsigned long long>(res.stolen));
+}
+}
+
+int main()
+{
+	const std::size_t max_workers = std::max<std::size_t>(4, std::thread::hardware_concurrency());
+
+	bool valid = true;
+	for(std::size_t workers = 1; workers <= max_workers; workers *= 2)
+	{
+		const auto expected = expected_checksum(workers);
+
+		const auto lockfree = run<core::work_stealing_deque<std::uint32_t>>(workers);
+		const auto locked = run<locked_queue<std::uint32_t>>(workers);
+		valid &= lockfree.checksum == expected && locked.checksum == expected;
+
+		print("work_stealing_deque", workers, lockfree);
+		print("locked_queue", workers, locked);
+	}
+
+	if(!valid)
+	{
+		std::printf("error: items were lost or processed twice\n");
+		return 1;
+	}
+
+	return 0;
+}
@@ -42,6 +42,7 @@ bool editing_system::initialize()
 
 void editing_system::dispose()
 {
+	play_snapshot.reset();
 	drag_data = {};
 	selection_data = {};
 	icons.clear();
@@ -94,4 +95,38 @@ void editing_system::drop()
 {
 	drag_data = {};
 }
+
+void editing_system::play()
+{
+	if(is_playing())
+		return;
+
+	auto& ecs = core::get_subsystem<runtime::entity_component_system>();
+	play_snapshot = std::make_unique<runtime::world_snapshot>(ecs.take_snapshot());
+	play_camera = camera;
+}
+
+void editing_system::stop()
+{
+	if(!is_playing())
+		return;
+
+	math::transform camera_transform;
+	const bool has_camera = camera && camera.has_component<transform_component>();
+	if(has_camera)
+		camera_transform = camera.get_component<transform_component>().lock()->get_transform();
+
+	auto& ecs = core::get_subsystem<runtime::entity_component_system>();
+	ecs.restore(*play_snapshot);
+	play_snapshot.reset();
+
+	camera = play_camera;
+	play_camera = {};
+	if(has_camera && camera && camera.has_component<transform_component>())
+		camera.get_component<transform_component>().lock()->set_transform(camera_transform);
+
+	if(selection_data.object.is_type<runtime::entity>() &&
+	   !selection_data.object.get_value<runtime::entity>().valid())
+		unselect();
+}
 }
@@ -4,7 +4,9 @@
 #include "core/system/subsystem.h"
 #include "runtime/assets/asset_handle.h"
 #include "runtime/ecs/ecs.h"
+#include "runtime/ecs/world_snapshot.h"
 #include <chrono>
+#include <memory>
 
 class render_window;
 
@@ -125,6 +127,28 @@ struct editing_system : core::subsystem
 	//-----------------------------------------------------------------------------
 	void drop();
 
+	//-----------------------------------------------------------------------------
+	//  Name : play ()
+	/// <summary>
+	/// Enters play mode, saving the world to go back to.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	void play();
+
+	//-----------------------------------------------------------------------------
+	//  Name : stop ()
+	/// <summary>
+	/// Leaves play mode and restores the world saved by play. The editor
+	/// camera stays where it was moved meanwhile.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	void stop();
+
+	inline bool is_playing() const
+	{
+		return play_snapshot != nullptr;
+	}
+
 	/// editor camera
 	runtime::entity camera;
 	/// current scene
@@ -145,5 +169,9 @@ struct editing_system : core::subsystem
 	snap snap_data;
 	/// editor icons lookup map
 	std::unordered_map<std::string, asset_handle<gfx::texture>> icons;
+	/// world saved when play mode was entered
+	std::unique_ptr<runtime::world_snapshot> play_snapshot;
+	/// editor camera when play mode was entered
+	runtime::entity play_camera;
 };
 }
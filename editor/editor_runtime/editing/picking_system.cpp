@@ -6,6 +6,7 @@
 #include "runtime/ecs/components/camera_component.h"
 #include "runtime/ecs/components/model_component.h"
 #include "runtime/ecs/components/transform_component.h"
+#include "runtime/ecs/systems/bounds_system.h"
 #include "runtime/input/input.h"
 #include "runtime/rendering/camera.h"
 #include "runtime/rendering/material.h"
@@ -70,7 +71,7 @@ void picking_system::frame_render(std::chrono::duration<float>)
 
 		pass.set_view_proj(math::value_ptr(pick_view), math::value_ptr(pick_proj));
 
-		ecs.for_each<transform_component, model_component>(
+		ecs.each<transform_component, model_component>(
 			[this, &pass, &camera](runtime::entity e, transform_component& transform_comp_ref,
 								   model_component& model_comp_ref) {
 				auto& model = model_comp_ref.get_model();
@@ -84,10 +85,11 @@ void picking_system::frame_render(std::chrono::duration<float>)
 					return;
 
 				const auto& frustum = camera.get_frustum();
-				const auto& bounds = mesh->get_bounds();
+				const auto bounds =
+					runtime::bounds_system::get_world_bounds(transform_comp_ref, model_comp_ref);
 
 				// Test the bounding box of the mesh
-				if(!math::frustum::test_obb(frustum, bounds, world_transform))
+				if(!frustum.test_aabb(bounds))
 					return;
 
 				auto entity_index = e.id().index();
@@ -343,13 +343,31 @@ void hierarchy_dock::render(const ImVec2&)
 		}
 	}
 
-	for(auto& root : roots)
+	static std::array<char, 64> search_buff = {};
+	gui::PushItemWidth(gui::GetContentRegionAvailWidth());
+	gui::InputText("##SEARCH", search_buff.data(), search_buff.size());
+	gui::PopItemWidth();
+	gui::Separator();
+
+	if(search_buff[0] != 0)
+	{
+		// Flat list of the matches, looked up through the interned names.
+		for(auto& match : ecs.search_entities_by_name(search_buff.data()))
+		{
+			if(match != editor_camera)
+				draw_entity(match);
+		}
+	}
+	else
 	{
-		if(root.valid())
+		for(auto& root : roots)
 		{
-			draw_entity(root);
-			if(root == editor_camera)
-				gui::Separator();
+			if(root.valid())
+			{
+				draw_entity(root);
+				if(root == editor_camera)
+					gui::Separator();
+			}
 		}
 	}
 
@@ -0,0 +1,71 @@
+#include "memory_dock.h"
+#include "core/logging/logging.h"
+#include "editor_core/nativefd/filedialog.h"
+#include "runtime/ecs/ecs.h"
+
+#include <fstream>
+
+memory_dock::memory_dock(const std::string& dtitle, bool close_button, const ImVec2& min_size)
+{
+	initialize(dtitle, close_button, min_size, std::bind(&memory_dock::render, this, std::placeholders::_1));
+}
+
+void memory_dock::render(const ImVec2&)
+{
+	auto& ecs = core::get_subsystem<runtime::entity_component_system>();
+	const auto stats = ecs.get_component_memory_stats();
+
+	if(gui::Button("DUMP CSV"))
+	{
+		std::string path;
+		if(native::save_file_dialog("csv", "", path))
+		{
+			std::ofstream out(path);
+			if(out)
+				ecs.write_component_memory_csv(out);
+			else
+				APPLOG_ERROR("Could not open {0} for writing.", path);
+		}
+	}
+	gui::SameLine();
+	const auto names = ecs.get_name_memory_stats();
+	gui::Text("ENTITIES : %u  NAMES : %u (%u KB)", static_cast<std::uint32_t>(ecs.size()),
+			  static_cast<std::uint32_t>(names.names),
+			  static_cast<std::uint32_t>((names.arena_bytes + names.lookup_bytes) / 1024));
+	gui::Separator();
+
+	gui::Columns(6, "COMPONENT_MEMORY");
+	gui::TextUnformatted("TYPE");
+	gui::NextColumn();
+	gui::TextUnformatted("LIVE");
+	gui::NextColumn();
+	gui::TextUnformatted("CAPACITY");
+	gui::NextColumn();
+	gui::TextUnformatted("USED KB");
+	gui::NextColumn();
+	gui::TextUnformatted("WASTED KB");
+	gui::NextColumn();
+	gui::TextUnformatted("ALLOCS/FRAME");
+	gui::NextColumn();
+	gui::Separator();
+
+	for(const auto& entry : stats)
+	{
+		if(entry.type_name.empty())
+			gui::Text("family %u", static_cast<std::uint32_t>(entry.family));
+		else
+			gui::TextUnformatted(entry.type_name.c_str());
+		gui::NextColumn();
+		gui::Text("%u", static_cast<std::uint32_t>(entry.live));
+		gui::NextColumn();
+		gui::Text("%u", static_cast<std::uint32_t>(entry.capacity));
+		gui::NextColumn();
+		gui::Text("%.1f", double(entry.bytes_used) / 1024.0);
+		gui::NextColumn();
+		gui::Text("%.1f", double(entry.bytes_wasted) / 1024.0);
+		gui::NextColumn();
+		gui::Text("%u", static_cast<std::uint32_t>(entry.allocations_per_frame));
+		gui::NextColumn();
+	}
+	gui::Columns(1);
+}
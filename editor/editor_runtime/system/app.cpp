@@ -8,12 +8,14 @@
 #include "../interface/docks/game_dock.h"
 #include "../interface/docks/hierarchy_dock.h"
 #include "../interface/docks/inspector_dock.h"
+#include "../interface/docks/memory_dock.h"
 #include "../interface/docks/scene_dock.h"
 #include "../interface/docks/style_dock.h"
 #include "../interface/gui_system.h"
 #include "../rendering/debugdraw_system.h"
 #include "../system/project_manager.h"
 #include "core/logging/logging.h"
+#include "core/system/task_trace.h"
 #include "editor_core/nativefd/filedialog.h"
 #include "runtime/assets/asset_extensions.h"
 #include "runtime/assets/asset_manager.h"
@@ -27,6 +29,9 @@
 #include "runtime/input/input.h"
 #include "runtime/rendering/renderer.h"
 #include "runtime/system/events.h"
+
+#include <fstream>
+
 namespace editor
 {
 
@@ -392,8 +397,13 @@ void app::draw_toolbar()
 	}
 
 	gui::SameLine(width / 2.0f - 36.0f);
-	if(gui::ToolbarButton(icons["play"].get(), "PLAY", false))
+	if(gui::ToolbarButton(icons[es.is_playing() ? "stop" : "play"].get(), es.is_playing() ? "STOP" : "PLAY",
+						  es.is_playing()))
 	{
+		if(es.is_playing())
+			es.stop();
+		else
+			es.play();
 	}
 	gui::SameLine(0.0f);
 	if(gui::ToolbarButton(icons["pause"].get(), "PAUSE", false))
@@ -437,6 +447,7 @@ void app::start(cmd_line::options_parser& parser)
 	auto assets = std::make_unique<assets_dock>("ASSETS", true, ImVec2(200.0f, 200.0f));
 	auto console = std::make_unique<console_dock>("CONSOLE", true, ImVec2(200.0f, 200.0f), _console_log);
 	auto style = std::make_unique<style_dock>("STYLE", true, ImVec2(300.0f, 200.0f));
+	auto memory = std::make_unique<memory_dock>("MEMORY", true, ImVec2(300.0f, 200.0f));
 
 	auto& dockspace = docking.get_dockspace(main_window->get_id());
 	dockspace.dock_to(scene.get(), imguidock::slot::tab, 200, true);
@@ -446,6 +457,7 @@ void app::start(cmd_line::options_parser& parser)
 	dockspace.dock_to(console.get(), imguidock::slot::bottom, 300, true);
 	dockspace.dock_with(assets.get(), console.get(), imguidock::slot::tab, 250, true);
 	dockspace.dock_with(style.get(), assets.get(), imguidock::slot::right, 400, true);
+	dockspace.dock_with(memory.get(), style.get(), imguidock::slot::tab, 400, false);
 
 	docking.register_dock(std::move(scene));
 	docking.register_dock(std::move(game));
@@ -454,12 +466,81 @@ void app::start(cmd_line::options_parser& parser)
 	docking.register_dock(std::move(console));
 	docking.register_dock(std::move(assets));
 	docking.register_dock(std::move(style));
+	docking.register_dock(std::move(memory));
 
 	auto logging_container = logging::get_mutable_logging_container();
 	logging_container->add_sink(_console_log);
 	std::function<void()> log_version = []() { APPLOG_INFO("Version 1.0"); };
 	_console_log->register_command("version", "Returns the current version of the Editor.", {}, {},
 								   log_version);
+
+	std::function<void(std::string, std::string)> task_trace = [](std::string action, std::string file) {
+		if(!core::task_tracer::is_available())
+		{
+			APPLOG_WARNING("Task tracing is not compiled in. Configure with TASK_SYSTEM_TRACING=ON.");
+			return;
+		}
+
+		if(action == "start")
+		{
+			core::task_tracer::start();
+			APPLOG_INFO("Task trace started.");
+		}
+		else if(action == "stop")
+		{
+			core::task_tracer::stop();
+			APPLOG_INFO("Task trace stopped.");
+		}
+		else if(action == "dump")
+		{
+			std::ofstream out(file);
+			if(!out)
+			{
+				APPLOG_ERROR("Could not open {0} for writing.", file);
+				return;
+			}
+			const auto tasks = core::task_tracer::write_chrome_trace(out);
+			APPLOG_INFO("Wrote {0} tasks to {1}.", tasks, file);
+		}
+		else
+		{
+			APPLOG_WARNING("Unknown action {0}. Use start, stop or dump.", action);
+		}
+	};
+	_console_log->register_command(
+		"task_trace", "Records the task system threads. Dump writes a chrome trace json file.",
+		{"action", "file"}, {"task_trace.json"}, task_trace);
+
+	std::function<void(std::string)> ecs_memory = [](std::string file) {
+		auto& ecs = core::get_subsystem<runtime::entity_component_system>();
+		if(file.empty())
+		{
+			for(const auto& stats : ecs.get_component_memory_stats())
+			{
+				APPLOG_INFO("{0} ({1}) : {2} live, {3} capacity, {4} bytes used, {5} bytes wasted, {6} "
+							"allocations per frame",
+							stats.type_name, stats.family, stats.live, stats.capacity, stats.bytes_used,
+							stats.bytes_wasted, stats.allocations_per_frame);
+			}
+			const auto names = ecs.get_name_memory_stats();
+			APPLOG_INFO("entity names : {0} distinct, {1} bytes used, {2} bytes arena, {3} bytes lookup",
+						names.names, names.used_bytes, names.arena_bytes, names.lookup_bytes);
+			return;
+		}
+
+		std::ofstream out(file);
+		if(!out)
+		{
+			APPLOG_ERROR("Could not open {0} for writing.", file);
+			return;
+		}
+		ecs.write_component_memory_csv(out);
+		APPLOG_INFO("Wrote component memory stats to {0}.", file);
+	};
+	_console_log->register_command("ecs_memory",
+								   "Prints the memory used by the components of each type, or writes it "
+								   "as csv to the given file.",
+								   {"file"}, {""}, ecs_memory);
 }
 
 void app::stop()
@@ -546,6 +627,9 @@ void app::draw_footer(render_window&, imguidock::dockspace& dockspace)
 		if(gui::IsItemHovered())
 		{
 			gui::BeginTooltip();
+			gui::AlignTextToFramePadding();
+			gui::Text("Main thread ran : %u deferred : %u", unsigned(tasks_info.owner_tasks_ran),
+					  unsigned(tasks_info.owner_tasks_deferred));
 			int idx = 0;
 			for(const auto& info : tasks_info.queue_infos)
 			{
@@ -553,6 +637,9 @@ void app::draw_footer(render_window&, imguidock::dockspace& dockspace)
 				gui::AlignTextToFramePadding();
 				gui::Text("Queue %d tasks : %u", idx++, unsigned(info.pending_tasks));
 			}
+			gui::Separator();
+			gui::AlignTextToFramePadding();
+			gui::Text("IO tasks : %u", unsigned(tasks_info.io_queue_info.pending_tasks));
 
 			gui::EndTooltip();
 		}
@@ -2,6 +2,7 @@
 
 #include "platform_config.h"
 
+#include <cstddef>
 #include <thread>
 // An attempt at making a wrapper to deal with many Linuxes as well as Windows. Please edit as needed.
 #if $on($windows) && $on($msvc)
@@ -56,6 +57,17 @@ inline void set_thread_name(std::thread& thread, const char* threadName)
 	DWORD threadId = ::GetThreadId(reinterpret_cast<HANDLE>(thread.native_handle()));
 	set_thread_name(threadId, threadName);
 }
+
+inline bool set_thread_affinity(std::thread& thread, std::size_t core)
+{
+	const auto mask = DWORD_PTR(1) << (core % (sizeof(DWORD_PTR) * 8));
+	return ::SetThreadAffinityMask(reinterpret_cast<HANDLE>(thread.native_handle()), mask) != 0;
+}
+
+inline void cpu_relax()
+{
+	YieldProcessor();
+}
 }
 #else
 namespace platform
@@ -64,5 +76,31 @@ inline void set_thread_name(std::thread& thread, const char* threadName)
 {
 	pthread_setname_np(thread.native_handle(), threadName);
 }
+
+inline bool set_thread_affinity(std::thread& thread, std::size_t core)
+{
+#if $on($linux) && !$on($android)
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(core % CPU_SETSIZE, &set);
+	return pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set) == 0;
+#else
+	// not supported, the scheduler decides
+	(void)thread;
+	(void)core;
+	return false;
+#endif
+}
+
+inline void cpu_relax()
+{
+#if defined(__i386__) || defined(__x86_64__)
+	__builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+	__asm__ __volatile__("yield");
+#else
+	std::this_thread::yield();
+#endif
+}
 }
 #endif
@@ -47,6 +47,43 @@ byte_array_t read_stream(std::istream& stream)
 	return read_memory;
 }
 
+byte_array_buf::byte_array_buf(const std::uint8_t* data, std::size_t size)
+{
+	// The get area is never written through.
+	auto begin = reinterpret_cast<char*>(const_cast<std::uint8_t*>(data));
+	setg(begin, begin, begin + size);
+}
+
+byte_array_buf::byte_array_buf(const byte_array_t& data)
+	: byte_array_buf(data.data(), data.size())
+{
+}
+
+byte_array_buf::pos_type byte_array_buf::seekoff(off_type off, std::ios_base::seekdir dir,
+												 std::ios_base::openmode which)
+{
+	if((which & std::ios_base::in) == 0)
+		return pos_type(off_type(-1));
+
+	off_type base = 0;
+	if(dir == std::ios_base::cur)
+		base = gptr() - eback();
+	else if(dir == std::ios_base::end)
+		base = egptr() - eback();
+
+	const off_type pos = base + off;
+	if(pos < 0 || pos > egptr() - eback())
+		return pos_type(off_type(-1));
+
+	setg(eback(), eback() + pos, egptr());
+	return pos_type(pos);
+}
+
+byte_array_buf::pos_type byte_array_buf::seekpos(pos_type pos, std::ios_base::openmode which)
+{
+	return seekoff(off_type(pos), std::ios_base::beg, which);
+}
+
 path resolve_protocol(const path& _path)
 {
 	const auto string_path = _path.generic_string();
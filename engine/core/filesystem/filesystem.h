@@ -3,6 +3,7 @@
 #include "boost/filesystem.hpp"
 #include <chrono>
 #include <istream>
+#include <streambuf>
 #include <unordered_map>
 #include <vector>
 namespace fs
@@ -51,6 +52,25 @@ protocols_t& get_path_protocols();
 //-----------------------------------------------------------------------------
 byte_array_t read_stream(std::istream& stream);
 
+//-----------------------------------------------------------------------------
+//  Name : byte_array_buf (Class)
+/// <summary>
+/// Read only stream buffer over memory it does not own, for instance a
+/// byte_array_t, so that the bytes can be parsed through a std::istream
+/// without copying them. The memory must outlive the buffer.
+/// </summary>
+//-----------------------------------------------------------------------------
+class byte_array_buf : public std::streambuf
+{
+public:
+	byte_array_buf(const std::uint8_t* data, std::size_t size);
+	explicit byte_array_buf(const byte_array_t& data);
+
+protected:
+	pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override;
+	pos_type seekpos(pos_type pos, std::ios_base::openmode which) override;
+};
+
 //-----------------------------------------------------------------------------
 //  Name : resolve_protocol()
 /// <summary>
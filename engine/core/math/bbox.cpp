@@ -1,4 +1,5 @@
 #include "bbox.h"
+#include "simd.h"
 #include <limits>
 // #include <memory.h>
 // #include <float.h>
@@ -933,15 +934,10 @@ bbox& bbox::mul(const transform& t)
 //-----------------------------------------------------------------------------
 bbox bbox::mul(const bbox& bounds, const transform& t)
 {
-	auto xa = t.x_axis() * bounds.min.x;
-	auto xb = t.x_axis() * bounds.max.x;
-	auto ya = t.y_axis() * bounds.min.y;
-	auto yb = t.y_axis() * bounds.max.y;
-	auto za = t.z_axis() * bounds.min.z;
-	auto zb = t.z_axis() * bounds.max.z;
-
-	return bbox(math::min(xa, xb) + math::min(ya, yb) + math::min(za, zb) + t.get_position(),
-				math::max(xa, xb) + math::max(ya, yb) + math::max(za, zb) + t.get_position());
+	bbox result;
+	simd::transform_aabb(glm::value_ptr(t.matrix()), glm::value_ptr(bounds.min), glm::value_ptr(bounds.max),
+						 glm::value_ptr(result.min), glm::value_ptr(result.max));
+	return result;
 
 	//	bbox result;
 	//	vec3 bounds_center = bounds.get_center();
@@ -0,0 +1,97 @@
+#include "bbox_soa.h"
+
+namespace math
+{
+///////////////////////////////////////////////////////////////////////////////
+// bbox_soa Member Functions
+///////////////////////////////////////////////////////////////////////////////
+//-----------------------------------------------------------------------------
+//  Name : clear ()
+/// <summary>
+/// Removes all the boxes, keeping the storage.
+/// </summary>
+//-----------------------------------------------------------------------------
+void bbox_soa::clear()
+{
+	resize(0);
+}
+
+//-----------------------------------------------------------------------------
+//  Name : reserve ()
+/// <summary>
+///
+///
+///
+/// </summary>
+//-----------------------------------------------------------------------------
+void bbox_soa::reserve(std::size_t count)
+{
+	for(std::size_t axis = 0; axis < 3; ++axis)
+	{
+		_center[axis].reserve(count);
+		_extent[axis].reserve(count);
+	}
+}
+
+//-----------------------------------------------------------------------------
+//  Name : resize ()
+/// <summary>
+/// Changes the number of boxes, new ones are empty at the origin.
+/// </summary>
+//-----------------------------------------------------------------------------
+void bbox_soa::resize(std::size_t count)
+{
+	for(std::size_t axis = 0; axis < 3; ++axis)
+	{
+		_center[axis].resize(count, 0.0f);
+		_extent[axis].resize(count, 0.0f);
+	}
+	_size = count;
+}
+
+//-----------------------------------------------------------------------------
+//  Name : push_back ()
+/// <summary>
+///
+///
+///
+/// </summary>
+//-----------------------------------------------------------------------------
+void bbox_soa::push_back(const bbox& bounds)
+{
+	resize(_size + 1);
+	set(_size - 1, bounds);
+}
+
+//-----------------------------------------------------------------------------
+//  Name : set ()
+/// <summary>
+/// Replaces the box at the index.
+/// </summary>
+//-----------------------------------------------------------------------------
+void bbox_soa::set(std::size_t index, const bbox& bounds)
+{
+	const vec3 center = bounds.get_center();
+	const vec3 extents = bounds.get_extents();
+	for(std::size_t axis = 0; axis < 3; ++axis)
+	{
+		_center[axis][index] = center[axis];
+		_extent[axis][index] = extents[axis];
+	}
+}
+
+//-----------------------------------------------------------------------------
+//  Name : get ()
+/// <summary>
+///
+///
+///
+/// </summary>
+//-----------------------------------------------------------------------------
+bbox bbox_soa::get(std::size_t index) const
+{
+	const vec3 center(_center[0][index], _center[1][index], _center[2][index]);
+	const vec3 extents(_extent[0][index], _extent[1][index], _extent[2][index]);
+	return bbox(center - extents, center + extents);
+}
+}
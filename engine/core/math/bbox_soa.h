@@ -0,0 +1,79 @@
+#pragma once
+
+//-----------------------------------------------------------------------------
+// bbox_soa Header Includes
+//-----------------------------------------------------------------------------
+#include "bbox.h"
+#include <array>
+#include <cstddef>
+#include <vector>
+namespace math
+{
+using namespace glm;
+//-----------------------------------------------------------------------------
+// Main class declarations
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+//  Name : bbox_soa (Class)
+/// <summary>
+/// Array of boxes stored as one center and one extent array per axis, so that
+/// batch tests such as frustum::test_aabbs read several boxes per instruction.
+/// </summary>
+//-----------------------------------------------------------------------------
+class bbox_soa
+{
+public:
+	//-------------------------------------------------------------------------
+	// Public Methods
+	//-------------------------------------------------------------------------
+	void clear();
+	void reserve(std::size_t count);
+	void resize(std::size_t count);
+	void push_back(const bbox& bounds);
+	void set(std::size_t index, const bbox& bounds);
+	bbox get(std::size_t index) const;
+
+	//-------------------------------------------------------------------------
+	// Public Inline Methods
+	//-------------------------------------------------------------------------
+	inline std::size_t size() const
+	{
+		return _size;
+	}
+
+	inline bool empty() const
+	{
+		return _size == 0;
+	}
+
+	//-------------------------------------------------------------------------
+	//  Name : centers ()
+	/// <summary>
+	/// Per axis arrays of the box centers, size() floats each.
+	/// </summary>
+	//-------------------------------------------------------------------------
+	inline std::array<const float*, 3> centers() const
+	{
+		return {{_center[0].data(), _center[1].data(), _center[2].data()}};
+	}
+
+	//-------------------------------------------------------------------------
+	//  Name : extents ()
+	/// <summary>
+	/// Per axis arrays of the box half dimensions, size() floats each.
+	/// </summary>
+	//-------------------------------------------------------------------------
+	inline std::array<const float*, 3> extents() const
+	{
+		return {{_extent[0].data(), _extent[1].data(), _extent[2].data()}};
+	}
+
+private:
+	//-------------------------------------------------------------------------
+	// Private Variables
+	//-------------------------------------------------------------------------
+	std::array<std::vector<float>, 3> _center;
+	std::array<std::vector<float>, 3> _extent;
+	std::size_t _size = 0;
+};
+}
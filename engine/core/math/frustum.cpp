@@ -1,4 +1,5 @@
 #include "frustum.h"
+#include "simd.h"
 
 namespace math
 {
@@ -473,6 +474,23 @@ bool frustum::test_aabb(const bbox& AABB) const
 	return true;
 }
 
+//-----------------------------------------------------------------------------
+//  Name : test_aabbs ()
+/// <summary>
+/// Determine which of the boxes passed are within the frustum, several at a
+/// time. Bit i % 32 of visible[i / 32] is set when box i is visible.
+/// </summary>
+//-----------------------------------------------------------------------------
+void frustum::test_aabbs(const bbox_soa& bounds, std::vector<std::uint32_t>& visible) const
+{
+	visible.resize((bounds.size() + 31) / 32);
+	if(bounds.empty())
+		return;
+
+	simd::cull_aabbs(glm::value_ptr(planes[0].data), planes.size(), bounds.centers().data(),
+					 bounds.extents().data(), bounds.size(), visible.data());
+}
+
 //-----------------------------------------------------------------------------
 //  Name : testAABB ()
 /// <summary>
@@ -900,8 +918,7 @@ frustum& frustum::mul(const transform& t)
 		plane = plane::normalize(plane::mul(plane, mtxIT));
 
 	// transform points
-	for(auto& point : points)
-		point = transform::transform_coord(point, mtx);
+	mtx.transform_coords(points.data(), points.data(), points.size());
 
 	// transform originating position.
 	position = transform::transform_coord(position, mtx);
@@ -1,11 +1,14 @@
 #pragma once
 
 #include "bbox.h"
+#include "bbox_soa.h"
 #include "bbox_extruded.h"
 #include "math_types.h"
 #include "plane.h"
 #include "transform.h"
 #include <array>
+#include <cstdint>
+#include <vector>
 
 namespace math
 {
@@ -42,6 +45,7 @@ public:
 	volume_query classify_plane(const plane& plane) const;
 	bool test_point(const vec3& point) const;
 	bool test_aabb(const bbox& bounds) const;
+	void test_aabbs(const bbox_soa& bounds, std::vector<std::uint32_t>& visible) const;
 
 	bool test_extruded_aabb(const bbox_extruded& box) const;
 	bool test_sphere(const vec3& center, float radius) const;
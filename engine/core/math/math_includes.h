@@ -2,6 +2,7 @@
 
 #include "bbox.h"
 #include "bbox_extruded.h"
+#include "bbox_soa.h"
 #include "bsphere.h"
 #include "frustum.h"
 #include "math_types.h"
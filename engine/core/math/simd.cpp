@@ -0,0 +1,447 @@
+#include "simd.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(MATH_SIMD_SSE2)
+#include <emmintrin.h>
+#endif
+#if defined(MATH_SIMD_AVX2)
+#include <immintrin.h>
+#endif
+#if defined(MATH_SIMD_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace math
+{
+namespace simd
+{
+namespace
+{
+#if !defined(MATH_SIMD_SSE2)
+bool inverse_affine_scalar(const float* m, float* out)
+{
+	// Rows of the inverse of the 3x3 part are the cross products of its
+	// columns divided by the determinant.
+	const float r[9] = {
+		m[5] * m[10] - m[6] * m[9], m[6] * m[8] - m[4] * m[10], m[4] * m[9] - m[5] * m[8],
+		m[9] * m[2] - m[10] * m[1], m[10] * m[0] - m[8] * m[2], m[8] * m[1] - m[9] * m[0],
+		m[1] * m[6] - m[2] * m[5],  m[2] * m[4] - m[0] * m[6],  m[0] * m[5] - m[1] * m[4]};
+	const float det = m[0] * r[0] + m[1] * r[1] + m[2] * r[2];
+	if(det == 0.0f)
+		return false;
+
+	const float inv_det = 1.0f / det;
+	const float tx = m[12], ty = m[13], tz = m[14];
+	float result[16];
+	for(int col = 0; col < 3; ++col)
+	{
+		result[col * 4 + 0] = r[col] * inv_det;
+		result[col * 4 + 1] = r[3 + col] * inv_det;
+		result[col * 4 + 2] = r[6 + col] * inv_det;
+		result[col * 4 + 3] = 0.0f;
+	}
+	for(int row = 0; row < 3; ++row)
+		result[12 + row] = -(result[row] * tx + result[4 + row] * ty + result[8 + row] * tz);
+	result[15] = 1.0f;
+
+	std::memcpy(out, result, sizeof(result));
+	return true;
+}
+#endif
+
+bool outside_aabb(const float* planes, std::size_t plane_count, const float* const center[3],
+				  const float* const extent[3], std::size_t i)
+{
+	for(std::size_t p = 0; p < plane_count; ++p)
+	{
+		const float* plane = planes + p * 4;
+		const float distance =
+			plane[0] * center[0][i] + plane[1] * center[1][i] + plane[2] * center[2][i] + plane[3];
+		const float radius = std::abs(plane[0]) * extent[0][i] + std::abs(plane[1]) * extent[1][i] +
+							 std::abs(plane[2]) * extent[2][i];
+		if(distance > radius)
+			return true;
+	}
+	return false;
+}
+
+#if defined(MATH_SIMD_SSE2)
+inline __m128 madd(__m128 a, __m128 b, __m128 c)
+{
+	return _mm_add_ps(_mm_mul_ps(a, b), c);
+}
+
+inline void store3(float* out, __m128 v)
+{
+	_mm_storel_pi(reinterpret_cast<__m64*>(out), v);
+	_mm_store_ss(out + 2, _mm_movehl_ps(v, v));
+}
+
+inline __m128 cross(__m128 a, __m128 b)
+{
+	const __m128 a_yzx = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 2, 1));
+	const __m128 b_yzx = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 2, 1));
+	const __m128 c = _mm_sub_ps(_mm_mul_ps(a, b_yzx), _mm_mul_ps(a_yzx, b));
+	return _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 0, 2, 1));
+}
+
+inline __m128 transform_point(const __m128 cols[4], const float* p)
+{
+	__m128 r = _mm_mul_ps(cols[0], _mm_set1_ps(p[0]));
+	r = madd(cols[1], _mm_set1_ps(p[1]), r);
+	r = madd(cols[2], _mm_set1_ps(p[2]), r);
+	return _mm_add_ps(r, cols[3]);
+}
+
+inline __m128 transform_normal(const __m128 cols[4], const float* n)
+{
+	__m128 r = _mm_mul_ps(cols[0], _mm_set1_ps(n[0]));
+	r = madd(cols[1], _mm_set1_ps(n[1]), r);
+	return madd(cols[2], _mm_set1_ps(n[2]), r);
+}
+#endif
+
+#if defined(MATH_SIMD_AVX2)
+inline __m256 madd(__m256 a, __m256 b, __m256 c)
+{
+#if defined(__FMA__)
+	return _mm256_fmadd_ps(a, b, c);
+#else
+	return _mm256_add_ps(_mm256_mul_ps(a, b), c);
+#endif
+}
+#endif
+
+#if defined(MATH_SIMD_NEON)
+inline void store3(float* out, float32x4_t v)
+{
+	vst1_f32(out, vget_low_f32(v));
+	vst1q_lane_f32(out + 2, v, 2);
+}
+
+inline float32x4_t transform_normal(const float32x4_t cols[4], const float* n)
+{
+	float32x4_t r = vmulq_n_f32(cols[0], n[0]);
+	r = vmlaq_n_f32(r, cols[1], n[1]);
+	return vmlaq_n_f32(r, cols[2], n[2]);
+}
+#endif
+}
+
+const char* get_instruction_set()
+{
+#if defined(MATH_SIMD_AVX2)
+	return "avx2";
+#elif defined(MATH_SIMD_SSE2)
+	return "sse2";
+#elif defined(MATH_SIMD_NEON)
+	return "neon";
+#else
+	return "scalar";
+#endif
+}
+
+void mul(const float* a, const float* b, float* out)
+{
+#if defined(MATH_SIMD_AVX2)
+	// Two columns of the result per register.
+	const __m256 a0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a));
+	const __m256 a1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a + 4));
+	const __m256 a2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a + 8));
+	const __m256 a3 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a + 12));
+	const __m256 b01 = _mm256_loadu_ps(b);
+	const __m256 b23 = _mm256_loadu_ps(b + 8);
+
+	__m256 r01 = _mm256_mul_ps(a0, _mm256_permute_ps(b01, 0x00));
+	r01 = madd(a1, _mm256_permute_ps(b01, 0x55), r01);
+	r01 = madd(a2, _mm256_permute_ps(b01, 0xAA), r01);
+	r01 = madd(a3, _mm256_permute_ps(b01, 0xFF), r01);
+
+	__m256 r23 = _mm256_mul_ps(a0, _mm256_permute_ps(b23, 0x00));
+	r23 = madd(a1, _mm256_permute_ps(b23, 0x55), r23);
+	r23 = madd(a2, _mm256_permute_ps(b23, 0xAA), r23);
+	r23 = madd(a3, _mm256_permute_ps(b23, 0xFF), r23);
+
+	_mm256_storeu_ps(out, r01);
+	_mm256_storeu_ps(out + 8, r23);
+#elif defined(MATH_SIMD_SSE2)
+	const __m128 cols[4] = {_mm_loadu_ps(a), _mm_loadu_ps(a + 4), _mm_loadu_ps(a + 8), _mm_loadu_ps(a + 12)};
+	__m128 r[4];
+	for(int col = 0; col < 4; ++col)
+		r[col] = madd(cols[3], _mm_set1_ps(b[col * 4 + 3]), transform_normal(cols, b + col * 4));
+	for(int col = 0; col < 4; ++col)
+		_mm_storeu_ps(out + col * 4, r[col]);
+#elif defined(MATH_SIMD_NEON)
+	const float32x4_t cols[4] = {vld1q_f32(a), vld1q_f32(a + 4), vld1q_f32(a + 8), vld1q_f32(a + 12)};
+	float32x4_t r[4];
+	for(int col = 0; col < 4; ++col)
+		r[col] = vmlaq_n_f32(transform_normal(cols, b + col * 4), cols[3], b[col * 4 + 3]);
+	for(int col = 0; col < 4; ++col)
+		vst1q_f32(out + col * 4, r[col]);
+#else
+	float r[16];
+	for(int col = 0; col < 4; ++col)
+	{
+		for(int row = 0; row < 4; ++row)
+		{
+			r[col * 4 + row] = a[row] * b[col * 4] + a[4 + row] * b[col * 4 + 1] +
+							   a[8 + row] * b[col * 4 + 2] + a[12 + row] * b[col * 4 + 3];
+		}
+	}
+	std::memcpy(out, r, sizeof(r));
+#endif
+}
+
+bool is_affine(const float* m)
+{
+	return m[3] == 0.0f && m[7] == 0.0f && m[11] == 0.0f && m[15] == 1.0f;
+}
+
+bool inverse_affine(const float* m, float* out)
+{
+	if(!is_affine(m))
+		return false;
+
+#if defined(MATH_SIMD_SSE2)
+	// The w of the first three columns is 0, so is the w of their crosses.
+	const __m128 c0 = _mm_loadu_ps(m);
+	const __m128 c1 = _mm_loadu_ps(m + 4);
+	const __m128 c2 = _mm_loadu_ps(m + 8);
+	const __m128 c3 = _mm_loadu_ps(m + 12);
+
+	__m128 r0 = cross(c1, c2);
+	__m128 r1 = cross(c2, c0);
+	__m128 r2 = cross(c0, c1);
+	__m128 r3 = _mm_setzero_ps();
+
+	__m128 det = _mm_mul_ps(c0, r0);
+	det = _mm_add_ps(det, _mm_shuffle_ps(det, det, _MM_SHUFFLE(2, 3, 0, 1)));
+	det = _mm_add_ps(det, _mm_shuffle_ps(det, det, _MM_SHUFFLE(1, 0, 3, 2)));
+	if(_mm_cvtss_f32(det) == 0.0f)
+		return false;
+
+	const __m128 inv_det = _mm_div_ps(_mm_set1_ps(1.0f), det);
+	r0 = _mm_mul_ps(r0, inv_det);
+	r1 = _mm_mul_ps(r1, inv_det);
+	r2 = _mm_mul_ps(r2, inv_det);
+	_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+
+	const __m128 t = _mm_sub_ps(_mm_set_ps(1.0f, 0.0f, 0.0f, 0.0f),
+								madd(r2, _mm_shuffle_ps(c3, c3, _MM_SHUFFLE(2, 2, 2, 2)),
+									 madd(r1, _mm_shuffle_ps(c3, c3, _MM_SHUFFLE(1, 1, 1, 1)),
+										  _mm_mul_ps(r0, _mm_shuffle_ps(c3, c3, _MM_SHUFFLE(0, 0, 0, 0))))));
+	_mm_storeu_ps(out, r0);
+	_mm_storeu_ps(out + 4, r1);
+	_mm_storeu_ps(out + 8, r2);
+	_mm_storeu_ps(out + 12, t);
+	return true;
+#else
+	return inverse_affine_scalar(m, out);
+#endif
+}
+
+void transform_points(const float* m, const float* in, float* out, std::size_t count)
+{
+	// Affine matrices leave w at 1, the projection is skipped for them.
+	const bool affine = is_affine(m);
+#if defined(MATH_SIMD_SSE2)
+	const __m128 cols[4] = {_mm_loadu_ps(m), _mm_loadu_ps(m + 4), _mm_loadu_ps(m + 8), _mm_loadu_ps(m + 12)};
+	if(affine)
+	{
+		for(std::size_t i = 0; i < count; ++i)
+			store3(out + i * 3, transform_point(cols, in + i * 3));
+	}
+	else
+	{
+		for(std::size_t i = 0; i < count; ++i)
+		{
+			const __m128 p = transform_point(cols, in + i * 3);
+			store3(out + i * 3, _mm_div_ps(p, _mm_shuffle_ps(p, p, _MM_SHUFFLE(3, 3, 3, 3))));
+		}
+	}
+#elif defined(MATH_SIMD_NEON)
+	const float32x4_t cols[4] = {vld1q_f32(m), vld1q_f32(m + 4), vld1q_f32(m + 8), vld1q_f32(m + 12)};
+	for(std::size_t i = 0; i < count; ++i)
+	{
+		float32x4_t p = vaddq_f32(transform_normal(cols, in + i * 3), cols[3]);
+		if(!affine)
+			p = vmulq_n_f32(p, 1.0f / vgetq_lane_f32(p, 3));
+		store3(out + i * 3, p);
+	}
+#else
+	for(std::size_t i = 0; i < count; ++i)
+	{
+		const float x = in[i * 3], y = in[i * 3 + 1], z = in[i * 3 + 2];
+		float r[4];
+		for(int row = 0; row < 4; ++row)
+			r[row] = m[row] * x + m[4 + row] * y + m[8 + row] * z + m[12 + row];
+		const float inv_w = affine ? 1.0f : 1.0f / r[3];
+		out[i * 3] = r[0] * inv_w;
+		out[i * 3 + 1] = r[1] * inv_w;
+		out[i * 3 + 2] = r[2] * inv_w;
+	}
+#endif
+}
+
+void transform_normals(const float* m, const float* in, float* out, std::size_t count)
+{
+#if defined(MATH_SIMD_SSE2)
+	const __m128 cols[4] = {_mm_loadu_ps(m), _mm_loadu_ps(m + 4), _mm_loadu_ps(m + 8), _mm_setzero_ps()};
+	for(std::size_t i = 0; i < count; ++i)
+		store3(out + i * 3, transform_normal(cols, in + i * 3));
+#elif defined(MATH_SIMD_NEON)
+	const float32x4_t cols[4] = {vld1q_f32(m), vld1q_f32(m + 4), vld1q_f32(m + 8), vdupq_n_f32(0.0f)};
+	for(std::size_t i = 0; i < count; ++i)
+		store3(out + i * 3, transform_normal(cols, in + i * 3));
+#else
+	for(std::size_t i = 0; i < count; ++i)
+	{
+		const float x = in[i * 3], y = in[i * 3 + 1], z = in[i * 3 + 2];
+		for(int row = 0; row < 3; ++row)
+			out[i * 3 + row] = m[row] * x + m[4 + row] * y + m[8 + row] * z;
+	}
+#endif
+}
+
+void transform_aabb(const float* m, const float* min, const float* max, float* out_min, float* out_max)
+{
+	// Each axis of the matrix contributes its smaller and larger end to the
+	// result (Arvo), the sums keep the order of the scalar code.
+#if defined(MATH_SIMD_SSE2)
+	const __m128 xa = _mm_mul_ps(_mm_loadu_ps(m), _mm_set1_ps(min[0]));
+	const __m128 xb = _mm_mul_ps(_mm_loadu_ps(m), _mm_set1_ps(max[0]));
+	const __m128 ya = _mm_mul_ps(_mm_loadu_ps(m + 4), _mm_set1_ps(min[1]));
+	const __m128 yb = _mm_mul_ps(_mm_loadu_ps(m + 4), _mm_set1_ps(max[1]));
+	const __m128 za = _mm_mul_ps(_mm_loadu_ps(m + 8), _mm_set1_ps(min[2]));
+	const __m128 zb = _mm_mul_ps(_mm_loadu_ps(m + 8), _mm_set1_ps(max[2]));
+	const __m128 position = _mm_loadu_ps(m + 12);
+
+	const __m128 lo = _mm_add_ps(
+		_mm_add_ps(_mm_add_ps(_mm_min_ps(xa, xb), _mm_min_ps(ya, yb)), _mm_min_ps(za, zb)), position);
+	const __m128 hi = _mm_add_ps(
+		_mm_add_ps(_mm_add_ps(_mm_max_ps(xa, xb), _mm_max_ps(ya, yb)), _mm_max_ps(za, zb)), position);
+	store3(out_min, lo);
+	store3(out_max, hi);
+#elif defined(MATH_SIMD_NEON)
+	const float32x4_t xa = vmulq_n_f32(vld1q_f32(m), min[0]);
+	const float32x4_t xb = vmulq_n_f32(vld1q_f32(m), max[0]);
+	const float32x4_t ya = vmulq_n_f32(vld1q_f32(m + 4), min[1]);
+	const float32x4_t yb = vmulq_n_f32(vld1q_f32(m + 4), max[1]);
+	const float32x4_t za = vmulq_n_f32(vld1q_f32(m + 8), min[2]);
+	const float32x4_t zb = vmulq_n_f32(vld1q_f32(m + 8), max[2]);
+	const float32x4_t position = vld1q_f32(m + 12);
+
+	const float32x4_t lo = vaddq_f32(
+		vaddq_f32(vaddq_f32(vminq_f32(xa, xb), vminq_f32(ya, yb)), vminq_f32(za, zb)), position);
+	const float32x4_t hi = vaddq_f32(
+		vaddq_f32(vaddq_f32(vmaxq_f32(xa, xb), vmaxq_f32(ya, yb)), vmaxq_f32(za, zb)), position);
+	store3(out_min, lo);
+	store3(out_max, hi);
+#else
+	float lo[3], hi[3];
+	for(int row = 0; row < 3; ++row)
+	{
+		const float xa = m[row] * min[0], xb = m[row] * max[0];
+		const float ya = m[4 + row] * min[1], yb = m[4 + row] * max[1];
+		const float za = m[8 + row] * min[2], zb = m[8 + row] * max[2];
+		lo[row] = std::min(xa, xb) + std::min(ya, yb) + std::min(za, zb) + m[12 + row];
+		hi[row] = std::max(xa, xb) + std::max(ya, yb) + std::max(za, zb) + m[12 + row];
+	}
+	std::memcpy(out_min, lo, sizeof(lo));
+	std::memcpy(out_max, hi, sizeof(hi));
+#endif
+}
+void cull_aabbs(const float* planes, std::size_t plane_count, const float* const center[3],
+				const float* const extent[3], std::size_t count, std::uint32_t* visible)
+{
+	// A box is culled when its point nearest to a plane, center minus the
+	// extent projected on the normal, is in front of it.
+	std::fill(visible, visible + (count + 31) / 32, 0u);
+	std::size_t i = 0;
+#if defined(MATH_SIMD_AVX2)
+	for(; i + 8 <= count; i += 8)
+	{
+		const __m256 cx = _mm256_loadu_ps(center[0] + i);
+		const __m256 cy = _mm256_loadu_ps(center[1] + i);
+		const __m256 cz = _mm256_loadu_ps(center[2] + i);
+		const __m256 ex = _mm256_loadu_ps(extent[0] + i);
+		const __m256 ey = _mm256_loadu_ps(extent[1] + i);
+		const __m256 ez = _mm256_loadu_ps(extent[2] + i);
+		__m256 outside = _mm256_setzero_ps();
+		for(std::size_t p = 0; p < plane_count; ++p)
+		{
+			const float* plane = planes + p * 4;
+			__m256 distance = madd(_mm256_set1_ps(plane[0]), cx, _mm256_set1_ps(plane[3]));
+			distance = madd(_mm256_set1_ps(plane[1]), cy, distance);
+			distance = madd(_mm256_set1_ps(plane[2]), cz, distance);
+			__m256 radius = _mm256_mul_ps(_mm256_set1_ps(std::abs(plane[0])), ex);
+			radius = madd(_mm256_set1_ps(std::abs(plane[1])), ey, radius);
+			radius = madd(_mm256_set1_ps(std::abs(plane[2])), ez, radius);
+			outside = _mm256_or_ps(outside, _mm256_cmp_ps(distance, radius, _CMP_GT_OQ));
+		}
+		const auto bits = static_cast<std::uint32_t>(~_mm256_movemask_ps(outside) & 0xFF);
+		visible[i / 32] |= bits << (i % 32);
+	}
+#elif defined(MATH_SIMD_SSE2)
+	for(; i + 4 <= count; i += 4)
+	{
+		const __m128 cx = _mm_loadu_ps(center[0] + i);
+		const __m128 cy = _mm_loadu_ps(center[1] + i);
+		const __m128 cz = _mm_loadu_ps(center[2] + i);
+		const __m128 ex = _mm_loadu_ps(extent[0] + i);
+		const __m128 ey = _mm_loadu_ps(extent[1] + i);
+		const __m128 ez = _mm_loadu_ps(extent[2] + i);
+		__m128 outside = _mm_setzero_ps();
+		for(std::size_t p = 0; p < plane_count; ++p)
+		{
+			const float* plane = planes + p * 4;
+			__m128 distance = madd(_mm_set1_ps(plane[0]), cx, _mm_set1_ps(plane[3]));
+			distance = madd(_mm_set1_ps(plane[1]), cy, distance);
+			distance = madd(_mm_set1_ps(plane[2]), cz, distance);
+			__m128 radius = _mm_mul_ps(_mm_set1_ps(std::abs(plane[0])), ex);
+			radius = madd(_mm_set1_ps(std::abs(plane[1])), ey, radius);
+			radius = madd(_mm_set1_ps(std::abs(plane[2])), ez, radius);
+			outside = _mm_or_ps(outside, _mm_cmpgt_ps(distance, radius));
+		}
+		const auto bits = static_cast<std::uint32_t>(~_mm_movemask_ps(outside) & 0xF);
+		visible[i / 32] |= bits << (i % 32);
+	}
+#elif defined(MATH_SIMD_NEON)
+	for(; i + 4 <= count; i += 4)
+	{
+		const float32x4_t cx = vld1q_f32(center[0] + i);
+		const float32x4_t cy = vld1q_f32(center[1] + i);
+		const float32x4_t cz = vld1q_f32(center[2] + i);
+		const float32x4_t ex = vld1q_f32(extent[0] + i);
+		const float32x4_t ey = vld1q_f32(extent[1] + i);
+		const float32x4_t ez = vld1q_f32(extent[2] + i);
+		uint32x4_t outside = vdupq_n_u32(0);
+		for(std::size_t p = 0; p < plane_count; ++p)
+		{
+			const float* plane = planes + p * 4;
+			float32x4_t distance = vmlaq_n_f32(vdupq_n_f32(plane[3]), cx, plane[0]);
+			distance = vmlaq_n_f32(distance, cy, plane[1]);
+			distance = vmlaq_n_f32(distance, cz, plane[2]);
+			float32x4_t radius = vmulq_n_f32(ex, std::abs(plane[0]));
+			radius = vmlaq_n_f32(radius, ey, std::abs(plane[1]));
+			radius = vmlaq_n_f32(radius, ez, std::abs(plane[2]));
+			outside = vorrq_u32(outside, vcgtq_f32(distance, radius));
+		}
+		static const std::uint32_t lane_bits[4] = {1, 2, 4, 8};
+		const uint32x4_t masked = vandq_u32(vmvnq_u32(outside), vld1q_u32(lane_bits));
+		const uint32x2_t pair = vorr_u32(vget_low_u32(masked), vget_high_u32(masked));
+		const std::uint32_t bits = vget_lane_u32(pair, 0) | vget_lane_u32(pair, 1);
+		visible[i / 32] |= bits << (i % 32);
+	}
+#endif
+	for(; i < count; ++i)
+	{
+		if(!outside_aabb(planes, plane_count, center, extent, i))
+			visible[i / 32] |= 1u << (i % 32);
+	}
+}
+}
+}
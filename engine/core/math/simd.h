@@ -0,0 +1,104 @@
+#pragma once
+//-----------------------------------------------------------------------------
+// simd Header Includes
+//-----------------------------------------------------------------------------
+#include <cstddef>
+#include <cstdint>
+
+//-----------------------------------------------------------------------------
+// Instruction set selection. Defining MATH_SIMD_SCALAR forces the portable
+// code, otherwise the widest set enabled for the compiler is used.
+//-----------------------------------------------------------------------------
+#if !defined(MATH_SIMD_SCALAR)
+#if defined(__AVX2__)
+#define MATH_SIMD_AVX2 1
+#define MATH_SIMD_SSE2 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MATH_SIMD_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define MATH_SIMD_NEON 1
+#endif
+#endif
+
+namespace math
+{
+//-----------------------------------------------------------------------------
+// Matrix kernels. Matrices are 16 floats in column major order, the layout of
+// glm::mat4, and need no particular alignment. Points and normals are packed
+// 3 floats each, the layout of an array of glm::vec3.
+//-----------------------------------------------------------------------------
+namespace simd
+{
+//-----------------------------------------------------------------------------
+//  Name : get_instruction_set ()
+/// <summary>
+/// Name of the instruction set the kernels were compiled for.
+/// </summary>
+//-----------------------------------------------------------------------------
+const char* get_instruction_set();
+
+//-----------------------------------------------------------------------------
+//  Name : mul ()
+/// <summary>
+/// out = a * b. out may be a or b.
+/// </summary>
+//-----------------------------------------------------------------------------
+void mul(const float* a, const float* b, float* out);
+
+//-----------------------------------------------------------------------------
+//  Name : is_affine ()
+/// <summary>
+/// Whether the last row of the matrix is (0, 0, 0, 1).
+/// </summary>
+//-----------------------------------------------------------------------------
+bool is_affine(const float* m);
+
+//-----------------------------------------------------------------------------
+//  Name : inverse_affine ()
+/// <summary>
+/// Inverts an affine matrix through its 3x3 part. Returns false and leaves out
+/// untouched when the matrix is not affine or that part is singular, so the
+/// caller can fall back to a general inverse. out may be m.
+/// </summary>
+//-----------------------------------------------------------------------------
+bool inverse_affine(const float* m, float* out);
+
+//-----------------------------------------------------------------------------
+//  Name : transform_points ()
+/// <summary>
+/// Transforms count points with w = 1 and projects the results back into
+/// w = 1. out may be in.
+/// </summary>
+//-----------------------------------------------------------------------------
+void transform_points(const float* m, const float* in, float* out, std::size_t count);
+
+//-----------------------------------------------------------------------------
+//  Name : transform_normals ()
+/// <summary>
+/// Transforms count directions with w = 0. out may be in.
+/// </summary>
+//-----------------------------------------------------------------------------
+void transform_normals(const float* m, const float* in, float* out, std::size_t count);
+
+//-----------------------------------------------------------------------------
+//  Name : transform_aabb ()
+/// <summary>
+/// Axis aligned box enclosing the box [min, max] transformed by an affine
+/// matrix. out_min and out_max may be min and max.
+/// </summary>
+//-----------------------------------------------------------------------------
+void transform_aabb(const float* m, const float* min, const float* max, float* out_min, float* out_max);
+
+//-----------------------------------------------------------------------------
+//  Name : cull_aabbs ()
+/// <summary>
+/// Tests count boxes, given as one center and one extent array per axis,
+/// against planes of 4 floats each with their normals pointing out, the
+/// frustum::planes layout. Bit i % 32 of visible[i / 32] is set when box i is
+/// not entirely in front of any plane. visible holds (count + 31) / 32 words.
+/// </summary>
+//-----------------------------------------------------------------------------
+void cull_aabbs(const float* planes, std::size_t plane_count, const float* const center[3],
+				const float* const extent[3], std::size_t count, std::uint32_t* visible);
+}
+}
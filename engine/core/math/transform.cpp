@@ -1,5 +1,6 @@
 #include "transform.h"
 #include "math_types.h"
+#include "simd.h"
 
 //-----------------------------------------------------------------------------
 // Defines
@@ -176,7 +177,7 @@ transform transform::operator*(const transform& t) const
 {
 
 	transform tOut;
-	tOut._matrix = _matrix * t._matrix;
+	simd::mul(glm::value_ptr(_matrix), glm::value_ptr(t._matrix), glm::value_ptr(tOut._matrix));
 
 	return tOut;
 }
@@ -237,7 +238,7 @@ transform transform::operator-(const transform& t) const
 //-----------------------------------------------------------------------------
 transform& transform::operator*=(const transform& t)
 {
-	_matrix *= t._matrix;
+	simd::mul(glm::value_ptr(_matrix), glm::value_ptr(t._matrix), glm::value_ptr(_matrix));
 	return *this;
 }
 
@@ -610,7 +611,8 @@ transform& transform::compose(const quat& qRotation, const vec3& vTranslation)
 //-----------------------------------------------------------------------------
 transform& transform::invert()
 {
-	_matrix = glm::inverse(_matrix);
+	if(!simd::inverse_affine(glm::value_ptr(_matrix), glm::value_ptr(_matrix)))
+		_matrix = glm::inverse(_matrix);
 
 	return *this;
 }
@@ -624,9 +626,8 @@ transform& transform::invert()
 //-----------------------------------------------------------------------------
 vec3 transform::transform_coord(const vec3& v) const
 {
-	vec4 vOut;
-	vOut = _matrix * vec4{v, 1.0f};
-	vOut /= vOut.w;
+	vec3 vOut;
+	simd::transform_points(glm::value_ptr(_matrix), glm::value_ptr(v), glm::value_ptr(vOut), 1);
 	return vOut;
 }
 
@@ -651,7 +652,7 @@ vec3 transform::transform_coord(const vec3& v, const transform& t)
 //-----------------------------------------------------------------------------
 vec3 transform::inverse_transform_coord(const vec3& v) const
 {
-	mat4 im = glm::inverse(_matrix);
+	mat4 im = math::inverse(*this);
 	vec3 vOut;
 	vOut = im * vec4{v, 1.0f};
 	return vOut;
@@ -677,9 +678,8 @@ vec3 transform::inverse_transform_coord(const vec3& v, const transform& t)
 //-----------------------------------------------------------------------------
 vec3 transform::transform_normal(const vec3& v) const
 {
-	mat4 im = _matrix;
 	vec3 vOut;
-	vOut = im * vec4{v, 0.0f};
+	simd::transform_normals(glm::value_ptr(_matrix), glm::value_ptr(v), glm::value_ptr(vOut), 1);
 	return vOut;
 }
 
@@ -703,7 +703,7 @@ vec3 transform::transform_normal(const vec3& v, const transform& t)
 //-----------------------------------------------------------------------------
 vec3 transform::inverse_transform_normal(const vec3& v) const
 {
-	mat4 im = glm::inverse(_matrix);
+	mat4 im = math::inverse(*this);
 	vec3 vOut;
 	vOut = im * vec4{v, 0.0f};
 	return vOut;
@@ -721,6 +721,30 @@ vec3 transform::inverse_transform_normal(const vec3& v, const transform& t)
 	return t.inverse_transform_normal(v);
 }
 
+//-----------------------------------------------------------------------------
+//  Name : transform_coords()
+/// <summary>
+/// transforms an array of 3D vectors by the values in this transform object,
+/// projecting the results back into w = 1. out may be in.
+/// </summary>
+//-----------------------------------------------------------------------------
+void transform::transform_coords(const vec3* in, vec3* out, std::size_t count) const
+{
+	simd::transform_points(glm::value_ptr(_matrix), glm::value_ptr(*in), glm::value_ptr(*out), count);
+}
+
+//-----------------------------------------------------------------------------
+//  Name : transform_normals()
+/// <summary>
+/// transforms an array of 3D vector normals by the values in this transform
+/// object. out may be in.
+/// </summary>
+//-----------------------------------------------------------------------------
+void transform::transform_normals(const vec3* in, vec3* out, std::size_t count) const
+{
+	simd::transform_normals(glm::value_ptr(_matrix), glm::value_ptr(*in), glm::value_ptr(*out), count);
+}
+
 //-----------------------------------------------------------------------------
 //  Name : rotate ()
 /// <summary>
@@ -1211,8 +1235,9 @@ bool transform::is_identity() const
 
 math::transform inverse(transform const& t)
 {
-	glm::mat4 m = t.matrix();
-	glm::mat4 inv = glm::inverse(m);
+	transform inv;
+	if(!simd::inverse_affine(glm::value_ptr(t.matrix()), glm::value_ptr(inv.matrix())))
+		inv = glm::inverse(t.matrix());
 	return inv;
 }
 
@@ -37,6 +37,8 @@ public:
 	vec3 inverse_transform_coord(const vec3& v) const;
 	vec3 transform_normal(const vec3& v) const;
 	vec3 inverse_transform_normal(const vec3& v) const;
+	void transform_coords(const vec3* in, vec3* out, std::size_t count) const;
+	void transform_normals(const vec3* in, vec3* out, std::size_t count) const;
 	bool decompose(vec3& scale, vec3& shear, quat& rotation, vec3& translation) const;
 	bool decompose(vec3& scale, quat& rotation, vec3& translation) const;
 	bool decompose(quat& rotation, vec3& translation) const;
@@ -2,3 +2,4 @@
 
 #include "checked_delete.h"
 #include "memory_pool.hpp"
+#include "pool_allocator.hpp"
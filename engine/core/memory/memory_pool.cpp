@@ -1,4 +1,5 @@
 #include "memory_pool.hpp"
+#include <algorithm>
 #include <cstdlib>
 #include <cstring>
 
@@ -47,14 +48,13 @@ void memory_pool::free(void* block)
 	std::size_t index = invalid;
 	std::size_t offset = _chunk_entries_size * _block_size;
 
-	for(std::size_t i = 0; i < _chunks.size(); ++i)
+	auto it = std::upper_bound(std::begin(_chunks_by_address), std::end(_chunks_by_address), block,
+							   [this](void* b, std::size_t i) { return (std::size_t)b < (std::size_t)_chunks[i]; });
+	if(it != std::begin(_chunks_by_address))
 	{
-		if((std::size_t)block >= (std::size_t)_chunks[i] &&
-		   (std::size_t)block < (std::size_t)_chunks[i] + offset)
-		{
+		const auto i = *(it - 1);
+		if((std::size_t)block < (std::size_t)_chunks[i] + offset)
 			index = i * _chunk_entries_size + ((std::size_t)block - (std::size_t)_chunks[i]) / _block_size;
-			break;
-		}
 	}
 
 	if(index == invalid)
@@ -78,6 +78,7 @@ void memory_pool::free_all()
 		::free(chunk);
 
 	_chunks.clear();
+	_chunks_by_address.clear();
 	_available = 0;
 	_first_free_block = invalid;
 }
@@ -85,11 +86,11 @@ void memory_pool::free_all()
 std::size_t memory_pool::grow()
 {
 	auto chunk = static_cast<uint8_t*>(::malloc(_chunk_entries_size * _block_size));
-	memset(chunk, 0xCC, _chunk_entries_size * _block_size);
-
 	if(chunk == nullptr)
 		return invalid;
 
+	memset(chunk, 0xCC, _chunk_entries_size * _block_size);
+
 	auto iterator = chunk;
 	auto offset = _chunk_entries_size * _chunks.size();
 	for(std::size_t i = 1; i < _chunk_entries_size; ++i, iterator += _block_size)
@@ -98,6 +99,9 @@ std::size_t memory_pool::grow()
 
 	_available += _chunk_entries_size;
 	_chunks.push_back(chunk);
+	auto it = std::upper_bound(std::begin(_chunks_by_address), std::end(_chunks_by_address), chunk,
+							   [this](uint8_t* c, std::size_t i) { return (std::size_t)c < (std::size_t)_chunks[i]; });
+	_chunks_by_address.insert(it, _chunks.size() - 1);
 	return offset;
 }
 }
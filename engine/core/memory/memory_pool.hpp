@@ -32,6 +32,8 @@ struct memory_pool
 	std::size_t size() const;
 	// returns the capacity of current pool
 	std::size_t capacity() const;
+	// returns the size of one block in bytes
+	std::size_t block_size() const;
 
 protected:
 	constexpr const static std::size_t invalid = std::numeric_limits<std::size_t>::max();
@@ -39,6 +41,8 @@ protected:
 	std::size_t grow();
 
 	std::vector<uint8_t*> _chunks;
+	// chunk indices ordered by address, to find the owner of a block
+	std::vector<std::size_t> _chunks_by_address;
 
 	std::size_t _available;
 	std::size_t _first_free_block;
@@ -66,4 +70,9 @@ inline std::size_t memory_pool::capacity() const
 {
 	return _chunks.size() * _chunk_entries_size;
 }
+
+inline std::size_t memory_pool::block_size() const
+{
+	return _block_size;
+}
 }
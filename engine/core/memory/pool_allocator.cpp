@@ -0,0 +1,35 @@
+#include "pool_allocator.hpp"
+
+namespace core
+{
+
+locked_memory_pool::locked_memory_pool(std::size_t block_size, std::size_t chunk_size)
+	: _pool(block_size, chunk_size)
+	, _block_size(_pool.block_size())
+{
+}
+
+void* locked_memory_pool::malloc()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	++_allocations;
+	return _pool.malloc();
+}
+
+void locked_memory_pool::free(void* block)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	_pool.free(block);
+}
+
+memory_pool_stats locked_memory_pool::get_stats() const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	memory_pool_stats stats;
+	stats.size = _pool.size();
+	stats.capacity = _pool.capacity();
+	stats.block_size = _block_size;
+	stats.allocations = _allocations;
+	return stats;
+}
+}
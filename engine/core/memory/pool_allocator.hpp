@@ -0,0 +1,169 @@
+#pragma once
+
+#include "memory_pool.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <new>
+#include <type_traits>
+
+namespace core
+{
+
+struct memory_pool_stats
+{
+	// blocks handed out
+	std::size_t size = 0;
+	// blocks allocated from the system
+	std::size_t capacity = 0;
+	// bytes per block
+	std::size_t block_size = 0;
+	// blocks handed out since the pool was created
+	std::size_t allocations = 0;
+};
+
+// a memory pool that can be used from several threads at once
+struct locked_memory_pool
+{
+	locked_memory_pool(std::size_t block_size, std::size_t chunk_size);
+
+	// accquire a unused block of memory
+	void* malloc();
+	// recycle the memory to pool
+	void free(void*);
+
+	// returns the size of one block in bytes, fixed at construction
+	std::size_t block_size() const;
+	memory_pool_stats get_stats() const;
+
+private:
+	mutable std::mutex _mutex;
+	memory_pool _pool;
+	std::size_t _block_size;
+	std::size_t _allocations = 0;
+};
+
+namespace details
+{
+// the pool shared by every pool_allocator with the same tag. it is created by
+// the first allocation and its block size fits the type allocated first.
+template <typename Tag, std::size_t Growth>
+struct tagged_memory_pool
+{
+	static locked_memory_pool& get(std::size_t block_size)
+	{
+		// intentionally never destroyed, blocks may be returned by static
+		// objects that outlive it
+		static auto pool = publish(new locked_memory_pool(block_size, Growth));
+		return *pool;
+	}
+
+	static const locked_memory_pool* find()
+	{
+		return instance().load(std::memory_order_acquire);
+	}
+
+private:
+	static std::atomic<locked_memory_pool*>& instance()
+	{
+		static std::atomic<locked_memory_pool*> pool{nullptr};
+		return pool;
+	}
+
+	static locked_memory_pool* publish(locked_memory_pool* pool)
+	{
+		instance().store(pool, std::memory_order_release);
+		return pool;
+	}
+};
+}
+
+// standard allocator taking single objects from a locked_memory_pool per tag.
+// rebinding keeps the tag, so std::allocate_shared<T>(pool_allocator<T>())
+// puts the object together with its control block into the pool of T.
+// arrays, and types that do not fit the blocks of the pool, go to the
+// global operator new.
+template <typename T, typename Tag = T, std::size_t Growth = 128>
+struct pool_allocator
+{
+	using value_type = T;
+
+	template <typename U>
+	struct rebind
+	{
+		using other = pool_allocator<U, Tag, Growth>;
+	};
+
+	pool_allocator() noexcept = default;
+
+	template <typename U>
+	pool_allocator(const pool_allocator<U, Tag, Growth>&) noexcept
+	{
+	}
+
+	T* allocate(std::size_t n)
+	{
+		if(n != 1)
+			return static_cast<T*>(::operator new(n * sizeof(T)));
+
+		auto& pool = get_pool();
+		if(!fits(pool))
+			return static_cast<T*>(::operator new(sizeof(T)));
+
+		auto block = pool.malloc();
+		if(block == nullptr)
+			throw std::bad_alloc();
+
+		return static_cast<T*>(block);
+	}
+
+	void deallocate(T* p, std::size_t n) noexcept
+	{
+		auto& pool = get_pool();
+		if(n == 1 && fits(pool))
+			pool.free(p);
+		else
+			::operator delete(p);
+	}
+
+	// occupancy of the pool of this tag, empty until the first allocation
+	static memory_pool_stats get_stats()
+	{
+		auto pool = details::tagged_memory_pool<Tag, Growth>::find();
+		return pool ? pool->get_stats() : memory_pool_stats();
+	}
+
+private:
+	using aligned_storage_t = typename std::aligned_storage<sizeof(T), alignof(T)>::type;
+
+	static locked_memory_pool& get_pool()
+	{
+		return details::tagged_memory_pool<Tag, Growth>::get(sizeof(aligned_storage_t));
+	}
+
+	static bool fits(const locked_memory_pool& pool)
+	{
+		// chunks come from malloc, aligned for any scalar type
+		return sizeof(T) <= pool.block_size() && pool.block_size() % alignof(T) == 0 &&
+			   alignof(T) <= alignof(std::max_align_t);
+	}
+};
+
+template <typename T, typename U, typename Tag, std::size_t Growth>
+inline bool operator==(const pool_allocator<T, Tag, Growth>&, const pool_allocator<U, Tag, Growth>&)
+{
+	return true;
+}
+
+template <typename T, typename U, typename Tag, std::size_t Growth>
+inline bool operator!=(const pool_allocator<T, Tag, Growth>&, const pool_allocator<U, Tag, Growth>&)
+{
+	return false;
+}
+
+inline std::size_t locked_memory_pool::block_size() const
+{
+	return _block_size;
+}
+}
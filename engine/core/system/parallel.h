@@ -0,0 +1,285 @@
+#pragma once
+
+#include "task_system.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace core
+{
+namespace details
+{
+//-----------------------------------------------------------------------------
+//  Name : parallel_state (Class)
+/// <summary>
+/// Shared state of one parallel call. Keeps the first exception thrown by any
+/// of the chunks so that it can be rethrown on the calling thread.
+/// </summary>
+//-----------------------------------------------------------------------------
+struct parallel_state
+{
+	void set_exception(std::exception_ptr e)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if(!exception)
+			exception = e;
+	}
+
+	void rethrow()
+	{
+		if(exception)
+			std::rethrow_exception(exception);
+	}
+
+	std::mutex mutex;
+	std::exception_ptr exception;
+};
+
+//-----------------------------------------------------------------------------
+//  Name : range_job (Class)
+/// <summary>
+/// The right half of a split range. Whoever claims it first runs it, either a
+/// worker that popped the pushed task or the thread that split it when it
+/// comes back to join. The thread that split it never waits for a job that
+/// has not started yet.
+/// </summary>
+//-----------------------------------------------------------------------------
+template <typename T>
+struct range_job
+{
+	range_job(std::size_t b, std::size_t e, const T& identity)
+		: begin(b)
+		, end(e)
+		, result(identity)
+	{
+	}
+
+	bool claim()
+	{
+		return !claimed.exchange(true, std::memory_order_acq_rel);
+	}
+
+	// The job is already running elsewhere, other pending tasks are run
+	// meanwhile instead of spinning.
+	void wait(task_system& ts) const
+	{
+		while(!done.load(std::memory_order_acquire))
+		{
+			if(!ts.run_pending_task())
+				std::this_thread::yield();
+		}
+	}
+
+	std::size_t begin;
+	std::size_t end;
+	T result;
+	std::atomic_bool claimed{false};
+	std::atomic_bool done{false};
+};
+
+//-----------------------------------------------------------------------------
+//  Name : auto_grain ()
+/// <summary>
+/// Picks a grain size when the caller passes 0. Aims at a few chunks per
+/// worker so that stealing can even out uneven chunks.
+/// </summary>
+//-----------------------------------------------------------------------------
+inline std::size_t auto_grain(const task_system& ts, std::size_t count)
+{
+	const std::size_t chunks_per_thread = 4;
+	const std::size_t threads = std::max<std::size_t>(ts.get_threads_count(), 1);
+	return std::max<std::size_t>(count / (threads * chunks_per_thread), 1);
+}
+
+//-----------------------------------------------------------------------------
+//  Name : parallel_split ()
+/// <summary>
+/// Recursive range splitting. The range is halved, the right half is pushed
+/// as a job and the left half is split again until it is below the grain.
+/// The calling thread runs the leftmost leaf and then joins the jobs it
+/// pushed, running inline every job no worker has claimed yet. Splitting
+/// stops early when the workers already have enough pending work, which
+/// adapts the effective grain to the load of the system. Partial results
+/// are combined left to right so reduce does not need to be commutative.
+/// </summary>
+//-----------------------------------------------------------------------------
+template <typename T, typename Leaf, typename Reduce>
+T parallel_split(task_system& ts, const std::shared_ptr<parallel_state>& state, std::size_t begin,
+				 std::size_t end, std::size_t grain, const T& identity, const Leaf& leaf,
+				 const Reduce& reduce)
+{
+	using job_t = range_job<T>;
+
+	// execution of a job by whichever thread claims it
+	const auto execute = [&ts, state, grain, &identity, &leaf, &reduce](job_t& job) {
+		try
+		{
+			job.result = parallel_split(ts, state, job.begin, job.end, grain, identity, leaf, reduce);
+		}
+		catch(...)
+		{
+			state->set_exception(std::current_exception());
+		}
+		job.done.store(true, std::memory_order_release);
+	};
+
+	std::vector<std::shared_ptr<job_t>> jobs;
+	const std::size_t max_pending = ts.get_threads_count() * 2;
+	while(end - begin > grain && ts.get_threads_count() > 1 && ts.get_pending_tasks() < max_pending)
+	{
+		const std::size_t mid = begin + (end - begin) / 2;
+		auto job = std::make_shared<job_t>(mid, end, identity);
+		jobs.emplace_back(job);
+
+		// The job is only ever executed while the splitting thread is waiting for
+		// it inside this call, so the captured references outlive it.
+		ts.push_on_worker_thread([job, execute]() {
+			if(job->claim())
+				execute(*job);
+		});
+
+		end = mid;
+	}
+
+	T result = identity;
+	try
+	{
+		result = leaf(begin, end, identity);
+	}
+	catch(...)
+	{
+		state->set_exception(std::current_exception());
+	}
+
+	// Join, nearest (smallest) job first, which also keeps the left to right order.
+	// This must happen even if something threw since the jobs reference this frame.
+	for(auto it = jobs.rbegin(); it != jobs.rend(); ++it)
+	{
+		auto& job = *(*it);
+		if(job.claim())
+			execute(job);
+		else
+			job.wait(ts);
+
+		try
+		{
+			result = reduce(result, job.result);
+		}
+		catch(...)
+		{
+			state->set_exception(std::current_exception());
+		}
+	}
+
+	return result;
+}
+
+struct empty_result
+{
+};
+}
+
+//-----------------------------------------------------------------------------
+//  Name : parallel_for ()
+/// <summary>
+/// Calls fn(i) for every i in [begin, end) on the worker threads and the
+/// calling thread. Returns when every call has finished. A grain of 0 picks
+/// one automatically. The first exception thrown by fn is rethrown here.
+/// </summary>
+//-----------------------------------------------------------------------------
+template <typename F>
+void parallel_for(task_system& ts, std::size_t begin, std::size_t end, std::size_t grain, F&& fn)
+{
+	if(end <= begin)
+		return;
+
+	if(grain == 0)
+		grain = details::auto_grain(ts, end - begin);
+
+	using result_t = details::empty_result;
+
+	const auto leaf = [&fn](std::size_t first, std::size_t last, const result_t& r) {
+		for(std::size_t i = first; i < last; ++i)
+			fn(i);
+		return r;
+	};
+	const auto reduce = [](const result_t& r, const result_t&) { return r; };
+
+	auto state = std::make_shared<details::parallel_state>();
+	try
+	{
+		details::parallel_split(ts, state, begin, end, grain, result_t{}, leaf, reduce);
+	}
+	catch(...)
+	{
+		state->set_exception(std::current_exception());
+	}
+	state->rethrow();
+}
+
+//-----------------------------------------------------------------------------
+//  Name : parallel_reduce ()
+/// <summary>
+/// Computes reduce(... reduce(reduce(identity, fn(begin)), fn(begin + 1)) ...)
+/// in parallel. reduce must be associative, it does not need to be
+/// commutative since partial results are always combined left to right.
+/// </summary>
+//-----------------------------------------------------------------------------
+template <typename T, typename F, typename Reduce>
+T parallel_reduce(task_system& ts, std::size_t begin, std::size_t end, std::size_t grain, T identity,
+				  F&& fn, Reduce&& reduce)
+{
+	if(end <= begin)
+		return identity;
+
+	if(grain == 0)
+		grain = details::auto_grain(ts, end - begin);
+
+	const auto leaf = [&fn, &reduce](std::size_t first, std::size_t last, const T& init) {
+		T r = init;
+		for(std::size_t i = first; i < last; ++i)
+			r = reduce(r, fn(i));
+		return r;
+	};
+
+	auto state = std::make_shared<details::parallel_state>();
+	T result = identity;
+	try
+	{
+		result = details::parallel_split(ts, state, begin, end, grain, identity, leaf, reduce);
+	}
+	catch(...)
+	{
+		state->set_exception(std::current_exception());
+	}
+	state->rethrow();
+	return result;
+}
+
+//-----------------------------------------------------------------------------
+//  Name : parallel_transform ()
+/// <summary>
+/// Parallel std::transform for random access iterators.
+/// </summary>
+//-----------------------------------------------------------------------------
+template <typename InputIt, typename OutputIt, typename F>
+OutputIt parallel_transform(task_system& ts, InputIt first, InputIt last, OutputIt d_first, std::size_t grain,
+							F&& fn)
+{
+	const auto count = static_cast<std::size_t>(std::distance(first, last));
+	parallel_for(ts, 0, count, grain, [&first, &d_first, &fn](std::size_t i) {
+		using diff_in_t = typename std::iterator_traits<InputIt>::difference_type;
+		using diff_out_t = typename std::iterator_traits<OutputIt>::difference_type;
+		*(d_first + static_cast<diff_out_t>(i)) = fn(*(first + static_cast<diff_in_t>(i)));
+	});
+	return d_first + static_cast<typename std::iterator_traits<OutputIt>::difference_type>(count);
+}
+}
@@ -0,0 +1,190 @@
+#include "task_allocator.h"
+#include <mutex>
+#include <vector>
+
+namespace core
+{
+namespace details
+{
+namespace
+{
+constexpr std::size_t size_classes_count = 4;
+constexpr std::size_t min_block_size = 64;
+constexpr std::size_t max_block_size = min_block_size << (size_classes_count - 1);
+constexpr std::size_t slab_size = 32 * 1024;
+/// blocks moved between a thread cache and the shared list at once
+constexpr std::size_t batch_size = 32;
+
+struct free_block
+{
+	free_block* next;
+};
+
+inline std::size_t get_size_class(std::size_t size)
+{
+	std::size_t size_class = 0;
+	std::size_t block_size = min_block_size;
+	while(block_size < size)
+	{
+		block_size <<= 1;
+		++size_class;
+	}
+	return size_class;
+}
+
+inline std::size_t get_block_size(std::size_t size_class)
+{
+	return min_block_size << size_class;
+}
+
+struct shared_pool
+{
+	std::mutex mutex;
+	free_block* head = nullptr;
+};
+
+struct shared_pools
+{
+	shared_pool pools[size_classes_count];
+	std::atomic<std::size_t> system_allocations{0};
+	std::atomic<std::size_t> reserved_bytes{0};
+};
+
+shared_pools& get_shared_pools()
+{
+	// Intentionally never destroyed. Blocks may still be returned by threads
+	// and static objects that outlive it, and the slabs go away with the process.
+	static auto pools = new shared_pools();
+	return *pools;
+}
+
+free_block* allocate_slab(std::size_t size_class, std::size_t& count)
+{
+	auto& shared = get_shared_pools();
+	const std::size_t block_size = get_block_size(size_class);
+	count = slab_size / block_size;
+
+	auto memory = static_cast<char*>(::operator new(slab_size));
+	shared.system_allocations.fetch_add(1, std::memory_order_relaxed);
+	shared.reserved_bytes.fetch_add(slab_size, std::memory_order_relaxed);
+
+	free_block* head = nullptr;
+	for(std::size_t i = count; i-- > 0;)
+	{
+		auto block = reinterpret_cast<free_block*>(memory + i * block_size);
+		block->next = head;
+		head = block;
+	}
+	return head;
+}
+
+struct thread_cache
+{
+	~thread_cache()
+	{
+		for(std::size_t size_class = 0; size_class < size_classes_count; ++size_class)
+			release(size_class, counts[size_class]);
+	}
+
+	void* allocate(std::size_t size_class)
+	{
+		if(!heads[size_class])
+			refill(size_class);
+
+		auto block = heads[size_class];
+		heads[size_class] = block->next;
+		--counts[size_class];
+		return block;
+	}
+
+	void deallocate(void* p, std::size_t size_class)
+	{
+		auto block = static_cast<free_block*>(p);
+		block->next = heads[size_class];
+		heads[size_class] = block;
+		if(++counts[size_class] > batch_size * 2)
+			release(size_class, batch_size);
+	}
+
+	void refill(std::size_t size_class)
+	{
+		auto& pool = get_shared_pools().pools[size_class];
+		{
+			std::lock_guard<std::mutex> lock(pool.mutex);
+			std::size_t count = 0;
+			while(pool.head && count < batch_size)
+			{
+				auto block = pool.head;
+				pool.head = block->next;
+				block->next = heads[size_class];
+				heads[size_class] = block;
+				++count;
+			}
+			counts[size_class] += count;
+		}
+
+		if(!heads[size_class])
+			heads[size_class] = allocate_slab(size_class, counts[size_class]);
+	}
+
+	void release(std::size_t size_class, std::size_t count)
+	{
+		if(count == 0)
+			return;
+
+		// detach the first count blocks from the cache
+		auto first = heads[size_class];
+		auto last = first;
+		for(std::size_t i = 1; i < count; ++i)
+			last = last->next;
+		heads[size_class] = last->next;
+		counts[size_class] -= count;
+
+		auto& pool = get_shared_pools().pools[size_class];
+		std::lock_guard<std::mutex> lock(pool.mutex);
+		last->next = pool.head;
+		pool.head = first;
+	}
+
+	free_block* heads[size_classes_count] = {};
+	std::size_t counts[size_classes_count] = {};
+};
+
+thread_local thread_cache this_thread_cache;
+}
+
+void* task_allocator::allocate(std::size_t size)
+{
+	if(size > max_block_size)
+	{
+		get_shared_pools().system_allocations.fetch_add(1, std::memory_order_relaxed);
+		return ::operator new(size);
+	}
+
+	return this_thread_cache.allocate(get_size_class(size));
+}
+
+void task_allocator::deallocate(void* p, std::size_t size) noexcept
+{
+	if(!p)
+		return;
+
+	if(size > max_block_size)
+	{
+		::operator delete(p);
+		return;
+	}
+
+	this_thread_cache.deallocate(p, get_size_class(size));
+}
+
+task_allocator::stats task_allocator::get_stats() noexcept
+{
+	const auto& shared = get_shared_pools();
+	stats result;
+	result.system_allocations = shared.system_allocations.load(std::memory_order_relaxed);
+	result.reserved_bytes = shared.reserved_bytes.load(std::memory_order_relaxed);
+	return result;
+}
+}
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <utility>
+
+namespace core
+{
+namespace details
+{
+//-----------------------------------------------------------------------------
+// Main Class Declarations
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+//  Name : task_allocator (Class)
+/// <summary>
+/// Fixed size block allocator for task nodes and task states. Blocks are
+/// grouped in a few size classes. Each thread keeps a small cache of free
+/// blocks per size class, which is refilled from and spilled to a shared
+/// free list in batches. Memory is taken from the system in slabs, so once
+/// the caches are warm pushing tasks does not touch the heap. Requests bigger
+/// than the biggest size class fall back to the global operator new.
+/// </summary>
+//-----------------------------------------------------------------------------
+class task_allocator
+{
+public:
+	struct stats
+	{
+		/// number of times memory was requested from the system
+		std::size_t system_allocations = 0;
+		/// bytes reserved in slabs for the size classes
+		std::size_t reserved_bytes = 0;
+	};
+
+	//-----------------------------------------------------------------------------
+	//  Name : allocate ()
+	/// <summary>
+	/// Allocates a block of at least size bytes, aligned for any scalar type.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	static void* allocate(std::size_t size);
+
+	//-----------------------------------------------------------------------------
+	//  Name : deallocate ()
+	/// <summary>
+	/// Returns a block. size must be the one passed to allocate.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	static void deallocate(void* p, std::size_t size) noexcept;
+
+	//-----------------------------------------------------------------------------
+	//  Name : get_stats ()
+	/// <summary>
+	/// Approximate counters, for diagnostics.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	static stats get_stats() noexcept;
+};
+
+//-----------------------------------------------------------------------------
+//  Name : make_pooled ()
+/// <summary>
+/// Constructs a T in a block from the task_allocator.
+/// </summary>
+//-----------------------------------------------------------------------------
+template <typename T, typename... Args>
+T* make_pooled(Args&&... args)
+{
+	static_assert(alignof(T) <= alignof(std::max_align_t), "Over-aligned types are not supported.");
+	void* p = task_allocator::allocate(sizeof(T));
+	try
+	{
+		return new(p) T(std::forward<Args>(args)...);
+	}
+	catch(...)
+	{
+		task_allocator::deallocate(p, sizeof(T));
+		throw;
+	}
+}
+
+//-----------------------------------------------------------------------------
+//  Name : destroy_pooled ()
+/// <summary>
+/// Destroys a T created with make_pooled. T must be the dynamic type.
+/// </summary>
+//-----------------------------------------------------------------------------
+template <typename T>
+void destroy_pooled(T* p) noexcept
+{
+	p->~T();
+	task_allocator::deallocate(p, sizeof(T));
+}
+}
+}
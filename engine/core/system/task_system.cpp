@@ -7,34 +7,175 @@ namespace core
 
 task::task_concept::~task_concept() noexcept = default;
 
-void task_system::task_queue::sort()
+void task::task_concept::release_dependency() noexcept
 {
-	if(_tasks.size() > 1)
+	if(_dependencies.fetch_sub(1, std::memory_order_acq_rel) == 1)
+		_system->schedule(task{this}, _queue_index);
+}
+
+namespace
+{
+struct wait_slot
+{
+	std::mutex mutex;
+	std::condition_variable cv;
+};
+
+//-----------------------------------------------------------------------------
+//  Name : get_wait_slot ()
+/// <summary>
+/// Blocking waits on task states are rare, so all states share a small table
+/// of condition variables picked by address.
+/// </summary>
+//-----------------------------------------------------------------------------
+wait_slot& get_wait_slot(const void* address)
+{
+	constexpr std::size_t slots_count = 64;
+	// never destroyed, states may be waited on during static destruction
+	static auto slots = new wait_slot[slots_count];
+	const auto hash = reinterpret_cast<std::uintptr_t>(address) / sizeof(void*);
+	return slots[hash % slots_count];
+}
+}
+
+void details::task_state_base::then(task_continuation* continuation) noexcept
+{
+	auto head = _continuations.load(std::memory_order_acquire);
+	do
+	{
+		if(head == completed_marker())
+		{
+			continuation->run();
+			return;
+		}
+		continuation->next = head;
+	} while(!_continuations.compare_exchange_weak(head, continuation, std::memory_order_release,
+												  std::memory_order_acquire));
+}
+
+void details::task_state_base::complete_() noexcept
+{
+	auto head = _continuations.exchange(completed_marker(), std::memory_order_seq_cst);
+	while(head)
+	{
+		// the continuation may free the node
+		auto next = head->next;
+		head->run();
+		head = next;
+	}
+
+	if(_waiters.load(std::memory_order_seq_cst) != 0)
 	{
-		std::stable_partition(_tasks.begin(), _tasks.end(), [](const auto& task1) { return task1.ready(); });
+		auto& slot = get_wait_slot(this);
+		{
+			// a waiter that has checked the state but not yet blocked holds the lock
+			std::lock_guard<std::mutex> lock(slot.mutex);
+		}
+		slot.cv.notify_all();
 	}
 }
 
-task_system::task_queue::task_queue()
-	: _tasks{}
+void details::task_state_base::wait() const
 {
+	if(is_ready())
+		return;
+
+	auto& slot = get_wait_slot(this);
+	_waiters.fetch_add(1, std::memory_order_seq_cst);
+	{
+		std::unique_lock<std::mutex> lock(slot.mutex);
+		slot.cv.wait(lock, [this]() {
+			return _continuations.load(std::memory_order_seq_cst) == completed_marker();
+		});
+	}
+	_waiters.fetch_sub(1, std::memory_order_relaxed);
 }
 
-task_system::task_queue::task_queue(task_system::task_queue&& other) noexcept
-	: _tasks(std::move(other)._tasks)
-	, _done(other._done.load())
+bool details::task_state_base::wait_for(std::chrono::nanoseconds rel_time) const
 {
+	if(is_ready())
+		return true;
+
+	auto& slot = get_wait_slot(this);
+	_waiters.fetch_add(1, std::memory_order_seq_cst);
+	bool ready = false;
+	{
+		std::unique_lock<std::mutex> lock(slot.mutex);
+		ready = slot.cv.wait_for(lock, rel_time, [this]() {
+			return _continuations.load(std::memory_order_seq_cst) == completed_marker();
+		});
+	}
+	_waiters.fetch_sub(1, std::memory_order_relaxed);
+	return ready;
+}
+
+namespace
+{
+struct thread_context
+{
+	const task_system* system = nullptr;
+	std::size_t index = 0;
+};
+
+thread_local thread_context this_thread_context;
+}
+
+task_system::task_queue::~task_queue()
+{
+	clear();
+}
+
+std::size_t task_system::task_queue::lane::get_pending_tasks() const
+{
+	return local.size() + inbox_size.load(std::memory_order_relaxed);
+}
+
+bool task_system::task_queue::clear()
+{
+	bool cleared = false;
+	for(auto& l : _lanes)
+	{
+		task::task_concept* t = nullptr;
+		while(l.local.pop(t))
+		{
+			task discarded{t};
+			cleared = true;
+		}
+
+		while(true)
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			auto p = try_pop_inbox(l, lock);
+			if(!p.first)
+				break;
+
+			// destroyed outside of the lock, it may push to this queue again
+			lock.unlock();
+			cleared = true;
+		}
+	}
+	return cleared;
 }
 
 std::size_t task_system::task_queue::get_pending_tasks() const
 {
-	std::lock_guard<std::mutex> lock(_mutex);
-	return _tasks.size();
+	std::size_t pending = 0;
+	for(const auto& l : _lanes)
+		pending += l.get_pending_tasks();
+	return pending;
+}
+
+std::size_t task_system::task_queue::get_pending_tasks(task_priority priority) const
+{
+	return _lanes[static_cast<std::size_t>(priority)].get_pending_tasks();
 }
 
 void task_system::task_queue::set_done()
 {
-	_done.store(true);
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_done.store(true);
+	}
 	_cv.notify_all();
 }
 
@@ -43,45 +184,108 @@ bool task_system::task_queue::is_done() const
 	return _done.load();
 }
 
-std::pair<bool, task> task_system::task_queue::try_pop()
+task_system::task_queue::lane& task_system::task_queue::get_lane(const task& t)
 {
-	std::unique_lock<std::mutex> lock(_mutex, std::try_to_lock);
+	return _lanes[static_cast<std::size_t>(t._t->_priority)];
+}
 
-	if(!lock || _tasks.empty())
+void task_system::task_queue::push_local(task t)
+{
+	auto& l = get_lane(t);
+	l.local.push(t.release());
+}
+
+void task_system::task_queue::push(task t)
+{
+	auto& l = get_lane(t);
 	{
-		return std::make_pair(false, task{});
+		std::unique_lock<std::mutex> lock(_mutex);
+		if(l.inbox_count == l.inbox.size())
+		{
+			// grow, keeping the size a power of two
+			std::vector<task::task_concept*> inbox(std::max<std::size_t>(l.inbox.size() * 2, 64));
+			for(std::size_t i = 0; i < l.inbox_count; ++i)
+				inbox[i] = l.inbox[(l.inbox_head + i) & (l.inbox.size() - 1)];
+			l.inbox.swap(inbox);
+			l.inbox_head = 0;
+		}
+
+		l.inbox[(l.inbox_head + l.inbox_count) & (l.inbox.size() - 1)] = t.release();
+		++l.inbox_count;
+		l.inbox_size.store(l.inbox_count, std::memory_order_relaxed);
 	}
-	else if(_tasks.front().ready())
+	_cv.notify_one();
+}
+
+std::pair<bool, task> task_system::task_queue::try_pop_inbox(lane& l, std::unique_lock<std::mutex>&)
+{
+	if(l.inbox_count == 0)
+		return std::make_pair(false, task{});
+
+	task t{l.inbox[l.inbox_head]};
+	l.inbox_head = (l.inbox_head + 1) & (l.inbox.size() - 1);
+	--l.inbox_count;
+	l.inbox_size.store(l.inbox_count, std::memory_order_relaxed);
+	return std::make_pair(true, std::move(t));
+}
+
+bool task_system::task_queue::has_inbox_tasks(std::unique_lock<std::mutex>&) const
+{
+	for(const auto& l : _lanes)
 	{
-		auto t = std::move(_tasks.front());
-		_tasks.pop_front();
-		return std::make_pair(true, std::move(t));
+		if(l.inbox_count != 0)
+			return true;
 	}
+	return false;
+}
 
-	sort();
-	return std::make_pair(false, task{});
+std::pair<bool, task> task_system::task_queue::pop_lane(lane& l, bool wait_for_lock)
+{
+	task::task_concept* t = nullptr;
+	if(l.local.pop(t))
+		return std::make_pair(true, task{t});
+
+	if(l.inbox_size.load(std::memory_order_relaxed) == 0)
+		return std::make_pair(false, task{});
+
+	std::unique_lock<std::mutex> lock(_mutex, std::defer_lock);
+	if(wait_for_lock)
+		lock.lock();
+	else if(!lock.try_lock())
+		return std::make_pair(false, task{});
+
+	return try_pop_inbox(l, lock);
 }
 
-bool task_system::task_queue::try_push(task& t)
+std::pair<bool, task> task_system::task_queue::try_pop()
 {
+	for(auto& l : _lanes)
 	{
-		std::unique_lock<std::mutex> lock(_mutex, std::try_to_lock);
-		if(!lock)
-			return false;
-
-		_tasks.emplace_back(std::move(t));
+		auto p = pop_lane(l, false);
+		if(p.first)
+			return p;
 	}
+	return std::make_pair(false, task{});
+}
 
-	_cv.notify_one();
-	return true;
+std::pair<bool, task> task_system::task_queue::try_pop(task_priority priority)
+{
+	return pop_lane(_lanes[static_cast<std::size_t>(priority)], true);
 }
 
 std::pair<bool, task> task_system::task_queue::pop(duration_t pop_timeout)
 {
+	for(auto& l : _lanes)
+	{
+		auto p = pop_lane(l, true);
+		if(p.first)
+			return p;
+	}
+
 	std::unique_lock<std::mutex> lock(_mutex);
 	bool wait = pop_timeout > decltype(pop_timeout)(0);
 	bool timed_wait = pop_timeout != decltype(pop_timeout)::max();
-	if(wait && _tasks.empty())
+	if(wait && !has_inbox_tasks(lock) && !_done.load())
 	{
 		if(timed_wait)
 		{
@@ -93,82 +297,348 @@ std::pair<bool, task> task_system::task_queue::pop(duration_t pop_timeout)
 		}
 	}
 
-	if(_tasks.empty())
-		return std::make_pair(false, task{});
-
-	if(_tasks.front().ready())
+	for(auto& l : _lanes)
 	{
-		auto t = std::move(_tasks.front());
-		_tasks.pop_front();
-		return std::make_pair(true, std::move(t));
+		auto p = try_pop_inbox(l, lock);
+		if(p.first)
+			return p;
 	}
-	else
+	return std::make_pair(false, task{});
+}
+
+std::pair<bool, task> task_system::task_queue::pop_shared()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	_cv.wait(lock, [this, &lock]() { return has_inbox_tasks(lock) || _done.load(); });
+
+	for(auto& l : _lanes)
 	{
-		sort();
+		auto p = try_pop_inbox(l, lock);
+		if(p.first)
+			return p;
 	}
+	return std::make_pair(false, task{});
+}
 
-	// try after sort
-	if(_tasks.front().ready())
+std::pair<bool, task> task_system::task_queue::steal()
+{
+	for(auto& l : _lanes)
 	{
-		auto t = std::move(_tasks.front());
-		_tasks.pop_front();
-		return std::make_pair(true, std::move(t));
+		task::task_concept* t = nullptr;
+		if(l.local.steal(t))
+			return std::make_pair(true, task{t});
+
+		if(l.inbox_size.load(std::memory_order_relaxed) == 0)
+			continue;
+
+		std::unique_lock<std::mutex> lock(_mutex, std::try_to_lock);
+		if(!lock)
+			continue;
+
+		auto p = try_pop_inbox(l, lock);
+		if(p.first)
+			return p;
 	}
+	return std::make_pair(false, task{});
+}
+
+void task_system::schedule(task t, std::size_t queue_index)
+{
+#if TASK_SYSTEM_TRACING
+	if(details::task_trace::is_enabled())
+		t._t->_enqueued = details::task_trace::now();
+#endif
+
+	auto& queue = *_queues[queue_index];
+	if(get_current_thread_idx() == queue_index && queue_index != get_io_queue_idx())
+		queue.push_local(std::move(t));
+	else
+		queue.push(std::move(t));
+
+	// the io threads wait on their queue directly
+	if(queue_index != get_io_queue_idx())
+		wake(queue_index);
+}
+
+bool task_system::push_when_ready(task& t, std::size_t queue_index)
+{
+	auto parked = t._t.get();
+	parked->_system = this;
+	parked->_queue_index = queue_index;
+	// one extra dependency held while registering so that a dependency completing
+	// in the middle cannot schedule the task early
+	parked->_dependencies.store(1, std::memory_order_relaxed);
+
+	if(parked->await_() == 0)
+		return false;
+
+	// from now on the task is owned by its dependencies
+	t.release();
+	parked->release_dependency();
+	return true;
+}
+
+std::pair<bool, task> task_system::try_steal(std::size_t thief_idx)
+{
+	// rotating start so that thieves do not all hammer the same victim
+	thread_local std::size_t seed = 0;
+	const std::size_t workers = _threads_count - 1;
+	for(std::size_t k = 0; k < workers; ++k)
+	{
+		const std::size_t victim_idx = 1 + ((seed + k) % workers);
+		if(victim_idx == thief_idx)
+			continue;
+
+		auto& victim = *_queues[victim_idx];
+		if(victim.get_pending_tasks() == 0)
+			continue;
 
+		auto p = victim.steal();
+		if(p.first)
+		{
+			seed = victim_idx;
+			return p;
+		}
+	}
+	++seed;
 	return std::make_pair(false, task{});
 }
 
-void task_system::task_queue::push(task t)
+void task_system::run_io()
 {
+	auto& queue = *_queues[get_io_queue_idx()];
+	while(true)
 	{
-		std::unique_lock<std::mutex> lock(_mutex);
-		_tasks.emplace_back(std::move(t));
+		auto p = queue.pop_shared();
+		if(p.first)
+			invoke(p.second);
+		else if(queue.is_done())
+			return;
 	}
-	_cv.notify_one();
 }
 
-void task_system::run(std::size_t idx, std::function<bool()> condition, duration_t pop_timeout)
+//-----------------------------------------------------------------------------
+//  Name : wake_continuation (Class)
+/// <summary>
+/// Wakes up a thread parked while waiting on a future. Shared by the future
+/// state, which runs it on completion, and by the waiting thread, which may
+/// stop waiting before that.
+/// </summary>
+//-----------------------------------------------------------------------------
+struct task_system::wake_continuation final : details::task_continuation
 {
+	wake_continuation(task_system* s, std::size_t index)
+		: system(s)
+		, queue_index(index)
+	{
+	}
+
+	void run() noexcept override
+	{
+		system->unpark(queue_index);
+		release();
+	}
+
+	void release() noexcept
+	{
+		if(refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+			details::destroy_pooled(this);
+	}
+
+	task_system* system = nullptr;
+	std::size_t queue_index = 0;
+	std::atomic<int> refs{2};
+};
+
+void task_system::run(std::size_t idx, const std::function<bool()>& condition,
+					  details::task_state_base* awaited)
+{
+	const auto queue_index = get_thread_queue_idx(idx);
+	auto& queue = *_queues[queue_index];
+	wake_continuation* wake_node = nullptr;
+
 	while(condition())
 	{
-		const auto queue_index = get_thread_queue_idx(idx);
-		bool is_done = _queues[queue_index].is_done();
-		bool is_empty = _queues[queue_index].get_pending_tasks() == 0;
-		if(is_done && is_empty)
-			return;
+		auto p = queue.try_pop();
 
-		std::pair<bool, task> p = {false, task()};
+		if(!p.first && queue_index != get_owner_thread_idx())
+			p = try_steal(queue_index);
 
-		if(idx != 0 && is_empty)
+		if(p.first)
 		{
-			std::size_t steal_attempts = _threads_count;
-			const auto queue_idx = get_most_free_queue_idx(true);
-			for(std::size_t k = 0; k < steal_attempts; ++k)
-			{
-				if(queue_index != queue_idx)
-				{
-					p = _queues[queue_idx].try_pop();
-					if(p.first)
-					{
-						break;
-					}
-				}
-			}
+			invoke(p.second);
+			continue;
 		}
 
-		if(!p.first)
-			p = _queues[queue_index].pop(pop_timeout);
+		if(queue.is_done() && queue.get_pending_tasks() == 0)
+			break;
 
-		if(p.first)
-			p.second();
+		if(spin(queue_index, condition))
+			continue;
+
+		// only registered once the thread really is about to sleep
+		if(awaited && !wake_node)
+		{
+			wake_node = details::make_pooled<wake_continuation>(this, queue_index);
+			awaited->then(wake_node);
+		}
+
+		park(queue_index, condition);
+	}
+
+	if(wake_node)
+		wake_node->release();
+}
+
+#if TASK_SYSTEM_TRACING
+void task_system::invoke_traced(task& t)
+{
+	const auto model = t._t.get();
+	if(!model)
+		return;
+
+	const auto thread_index = get_current_thread_idx();
+
+	details::task_event e;
+	e.name = model->_name;
+	e.enqueued = model->_enqueued;
+	e.queue_index = static_cast<std::uint32_t>(model->_queue_index);
+	e.thread_index = static_cast<std::uint32_t>(thread_index);
+	e.stolen = e.enqueued != 0 && thread_index != model->_queue_index;
+
+	// tasks pushed from inside inherit the name
+	const auto previous = details::task_trace::set_current_name(e.name);
+	e.start = details::task_trace::now();
+	t();
+	e.end = details::task_trace::now();
+	details::task_trace::set_current_name(previous);
+
+	details::task_trace::record(e);
+}
+#endif
+
+bool task_system::has_work(std::size_t queue_index) const
+{
+	if(_queues[queue_index]->get_pending_tasks() > 0)
+		return true;
+
+	// the owner thread does not steal
+	if(queue_index == get_owner_thread_idx())
+		return false;
+
+	for(std::size_t i = 1; i < _threads_count; ++i)
+	{
+		if(_queues[i]->get_pending_tasks() > 0)
+			return true;
 	}
+	return false;
+}
+
+bool task_system::spin(std::size_t queue_index, const std::function<bool()>& condition)
+{
+	constexpr std::size_t min_spin = 64;
+	constexpr std::size_t max_spin = 16 * 1024;
+
+	auto& slot = *_parking[queue_index];
+	for(std::size_t i = 0; i < slot.spin_limit; ++i)
+	{
+		if(has_work(queue_index) || !condition())
+		{
+			slot.spin_limit = std::min(slot.spin_limit * 2, max_spin);
+			return true;
+		}
+		platform::cpu_relax();
+	}
+
+	slot.spin_limit = std::max(slot.spin_limit / 2, min_spin);
+	return false;
+}
+
+void task_system::park(std::size_t queue_index, const std::function<bool()>& condition)
+{
+	auto& slot = *_parking[queue_index];
+	auto& queue = *_queues[queue_index];
+
+	const auto remove_idle = [this, queue_index]() {
+		std::lock_guard<std::mutex> lock(_idle_mutex);
+		auto it = std::find(std::begin(_idle), std::end(_idle), queue_index);
+		if(it != std::end(_idle))
+		{
+			_idle.erase(it);
+			_idle_count.store(_idle.size(), std::memory_order_relaxed);
+		}
+	};
+
+	{
+		std::lock_guard<std::mutex> lock(_idle_mutex);
+		_idle.push_back(queue_index);
+		_idle_count.store(_idle.size(), std::memory_order_relaxed);
+	}
+
+	// pairs with the fence in wake, either the pusher sees this thread as idle
+	// or this thread sees the pushed task
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+
+	if(has_work(queue_index) || !condition() || queue.is_done())
+	{
+		remove_idle();
+		return;
+	}
+
+	{
+		std::unique_lock<std::mutex> lock(slot.mutex);
+		slot.cv.wait(lock, [&slot, &queue]() { return slot.signaled || queue.is_done(); });
+		slot.signaled = false;
+	}
+
+	// still listed if woken up by something else than wake
+	remove_idle();
+}
+
+void task_system::unpark(std::size_t queue_index)
+{
+	auto& slot = *_parking[queue_index];
+	{
+		std::lock_guard<std::mutex> lock(slot.mutex);
+		slot.signaled = true;
+	}
+	slot.cv.notify_one();
+}
+
+void task_system::wake(std::size_t queue_index)
+{
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if(_idle_count.load(std::memory_order_relaxed) == 0)
+		return;
+
+	std::size_t target = invalid_index;
+	{
+		std::lock_guard<std::mutex> lock(_idle_mutex);
+		auto it = std::find(std::begin(_idle), std::end(_idle), queue_index);
+
+		// any worker can steal from a worker queue, only the owner can run its tasks
+		if(it == std::end(_idle) && queue_index != get_owner_thread_idx())
+		{
+			it = std::find_if(std::begin(_idle), std::end(_idle),
+							  [this](std::size_t idx) { return idx != get_owner_thread_idx(); });
+		}
+
+		if(it == std::end(_idle))
+			return;
+
+		target = *it;
+		_idle.erase(it);
+		_idle_count.store(_idle.size(), std::memory_order_relaxed);
+	}
+
+	unpark(target);
 }
 
 std::size_t task_system::get_thread_queue_idx(std::size_t idx, std::size_t seed)
 {
-	// if owner thread then just return
-	if(idx == get_owner_thread_idx())
-		return get_owner_thread_idx();
+	// if owner thread or io then just return
+	if(idx == get_owner_thread_idx() || idx == get_io_queue_idx())
+		return idx;
 
 	auto queue_index = ((idx + seed) % _threads_count);
 
@@ -178,6 +648,57 @@ std::size_t task_system::get_thread_queue_idx(std::size_t idx, std::size_t seed)
 	return queue_index;
 }
 
+std::size_t task_system::get_current_thread_idx() const
+{
+	if(this_thread_context.system == this)
+		return this_thread_context.index;
+
+	if(std::this_thread::get_id() == _owner_thread_id)
+		return get_owner_thread_idx();
+
+	return invalid_index;
+}
+
+std::size_t task_system::get_most_busy_queue_idx(bool skip_owner) const
+{
+	if(_threads_count == 1)
+		return get_owner_thread_idx();
+
+	std::size_t most_busy_idx = skip_owner ? 1 : 0;
+	std::size_t most_pending = 0;
+	for(std::size_t i = most_busy_idx; i < _threads_count; ++i)
+	{
+		const auto pending = _queues[i]->get_pending_tasks();
+		if(pending > most_pending)
+		{
+			most_pending = pending;
+			most_busy_idx = i;
+		}
+	}
+	return most_busy_idx;
+}
+
+std::size_t task_system::get_most_free_queue_idx(bool skip_owner) const
+{
+	if(_threads_count == 1)
+		return get_owner_thread_idx();
+
+	std::size_t most_free_idx = skip_owner ? 1 : 0;
+	std::size_t least_pending = std::numeric_limits<std::size_t>::max();
+	for(std::size_t i = most_free_idx; i < _threads_count; ++i)
+	{
+		const auto pending = _queues[i]->get_pending_tasks();
+		if(pending < least_pending)
+		{
+			least_pending = pending;
+			most_free_idx = i;
+			if(pending == 0)
+				break;
+		}
+	}
+	return most_free_idx;
+}
+
 std::thread::id task_system::get_thread_id(std::size_t index)
 {
 	const auto& thread = _threads[index];
@@ -192,25 +713,61 @@ task_system::task_system()
 {
 }
 
-task_system::task_system(std::size_t nthreads, const task_system::allocator_t& alloc)
-	: _alloc(alloc)
-	, _threads_count{nthreads}
+task_system::task_system(std::size_t nthreads, std::size_t nio_threads, bool pin_threads)
+	: _threads_count{nthreads}
 {
-	_queues.reserve(_threads_count);
-	_queues.emplace_back();
+	_parking.reserve(_threads_count);
+	for(std::size_t th = 0; th < _threads_count; ++th)
+	{
+		_parking.emplace_back(std::make_unique<parking_slot>());
+	}
+	_idle.reserve(_threads_count);
+
+#if TASK_SYSTEM_TRACING
+	details::task_trace::set_thread_name("task_owner");
+#endif
+
+	_queues.reserve(_threads_count + 1);
+	_queues.emplace_back(std::make_unique<task_queue>());
 	for(std::size_t th = 1; th < _threads_count; ++th)
 	{
-		_queues.emplace_back();
+		_queues.emplace_back(std::make_unique<task_queue>());
 	}
+	// io queue
+	_queues.emplace_back(std::make_unique<task_queue>());
 
 	// two seperate loops.
 	_threads.reserve(_threads_count);
 	_threads.emplace_back();
-	using namespace std::literals;
+	const std::size_t cores = std::max<std::size_t>(std::thread::hardware_concurrency(), 1);
 	for(std::size_t th = 1; th < _threads_count; ++th)
 	{
-		_threads.emplace_back(&task_system::run, this, th, []() { return true; }, 50ms);
+		_threads.emplace_back([this, th]() {
+			this_thread_context.system = this;
+			this_thread_context.index = th;
+#if TASK_SYSTEM_TRACING
+			details::task_trace::set_thread_name("task_worker " + std::to_string(th));
+#endif
+			run(th, []() { return true; });
+		});
         platform::set_thread_name(_threads.back(), "task_worker");
+		// the owner thread is left on core 0
+		if(pin_threads)
+			platform::set_thread_affinity(_threads.back(), th % cores);
+	}
+
+	_io_threads.reserve(nio_threads);
+	for(std::size_t th = 0; th < nio_threads; ++th)
+	{
+		_io_threads.emplace_back([this]() {
+			this_thread_context.system = this;
+			this_thread_context.index = get_io_queue_idx();
+#if TASK_SYSTEM_TRACING
+			details::task_trace::set_thread_name("task_io");
+#endif
+			run_io();
+		});
+		platform::set_thread_name(_io_threads.back(), "task_io");
 	}
 }
 
@@ -222,40 +779,134 @@ task_system::~task_system()
 		if(th.joinable())
 			th.join();
 	}
+	for(auto& th : _io_threads)
+	{
+		if(th.joinable())
+			th.join();
+	}
+
+	// Destroying a task that never ran breaks its future, which may schedule
+	// tasks that were waiting on it, so keep going until every queue is empty.
+	bool cleared = true;
+	while(cleared)
+	{
+		cleared = false;
+		for(auto& q : _queues)
+			cleared |= q->clear();
+	}
 }
 
 void core::task_system::dispose()
 {
 	for(auto& q : _queues)
-		q.set_done();
+		q->set_done();
+
+	for(std::size_t i = 0; i < _parking.size(); ++i)
+		unpark(i);
 }
 
-void task_system::run_on_owner_thread()
+bool task_system::run_on_owner_thread()
 {
 	std::pair<bool, task> p = {false, task()};
 
 	const auto queue_index = get_thread_queue_idx(0);
 
 	using namespace std::literals;
-	p = _queues[queue_index].pop(0ms);
+	p = _queues[queue_index]->pop(0ms);
 	if(!p.first)
-		return;
+		return false;
 
-	if(p.first)
-		p.second();
+	invoke(p.second);
+	return true;
+}
+
+void task_system::run_on_owner_thread(duration_t budget)
+{
+	using clock_t = std::chrono::steady_clock;
+	const auto start = clock_t::now();
+
+	auto& queue = *_queues[get_thread_queue_idx(0)];
+	std::size_t ran = 0;
+
+	// Only the critical tasks queued so far, so that one that keeps pushing
+	// itself cannot stall the frame.
+	auto critical = queue.get_pending_tasks(task_priority::critical);
+	while(critical-- > 0)
+	{
+		auto p = queue.try_pop(task_priority::critical);
+		if(!p.first)
+			break;
+
+		invoke(p.second);
+		++ran;
+	}
+
+	using namespace std::literals;
+	while(clock_t::now() - start < budget)
+	{
+		auto p = queue.pop(0ms);
+		if(!p.first)
+			break;
+
+		invoke(p.second);
+		++ran;
+	}
+
+	_owner_tasks_ran.store(ran, std::memory_order_relaxed);
+	_owner_tasks_deferred.store(queue.get_pending_tasks(), std::memory_order_relaxed);
+}
+
+std::size_t task_system::get_pending_tasks() const
+{
+	std::size_t pending = 0;
+	for(std::size_t i = 0; i < _threads_count; ++i)
+		pending += _queues[i]->get_pending_tasks();
+	return pending;
+}
+
+bool task_system::run_pending_task()
+{
+	const auto queue_index = get_current_thread_idx();
+	if(queue_index == invalid_index || queue_index == get_io_queue_idx())
+		return false;
+
+	std::pair<bool, task> p;
+	if(queue_index != get_owner_thread_idx())
+		p = _queues[queue_index]->try_pop();
+	if(!p.first)
+		p = try_steal(queue_index);
+	if(!p.first)
+		return false;
+
+	invoke(p.second);
+	return true;
 }
 
 task_system::system_info task_system::get_info() const
 {
+	const auto get_queue_info = [](const task_queue& queue) {
+		queue_info q_info;
+		for(std::size_t priority = 0; priority < task_priorities_count; ++priority)
+		{
+			const auto pending = queue.get_pending_tasks(static_cast<task_priority>(priority));
+			q_info.pending_by_priority[priority] = pending;
+			q_info.pending_tasks += pending;
+		}
+		return q_info;
+	};
+
 	system_info info;
-	info.queue_infos.reserve(_queues.size());
-	for(const auto& queue : _queues)
+	info.queue_infos.reserve(_threads_count);
+	for(std::size_t i = 0; i < _threads_count; ++i)
 	{
-		queue_info q_info;
-		q_info.pending_tasks = queue.get_pending_tasks();
+		auto q_info = get_queue_info(*_queues[i]);
 		info.pending_tasks += q_info.pending_tasks;
 		info.queue_infos.emplace_back(std::move(q_info));
 	}
+	info.io_queue_info = get_queue_info(*_queues[get_io_queue_idx()]);
+	info.pending_tasks += info.io_queue_info.pending_tasks;
+	info.owner_tasks_ran = _owner_tasks_ran.load(std::memory_order_relaxed);
+	info.owner_tasks_deferred = _owner_tasks_deferred.load(std::memory_order_relaxed);
 	return info;
 }
 }
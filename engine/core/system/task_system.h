@@ -4,24 +4,353 @@
 #include "../common/nonstd/function_traits.hpp"
 #include "../common/nonstd/type_traits.hpp"
 #include "subsystem.h"
+#include "task_allocator.h"
+#include "task_trace.h"
+#include "work_stealing_deque.h"
 #include <algorithm>
+#include <array>
 #include <atomic>
 #include <chrono>
 #include <condition_variable>
 #include <cstddef>
 #include <cstdint>
-#include <deque>
 #include <exception>
+#include <functional>
 #include <future>
 #include <memory>
 #include <mutex>
 #include <thread>
+#include <type_traits>
 #include <utility>
 #include <vector>
 namespace core
 {
 class task_system;
 
+//-----------------------------------------------------------------------------
+//  Name : task_priority (Enum)
+/// <summary>
+/// Order in which queued tasks are picked. Critical tasks on the owner thread
+/// are never deferred by the frame budget, background tasks only run when
+/// nothing else is pending.
+/// </summary>
+//-----------------------------------------------------------------------------
+enum class task_priority : std::uint8_t
+{
+	critical,
+	normal,
+	background,
+};
+
+constexpr std::size_t task_priorities_count = 3;
+
+namespace details
+{
+//-----------------------------------------------------------------------------
+//  Name : task_continuation (Class)
+/// <summary>
+/// Intrusive node of a task state continuation list. The node is owned by
+/// whoever registers it and must stay alive until it has been run.
+/// </summary>
+//-----------------------------------------------------------------------------
+struct task_continuation
+{
+	virtual void run() noexcept = 0;
+
+	task_continuation* next = nullptr;
+
+protected:
+	~task_continuation() = default;
+};
+
+//-----------------------------------------------------------------------------
+//  Name : task_state_base (Class)
+/// <summary>
+/// Completion state shared between a task and its futures. Reference counted
+/// and allocated from the task_allocator. Continuations are kept in a
+/// lock-free intrusive list, continuations registered after completion run
+/// immediately on the registering thread. Threads that have to block on it
+/// wait on one of a few shared condition variables, so a state carries no
+/// synchronization objects of its own.
+/// </summary>
+//-----------------------------------------------------------------------------
+class task_state_base
+{
+public:
+	task_state_base() = default;
+	task_state_base(const task_state_base&) = delete;
+	task_state_base& operator=(const task_state_base&) = delete;
+	virtual ~task_state_base() = default;
+
+	void add_ref() noexcept
+	{
+		_refs.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	void release() noexcept
+	{
+		if(_refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+			destroy_();
+	}
+
+	bool is_ready() const noexcept
+	{
+		return _continuations.load(std::memory_order_acquire) == completed_marker();
+	}
+
+	//-----------------------------------------------------------------------------
+	//  Name : then ()
+	/// <summary>
+	/// Registers a continuation to be run when the state completes.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	void then(task_continuation* continuation) noexcept;
+
+	//-----------------------------------------------------------------------------
+	//  Name : wait ()
+	/// <summary>
+	/// Blocks the calling thread until the state completes.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	void wait() const;
+
+	//-----------------------------------------------------------------------------
+	//  Name : wait_for ()
+	/// <summary>
+	/// Blocks the calling thread until the state completes or the time runs
+	/// out. Returns whether the state completed.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	bool wait_for(std::chrono::nanoseconds rel_time) const;
+
+	void set_exception(std::exception_ptr e) noexcept
+	{
+		_exception = std::move(e);
+		complete_();
+	}
+
+protected:
+	//-----------------------------------------------------------------------------
+	//  Name : complete_ ()
+	/// <summary>
+	/// Marks the state as completed, runs all registered continuations on the
+	/// calling thread and wakes up blocked waiters.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	void complete_() noexcept;
+
+	void rethrow_if_exception_() const
+	{
+		if(_exception)
+			std::rethrow_exception(_exception);
+	}
+
+	virtual void destroy_() noexcept = 0;
+
+	static task_continuation* completed_marker() noexcept
+	{
+		return reinterpret_cast<task_continuation*>(std::uintptr_t(1));
+	}
+
+private:
+	std::atomic<task_continuation*> _continuations{nullptr};
+	std::atomic<std::uint32_t> _refs{1};
+	mutable std::atomic<std::uint32_t> _waiters{0};
+	std::exception_ptr _exception;
+};
+
+template <typename T>
+class task_state : public task_state_base
+{
+public:
+	~task_state() override
+	{
+		if(_has_value)
+			reinterpret_cast<T*>(&_storage)->~T();
+	}
+
+	template <typename U>
+	void set_value(U&& value)
+	{
+		new(&_storage) T(std::forward<U>(value));
+		_has_value = true;
+		complete_();
+	}
+
+	const T& get() const
+	{
+		rethrow_if_exception_();
+		return *reinterpret_cast<const T*>(&_storage);
+	}
+
+private:
+	void destroy_() noexcept override
+	{
+		destroy_pooled(this);
+	}
+
+	typename std::aligned_storage<sizeof(T), alignof(T)>::type _storage;
+	bool _has_value = false;
+};
+
+template <typename T>
+class task_state<T&> : public task_state_base
+{
+public:
+	void set_value(T& value)
+	{
+		_value = &value;
+		complete_();
+	}
+
+	T& get() const
+	{
+		rethrow_if_exception_();
+		return *_value;
+	}
+
+private:
+	void destroy_() noexcept override
+	{
+		destroy_pooled(this);
+	}
+
+	T* _value = nullptr;
+};
+
+template <>
+class task_state<void> : public task_state_base
+{
+public:
+	void set_value()
+	{
+		complete_();
+	}
+
+	void get() const
+	{
+		rethrow_if_exception_();
+	}
+
+private:
+	void destroy_() noexcept override
+	{
+		destroy_pooled(this);
+	}
+};
+
+//-----------------------------------------------------------------------------
+//  Name : task_state_ptr (Class)
+/// <summary>
+/// Owning pointer to a task_state, copies share the state.
+/// </summary>
+//-----------------------------------------------------------------------------
+template <typename T>
+class task_state_ptr
+{
+public:
+	task_state_ptr() = default;
+
+	explicit task_state_ptr(task_state<T>* state) noexcept
+		: _state(state)
+	{
+	}
+
+	task_state_ptr(const task_state_ptr& other) noexcept
+		: _state(other._state)
+	{
+		if(_state)
+			_state->add_ref();
+	}
+
+	task_state_ptr(task_state_ptr&& other) noexcept
+		: _state(other._state)
+	{
+		other._state = nullptr;
+	}
+
+	task_state_ptr& operator=(task_state_ptr other) noexcept
+	{
+		std::swap(_state, other._state);
+		return *this;
+	}
+
+	~task_state_ptr()
+	{
+		reset();
+	}
+
+	void reset() noexcept
+	{
+		if(_state)
+			_state->release();
+		_state = nullptr;
+	}
+
+	task_state<T>& operator*() const noexcept
+	{
+		return *_state;
+	}
+
+	task_state<T>* operator->() const noexcept
+	{
+		return _state;
+	}
+
+	task_state<T>* get() const noexcept
+	{
+		return _state;
+	}
+
+	explicit operator bool() const noexcept
+	{
+		return _state != nullptr;
+	}
+
+private:
+	task_state<T>* _state = nullptr;
+};
+
+template <typename T>
+task_state_ptr<T> make_task_state()
+{
+	return task_state_ptr<T>(make_pooled<task_state<T>>());
+}
+
+//-----------------------------------------------------------------------------
+//  Name : fulfill ()
+/// <summary>
+/// Runs fn and stores its result or the exception it threw in the state.
+/// </summary>
+//-----------------------------------------------------------------------------
+template <typename T, typename F>
+void fulfill(task_state<T>& state, F&& fn)
+{
+	try
+	{
+		state.set_value(fn());
+	}
+	catch(...)
+	{
+		state.set_exception(std::current_exception());
+	}
+}
+
+template <typename F>
+void fulfill(task_state<void>& state, F&& fn)
+{
+	try
+	{
+		fn();
+		state.set_value();
+	}
+	catch(...)
+	{
+		state.set_exception(std::current_exception());
+	}
+}
+}
+
 template <typename T>
 class task_future
 {
@@ -30,17 +359,17 @@ public:
 	{
 		wait();
 
-		return future.get();
+		return _state->get();
 	}
 
-	decltype(auto) valid() const
+	bool valid() const noexcept
 	{
-		return future.valid();
+		return static_cast<bool>(_state);
 	}
-	bool is_ready() const
+
+	bool is_ready() const noexcept
 	{
-		using namespace std::chrono_literals;
-		return valid() && wait_for(0s) == std::future_status::ready;
+		return _state && _state->is_ready();
 	}
 
 	//-----------------------------------------------------------------------------
@@ -57,37 +386,37 @@ public:
 	template <class Rep, class Per>
 	std::future_status wait_for(const std::chrono::duration<Rep, Per>& rel_time) const
 	{ // wait for duration
-		return future.wait_for(rel_time);
+		if(!valid())
+			return std::future_status::deferred;
+
+		const auto rel_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(rel_time);
+		return _state->wait_for(rel_ns) ? std::future_status::ready : std::future_status::timeout;
 	}
 
 	template <class Clock, class Dur>
 	std::future_status wait_until(const std::chrono::time_point<Clock, Dur>& abs_time) const
 	{ // wait until time point
-		return future.wait_until(abs_time);
-	}
+		if(!valid())
+			return std::future_status::deferred;
 
-	static task_future<T> from_shared_future(const std::shared_future<T>& fut)
-	{
-		task_future<T> res;
-		res.future = fut;
-		return res;
-	}
-	static task_future<T> from_shared_future(std::shared_future<T>&& fut)
-	{
-		task_future<T> res;
-		res.future = std::move(fut);
-		return res;
-	}
-	static task_future<T> from_future(std::future<T>&& fut)
-	{
-		task_future<T> res;
-		res.future = fut.share();
-		return res;
+		using namespace std::chrono_literals;
+		while(!is_ready())
+		{
+			const auto now = Clock::now();
+			if(now >= abs_time)
+				return std::future_status::timeout;
+
+			// re-check the clock now and then since it may not be steady
+			const auto rel_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(abs_time - now);
+			_state->wait_for(std::min<std::chrono::nanoseconds>(rel_ns, 100ms));
+		}
+		return std::future_status::ready;
 	}
 
 private:
 	friend class task_system;
-	std::shared_future<T> future;
+	friend class task;
+	details::task_state_ptr<T> _state;
 	task_system* _system = nullptr;
 };
 
@@ -176,15 +505,15 @@ struct decay_future<const task_future<T>&>
 };
 
 /*
- * awaitable_task; a type-erased, allocator-aware std::packaged_task that
- * also contains its own arguments. The underlying packaged_task and the
- * stored argument tuple can be heap allocated or allocated with a provided
- * allocator.
+ * task; a type-erased callable that also contains its own arguments. The
+ * callable, its arguments and the completion state shared with the
+ * returned task_future are allocated from the task_allocator, so creating
+ * and running tasks does not touch the heap once its caches are warm.
  *
  * There are two forms of tasks: ready tasks and awaitable tasks.
  *
  *      Ready tasks are assumed to be immediately invokable; that is,
- *      invoking the underlying pakcaged_task with the provided arguments
+ *      invoking the underlying callable with the provided arguments
  *      will not block. This is contrasted with awaitable tasks where some or
  *      all of the provided arguments may be futures waiting on results of
  *      other tasks.
@@ -192,25 +521,30 @@ struct decay_future<const task_future<T>&>
  *      Awaitable tasks are assumed to take arguments where some or all are
  *      backed by futures waiting on results of other tasks. This is
  *      contrasted with ready tasks that are assumed to be immediately
- *      invokable.
+ *      invokable. The task_system does not poll them; it registers a
+ *      continuation on each unfinished task_future argument and queues
+ *      the task once the last one completes.
+ *
+ * A task that is destroyed without being invoked completes its future with
+ * a std::future_error(broken_promise), which in turn releases the tasks
+ * waiting on it.
  *
  * There are two helper methods for creating task objects:
  * make_ready_task and make_awaitable_task, both of which return a pair of
- * the newly constructed task and a std::future object to the
+ * the newly constructed task and a task_future object to the
  * return value.
  */
+namespace details
+{
+template <class T>
+using decay_if_future = typename std::conditional<is_future<typename std::decay<T>::type>::value,
+												  typename decay_future<T>::type, T>::type;
+}
+
 class task
 {
 	template <class T>
-	using decay_if_future = typename std::conditional<is_future<typename std::decay<T>::type>::value,
-													  typename decay_future<T>::type, T>::type;
-
-	struct ready_task_tag
-	{
-	};
-	struct awaitable_task_tag
-	{
-	};
+	using decay_if_future = details::decay_if_future<T>;
 
 public:
 	task() = default;
@@ -238,24 +572,13 @@ public:
 	friend std::pair<task, task_future<typename std::result_of<F(Args...)>::type>>
 	make_ready_task(F&& f, Args&&... args)
 	{
-		using pair_type = std::pair<task, task_future<typename std::result_of<F(Args...)>::type>>;
-		using model_type = ready_task_model<typename std::result_of<F(Args...)>::type(Args...)>;
+		using result_type = typename std::result_of<F(Args...)>::type;
+		using pair_type = std::pair<task, task_future<result_type>>;
+		using model_type = ready_task_model<typename std::decay<F>::type, result_type(Args...)>;
 
-		task t(ready_task_tag(), std::forward<F>(f), std::forward<Args>(args)...);
-		auto fut = static_cast<model_type&>(*t._t).get_future();
-		return pair_type(std::move(t), std::move(fut));
-	}
-
-	template <class Allocator, class F, class... Args>
-	friend std::pair<task, task_future<typename std::result_of<F(Args...)>::type>>
-	make_ready_task(std::allocator_arg_t, Allocator const& alloc, F&& f, Args&&... args)
-	{
-		using pair_type = std::pair<task, task_future<typename std::result_of<F(Args...)>::type>>;
-		using model_type = ready_task_model<typename std::result_of<F(Args...)>::type(Args...)>;
-
-		task t(ready_task_tag(), std::allocator_arg_t(), alloc, std::forward<F>(f),
-			   std::forward<Args>(args)...);
-		auto fut = static_cast<model_type&>(*t._t).get_future();
+		auto model = details::make_pooled<model_type>(std::forward<F>(f), std::forward<Args>(args)...);
+		task t(model);
+		auto fut = model->get_future();
 		return pair_type(std::move(t), std::move(fut));
 	}
 
@@ -263,28 +586,14 @@ public:
 	friend std::pair<task, task_future<typename std::result_of<F(decay_if_future<Args>...)>::type>>
 	make_awaitable_task(F&& f, Args&&... args)
 	{
-		using pair_type =
-			std::pair<task, task_future<typename std::result_of<F(decay_if_future<Args>...)>::type>>;
-		using model_type = awaitable_task_model<
-			typename std::result_of<F(decay_if_future<Args>...)>::type(decay_if_future<Args>...), Args...>;
-
-		task t(awaitable_task_tag(), std::forward<F>(f), std::forward<Args>(args)...);
-		auto fut = static_cast<model_type&>(*t._t).get_future();
-		return pair_type(std::move(t), std::move(fut));
-	}
-
-	template <class Allocator, class F, class... Args>
-	friend std::pair<task, task_future<typename std::result_of<F(decay_if_future<Args>...)>::type>>
-	make_awaitable_task(std::allocator_arg_t, Allocator const& alloc, F&& f, Args&&... args)
-	{
-		using pair_type =
-			std::pair<task, task_future<typename std::result_of<F(decay_if_future<Args>...)>::type>>;
-		using model_type = awaitable_task_model<
-			typename std::result_of<F(decay_if_future<Args>...)>::type(decay_if_future<Args>...), Args...>;
-
-		task t(awaitable_task_tag(), std::allocator_arg_t(), alloc, std::forward<F>(f),
-			   std::forward<Args>(args)...);
-		auto fut = static_cast<model_type&>(*t._t).get_future();
+		using result_type = typename std::result_of<F(decay_if_future<Args>...)>::type;
+		using pair_type = std::pair<task, task_future<result_type>>;
+		using model_type = awaitable_task_model<typename std::decay<F>::type,
+												result_type(decay_if_future<Args>...), Args...>;
+
+		auto model = details::make_pooled<model_type>(std::forward<F>(f), std::forward<Args>(args)...);
+		task t(model);
+		auto fut = model->get_future();
 		return pair_type(std::move(t), std::move(fut));
 	}
 
@@ -294,100 +603,119 @@ public:
 			_t->invoke_();
 	}
 
-	bool ready() const
-	{
-		if(_t)
-			return _t->ready_();
-		else
-			return false;
-	}
-
 private:
-	template <class F, class... Args>
-	task(ready_task_tag, F&& f, Args&&... args)
-		: _t(new ready_task_model<typename std::result_of<F(Args...)>::type(Args...)>(
-			  std::forward<F>(f), std::forward<Args>(args)...))
-	{
-	}
+	struct task_concept;
 
-	template <class Allocator, class F, class... Args>
-	task(ready_task_tag, std::allocator_arg_t, Allocator const& alloc, F&& f, Args&&... args)
-		: _t(new ready_task_model<typename std::result_of<F(Args...)>::type(Args...)>(
-			  std::allocator_arg_t(), alloc, std::forward<F>(f), std::forward<Args>(args)...))
+	struct task_deleter
 	{
-	}
+		void operator()(task_concept* t) const noexcept
+		{
+			t->destroy_();
+		}
+	};
 
-	template <class F, class... Args>
-	task(awaitable_task_tag, F&& f, Args&&... args)
-		: _t(new awaitable_task_model<
-			  typename std::result_of<F(decay_if_future<Args>...)>::type(decay_if_future<Args>...), Args...>(
-			  std::forward<F>(f), std::forward<Args>(args)...))
+	explicit task(task_concept* t) noexcept
+		: _t(t)
 	{
 	}
 
-	template <class Allocator, class F, class... Args>
-	task(awaitable_task_tag, std::allocator_arg_t, Allocator const& alloc, F&& f, Args&&... args)
-		: _t(new awaitable_task_model<
-			  typename std::result_of<F(decay_if_future<Args>...)>::type(decay_if_future<Args>...), Args...>(
-			  std::allocator_arg_t(), alloc, std::forward<F>(f), std::forward<Args>(args)...))
+	task_concept* release() noexcept
 	{
+		return _t.release();
 	}
 
 	struct task_concept
 	{
 		virtual ~task_concept() noexcept;
 		virtual void invoke_() = 0;
-		virtual bool ready_() const noexcept = 0;
+		virtual void destroy_() noexcept = 0;
+
+		//-----------------------------------------------------------------------------
+		//  Name : await_ ()
+		/// <summary>
+		/// Registers a continuation on every unfinished future this task waits on
+		/// and adds them to the dependency counter. Returns how many were
+		/// registered, a task without any is immediately invokable.
+		/// </summary>
+		//-----------------------------------------------------------------------------
+		virtual std::size_t await_()
+		{
+			return 0;
+		}
+
+		//-----------------------------------------------------------------------------
+		//  Name : release_dependency ()
+		/// <summary>
+		/// Called once per dependency when it completes. The last one schedules
+		/// the task on the queue it was pushed to.
+		/// </summary>
+		//-----------------------------------------------------------------------------
+		void release_dependency() noexcept;
+
+		task_system* _system = nullptr;
+		std::size_t _queue_index = 0;
+		std::atomic<std::size_t> _dependencies{0};
+		task_priority _priority = task_priority::normal;
+#if TASK_SYSTEM_TRACING
+		/// name from the task_trace_scope active when pushed
+		const char* _name = nullptr;
+		/// time it was queued, only while tracing
+		std::int64_t _enqueued = 0;
+#endif
 	};
 
-	template <class>
+	template <class...>
 	struct ready_task_model;
 
 	//-----------------------------------------------------------------------------
 	//  Name : ready_task_model ()
 	/// <summary>
 	/// Ready tasks are assumed to be immediately invokable, that is,
-	/// invoking the underlying pakcaged_task with the provided arguments
+	/// invoking the underlying callable with the provided arguments
 	/// will not block. This is contrasted with async tasks where some or all
 	/// of the provided arguments may be futures waiting on results of other
 	/// tasks.
 	/// </summary>
 	//-----------------------------------------------------------------------------
-	template <class R, class... Args>
-	struct ready_task_model<R(Args...)> : task_concept
+	template <class F, class R, class... Args>
+	struct ready_task_model<F, R(Args...)> : task_concept
 	{
-		template <class F>
-		explicit ready_task_model(F&& f, Args&&... args)
-			: _f(std::forward<F>(f))
-			, _args(std::forward<Args>(args)...)
+		template <class Fn, class... A>
+		explicit ready_task_model(Fn&& f, A&&... args)
+			: _f(std::forward<Fn>(f))
+			, _args(std::forward<A>(args)...)
+			, _state(details::make_task_state<R>())
 		{
 		}
 
-		template <class Allocator, class F>
-		explicit ready_task_model(std::allocator_arg_t, Allocator const& alloc, F&& f, Args&&... args)
-			: _f(std::allocator_arg_t(), alloc, std::forward<F>(f))
-			, _args(std::forward<Args>(args)...)
+		~ready_task_model() noexcept override
 		{
+			if(_state)
+				_state->set_exception(std::make_exception_ptr(std::future_error(std::future_errc::broken_promise)));
 		}
 
 		task_future<R> get_future()
 		{
-			return task_future<R>::from_shared_future(_f.get_future().share());
+			task_future<R> fut;
+			fut._state = _state;
+			return fut;
 		}
 
 		void invoke_() override
 		{
-			nonstd::apply(_f, _args);
+			details::fulfill(*_state, [this]() -> R { return nonstd::apply(_f, _args); });
+			_state.reset();
 		}
 
-		bool ready_() const noexcept override
+		void destroy_() noexcept override
 		{
-			return true;
+			details::destroy_pooled(this);
 		}
 
 	private:
-		std::packaged_task<R(Args...)> _f;
+		F _f;
 		std::tuple<nonstd::special_decay_t<Args>...> _args;
+		details::task_state_ptr<R> _state;
 	};
 
 	template <class...>
@@ -399,44 +727,66 @@ private:
 	/// Async tasks are assumed to take arguments where some or all are
 	/// backed by futures waiting on results of other tasks. This is
 	/// contrasted with ready tasks that are assumed to be immediately
-	/// invokable.
+	/// invokable. The continuation nodes registered on the futures are
+	/// stored inline, one per argument.
 	/// </summary>
 	//-----------------------------------------------------------------------------
-	template <class R, class... CallArgs, class... FutArgs>
-	struct awaitable_task_model<R(CallArgs...), FutArgs...> : task_concept
+	template <class F, class R, class... CallArgs, class... FutArgs>
+	struct awaitable_task_model<F, R(CallArgs...), FutArgs...> : task_concept
 	{
-		template <class F, class... Args>
-		explicit awaitable_task_model(F&& f, Args&&... args)
-			: _f(std::forward<F>(f))
-			, _args(std::forward<Args>(args)...)
+		template <class Fn, class... A>
+		explicit awaitable_task_model(Fn&& f, A&&... args)
+			: _f(std::forward<Fn>(f))
+			, _args(std::forward<A>(args)...)
+			, _state(details::make_task_state<R>())
 		{
 		}
 
-		template <class Allocator, class F, class... Args>
-		explicit awaitable_task_model(std::allocator_arg_t, Allocator const& alloc, F&& f, Args&&... args)
-			: _f(std::allocator_arg_t(), alloc, std::forward<F>(f))
-			, _args(std::forward<Args>(args)...)
+		~awaitable_task_model() noexcept override
 		{
+			if(_state)
+				_state->set_exception(std::make_exception_ptr(std::future_error(std::future_errc::broken_promise)));
 		}
 
 		task_future<R> get_future()
 		{
-			return task_future<R>::from_shared_future(_f.get_future().share());
+			task_future<R> fut;
+			fut._state = _state;
+			return fut;
 		}
 
 		void invoke_() override
 		{
 			constexpr const std::size_t arity = sizeof...(FutArgs);
-			do_invoke_(std::make_index_sequence<arity>());
+			details::fulfill(*_state,
+							 [this]() -> R { return do_invoke_(std::make_index_sequence<arity>()); });
+			_state.reset();
+		}
+
+		void destroy_() noexcept override
+		{
+			details::destroy_pooled(this);
 		}
 
-		bool ready_() const noexcept override
+		std::size_t await_() override
 		{
 			constexpr const std::size_t arity = sizeof...(FutArgs);
-			return do_ready_(std::make_index_sequence<arity>());
+			std::size_t count = 0;
+			do_await_(count, std::make_index_sequence<arity>());
+			return count;
 		}
 
 	private:
+		struct dependency_node final : details::task_continuation
+		{
+			void run() noexcept override
+			{
+				owner->release_dependency();
+			}
+
+			task_concept* owner = nullptr;
+		};
+
 		template <class T>
 		static inline decltype(auto) call_get(T&& t) noexcept
 		{
@@ -444,95 +794,122 @@ private:
 		}
 
 		template <class T>
-		static inline decltype(auto) call_get(task_future<T>&& t) noexcept
+		static inline decltype(auto) call_get(task_future<T>&& t)
 		{
 			return t.get();
 		}
 
 		template <class T>
-		static inline decltype(auto) call_get(std::future<T>&& t) noexcept
+		static inline decltype(auto) call_get(std::future<T>&& t)
 		{
 			return t.get();
 		}
 
 		template <class T>
-		static inline decltype(auto) call_get(std::shared_future<T>&& t) noexcept
+		static inline decltype(auto) call_get(std::shared_future<T>&& t)
 		{
 			return t.get();
 		}
 
 		template <std::size_t... I>
-		inline void do_invoke_(std::index_sequence<I...>)
+		inline R do_invoke_(std::index_sequence<I...>)
 		{
-			nonstd::invoke(_f, call_get(std::get<I>(std::move(_args)))...);
+			return nonstd::invoke(_f, call_get(std::get<I>(std::move(_args)))...);
 		}
 
 		template <class T>
-		static inline bool call_ready(const T&) noexcept
+		inline void call_await(std::size_t&, const T&)
 		{
-			return true;
 		}
 
+		//-----------------------------------------------------------------------------
+		//  Name : call_await ()
+		/// <summary>
+		/// Only task futures carry a completion state. Plain std futures are not
+		/// tracked and will block the executing thread when invoked.
+		/// </summary>
+		//-----------------------------------------------------------------------------
 		template <class T>
-		static inline bool call_ready(const task_future<T>& t) noexcept
+		inline void call_await(std::size_t& count, const task_future<T>& t)
 		{
-			return t.is_ready();
-		}
+			if(!t._state || t._state->is_ready())
+				return;
 
-		template <class T>
-		static inline bool call_ready(const std::future<T>& t) noexcept
-		{
-			using namespace std::chrono_literals;
-			return t.valid() && t.wait_for(0s) == std::future_status::ready;
-		}
-
-		template <class T>
-		static inline bool call_ready(const std::shared_future<T>& t) noexcept
-		{
-			using namespace std::chrono_literals;
-			return t.valid() && t.wait_for(0s) == std::future_status::ready;
+			auto& node = _nodes[count++];
+			node.owner = this;
+			_dependencies.fetch_add(1, std::memory_order_acq_rel);
+			t._state->then(&node);
 		}
 
 		template <std::size_t... I>
-		inline bool do_ready_(std::index_sequence<I...>) const noexcept
+		inline void do_await_(std::size_t& count, std::index_sequence<I...>)
 		{
-			return nonstd::check_all_true(call_ready(std::get<I>(_args))...);
+			using expander = int[];
+			(void)expander{0, (call_await(count, std::get<I>(_args)), 0)...};
 		}
 
-		std::packaged_task<R(CallArgs...)> _f;
+		F _f;
 		std::tuple<nonstd::special_decay_t<FutArgs>...> _args;
+		details::task_state_ptr<R> _state;
+		std::array<dependency_node, sizeof...(FutArgs)> _nodes;
 	};
 
-	std::unique_ptr<task_concept> _t;
+	std::unique_ptr<task_concept, task_deleter> _t;
 };
 
+template <class F, class... Args>
+std::pair<task, task_future<typename std::result_of<F(Args...)>::type>> make_ready_task(F&& f,
+																					 Args&&... args);
+
+template <class F, class... Args>
+std::pair<task, task_future<typename std::result_of<F(details::decay_if_future<Args>...)>::type>>
+make_awaitable_task(F&& f, Args&&... args);
+
 class task_system : public core::subsystem
 {
-	using duration_t = std::chrono::steady_clock::duration;
 	template <typename T>
 	friend class task_future;
+	friend class task;
 
 public:
+	using duration_t = std::chrono::steady_clock::duration;
+
 	struct queue_info
 	{
 		std::size_t pending_tasks = 0;
+		/// pending tasks per task_priority
+		std::array<std::size_t, task_priorities_count> pending_by_priority{};
 	};
 	struct system_info
 	{
 		std::size_t pending_tasks = 0;
+		/// owner and worker queues
 		std::vector<queue_info> queue_infos;
+		/// queue of the blocking io threads
+		queue_info io_queue_info;
+		/// owner thread tasks run by the last run_on_owner_thread
+		std::size_t owner_tasks_ran = 0;
+		/// owner thread tasks left queued by the last run_on_owner_thread
+		std::size_t owner_tasks_deferred = 0;
 	};
 
-	using allocator_t = std::allocator<task>;
-
 	task_system();
 
-	task_system(std::size_t nthreads, allocator_t const& alloc = {});
+	//-----------------------------------------------------------------------------
+	//  Name : task_system ()
+	/// <summary>
+	/// nthreads counts the owner thread. The io threads are separate and are
+	/// meant to spend their time blocked, so they are not counted. With
+	/// pin_threads each worker thread is bound to its own core.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	task_system(std::size_t nthreads, std::size_t nio_threads = 2, bool pin_threads = false);
 
 	//-----------------------------------------------------------------------------
 	//  Name : ~task_system ()
 	/// <summary>
-	/// Notifies threads to finish and joins them.
+	/// Notifies threads to finish and joins them. Tasks that never ran are
+	/// destroyed, which breaks their futures.
 	/// </summary>
 	//-----------------------------------------------------------------------------
 	~task_system();
@@ -561,12 +938,56 @@ public:
 	//-----------------------------------------------------------------------------
 	//  Name : run_on_owner_thread ()
 	/// <summary>
-	/// Process owner thread tasks
+	/// Process one owner thread task. Returns false when there was none.
 	/// </summary>
 	//-----------------------------------------------------------------------------
-	void run_on_owner_thread();
+	bool run_on_owner_thread();
+
+	//-----------------------------------------------------------------------------
+	//  Name : run_on_owner_thread ()
+	/// <summary>
+	/// Processes owner thread tasks, highest priority first, until the budget
+	/// is spent or the queue is empty. Critical tasks that were queued when the
+	/// call started always run, even over budget. Meant to be called once per
+	/// frame, the counts of the tasks that ran and that were deferred are
+	/// reported by get_info.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	void run_on_owner_thread(duration_t budget);
 
 	system_info get_info() const;
+
+	//-----------------------------------------------------------------------------
+	//  Name : get_pending_tasks ()
+	/// <summary>
+	/// Approximate number of queued tasks on the owner and worker queues. Does
+	/// not lock or allocate, unlike get_info.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	std::size_t get_pending_tasks() const;
+
+	//-----------------------------------------------------------------------------
+	//  Name : run_pending_task ()
+	/// <summary>
+	/// Runs one task from the queue of the calling worker thread, or one
+	/// stolen from another worker. The owner thread only steals, its own queue
+	/// is left to run_on_owner_thread. Returns false when there was nothing
+	/// to run or the calling thread has no queue. Lets a thread that waits on
+	/// something other than a task_future help in the meantime.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	bool run_pending_task();
+
+	//-----------------------------------------------------------------------------
+	//  Name : get_threads_count ()
+	/// <summary>
+	/// Number of threads including the owner thread.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	std::size_t get_threads_count() const
+	{
+		return _threads_count;
+	}
 	//-----------------------------------------------------------------------------
 	//  Name : get_owner_thread_idx ()
 	/// <summary>
@@ -599,20 +1020,7 @@ public:
 	/// mechanism.
 	/// </summary>
 	//-----------------------------------------------------------------------------
-	std::size_t get_most_busy_queue_idx(bool skip_owner) const
-	{
-		if(_threads_count == 1)
-			return get_owner_thread_idx();
-
-		auto info = get_info();
-		auto begin_it = skip_owner ? std::begin(info.queue_infos) + 1 : std::begin(info.queue_infos);
-		auto end_it = std::end(info.queue_infos);
-		auto min_el = std::min_element(begin_it, end_it, [](const auto& lhs, const auto& rhs) {
-			return lhs.pending_tasks > rhs.pending_tasks;
-		});
-		const std::size_t most_busy_idx = std::distance(std::begin(info.queue_infos), min_el);
-		return most_busy_idx;
-	}
+	std::size_t get_most_busy_queue_idx(bool skip_owner) const;
 
 	//-----------------------------------------------------------------------------
 	//  Name : get_most_free_queue_idx ()
@@ -621,20 +1029,19 @@ public:
 	/// mechanism.
 	/// </summary>
 	//-----------------------------------------------------------------------------
-	std::size_t get_most_free_queue_idx(bool skip_owner) const
-	{
-		if(_threads_count == 1)
-			return get_owner_thread_idx();
+	std::size_t get_most_free_queue_idx(bool skip_owner) const;
 
-		auto info = get_info();
-		auto begin_it = skip_owner ? std::begin(info.queue_infos) + 1 : std::begin(info.queue_infos);
-		auto end_it = std::end(info.queue_infos);
-		auto min_el = std::min_element(begin_it, end_it, [](const auto& lhs, const auto& rhs) {
-			return lhs.pending_tasks < rhs.pending_tasks;
-		});
-		const std::size_t idx = std::distance(std::begin(info.queue_infos), min_el);
-		return idx;
+	//-----------------------------------------------------------------------------
+	//  Name : get_io_threads_count ()
+	/// <summary>
+	/// Number of threads dedicated to blocking io.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	std::size_t get_io_threads_count() const
+	{
+		return _io_threads.size();
 	}
+
 	//-----------------------------------------------------------------------------
 	//  Name : push_on_thread ()
 	/// <summary>
@@ -644,9 +1051,24 @@ public:
 	//-----------------------------------------------------------------------------
 	template <class F, class... Args>
 	auto push_on_thread(const std::size_t idx, F&& f, Args&&... args)
+	{
+		return push_on_thread(idx, task_priority::normal, std::forward<F>(f), std::forward<Args>(args)...);
+	}
+
+	//-----------------------------------------------------------------------------
+	//  Name : push_on_thread ()
+	/// <summary>
+	/// Pushes a task with the given priority to a specific thread to be
+	/// executed when it can.
+	/// Either a ready task or an awaitable one
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	template <class F, class... Args>
+	auto push_on_thread(const std::size_t idx, task_priority priority, F&& f, Args&&... args)
 	{
 		using is_ready_task = nonstd::all_true<!is_future<Args>::value...>;
-		return push_impl(is_ready_task(), idx, false, std::forward<F>(f), std::forward<Args>(args)...);
+		return push_impl(is_ready_task(), idx, false, priority, std::forward<F>(f),
+						 std::forward<Args>(args)...);
 	}
 
 	//-----------------------------------------------------------------------------
@@ -663,6 +1085,13 @@ public:
 		return push_on_thread(idx, std::forward<F>(f), std::forward<Args>(args)...);
 	}
 
+	template <class F, class... Args>
+	auto push_on_worker_thread(task_priority priority, F&& f, Args&&... args)
+	{
+		const std::size_t idx = get_any_worker_thread_idx();
+		return push_on_thread(idx, priority, std::forward<F>(f), std::forward<Args>(args)...);
+	}
+
 	//-----------------------------------------------------------------------------
 	//  Name : push_on_owner_thread ()
 	/// <summary>
@@ -680,6 +1109,13 @@ public:
 		return push_on_thread(idx, std::forward<F>(f), std::forward<Args>(args)...);
 	}
 
+	template <class F, class... Args>
+	auto push_on_owner_thread(task_priority priority, F&& f, Args&&... args)
+	{
+		const std::size_t idx = get_owner_thread_idx();
+		return push_on_thread(idx, priority, std::forward<F>(f), std::forward<Args>(args)...);
+	}
+
 	//-----------------------------------------------------------------------------
 	//  Name : push_or_execute_on_thread ()
 	/// <summary>
@@ -693,7 +1129,8 @@ public:
 	auto push_or_execute_on_thread(const std::size_t idx, F&& f, Args&&... args)
 	{
 		using is_ready_task = nonstd::all_true<!is_future<Args>::value...>;
-		return push_impl(is_ready_task(), idx, true, std::forward<F>(f), std::forward<Args>(args)...);
+		return push_impl(is_ready_task(), idx, true, task_priority::normal, std::forward<F>(f),
+						 std::forward<Args>(args)...);
 	}
 
 	//-----------------------------------------------------------------------------
@@ -730,6 +1167,29 @@ public:
 		return push_or_execute_on_thread(idx, std::forward<F>(f), std::forward<Args>(args)...);
 	}
 
+	//-----------------------------------------------------------------------------
+	//  Name : push_io ()
+	/// <summary>
+	/// Pushes a task to the io threads. Meant for work that blocks on the
+	/// file system or the network, so that it does not stall the workers.
+	/// Its future composes with the others, for example a read pushed here
+	/// can be the argument of a decode task on a worker thread.
+	/// Either a ready task or an awaitable one
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	template <class F, class... Args>
+	auto push_io(F&& f, Args&&... args)
+	{
+		return push_io(task_priority::normal, std::forward<F>(f), std::forward<Args>(args)...);
+	}
+
+	template <class F, class... Args>
+	auto push_io(task_priority priority, F&& f, Args&&... args)
+	{
+		const std::size_t idx = get_io_queue_idx();
+		return push_on_thread(idx, priority, std::forward<F>(f), std::forward<Args>(args)...);
+	}
+
 private:
 	//-----------------------------------------------------------------------------
 	//  Name : push_impl ()
@@ -743,11 +1203,11 @@ private:
 	/// </summary>
 	//-----------------------------------------------------------------------------
 	template <class F, class... Args>
-	auto push_impl(std::true_type, std::size_t idx, bool execute_if_ready, F&& f, Args&&... args)
+	auto push_impl(std::true_type, std::size_t idx, bool execute_if_ready, task_priority priority, F&& f,
+				   Args&&... args)
 	{
-		return push_task(
-			make_ready_task(std::allocator_arg_t{}, _alloc, std::forward<F>(f), std::forward<Args>(args)...),
-			idx, execute_if_ready);
+		return push_task(make_ready_task(std::forward<F>(f), std::forward<Args>(args)...), idx,
+						 execute_if_ready, priority);
 	}
 
 	//-----------------------------------------------------------------------------
@@ -760,11 +1220,11 @@ private:
 	/// </summary>
 	//-----------------------------------------------------------------------------
 	template <class F, class... Args>
-	auto push_impl(std::false_type, std::size_t idx, bool execute_if_ready, F&& f, Args&&... args)
+	auto push_impl(std::false_type, std::size_t idx, bool execute_if_ready, task_priority priority, F&& f,
+				   Args&&... args)
 	{
-		return push_task(make_awaitable_task(std::allocator_arg_t{}, _alloc, std::forward<F>(f),
-											 std::forward<Args>(args)...),
-						 idx, execute_if_ready);
+		return push_task(make_awaitable_task(std::forward<F>(f), std::forward<Args>(args)...), idx,
+						 execute_if_ready, priority);
 	}
 
 	//-----------------------------------------------------------------------------
@@ -782,26 +1242,82 @@ private:
 	/// </summary>
 	//-----------------------------------------------------------------------------
 	template <class T>
-	auto push_task(T&& t, std::size_t idx, bool execute_if_ready) ->
+	auto push_task(T&& t, std::size_t idx, bool execute_if_ready, task_priority priority) ->
 		typename std::remove_reference<decltype(t.second)>::type
 	{
 		t.second._system = this;
+		t.first._t->_priority = priority;
+#if TASK_SYSTEM_TRACING
+		t.first._t->_name = details::task_trace::get_current_name();
+#endif
 
 		const auto queue_index = get_thread_queue_idx(idx);
-		if(execute_if_ready && t.first.ready() &&
-		   ((get_thread_id(queue_index) == std::this_thread::get_id()) || (queue_index != 0)))
+
+		if(push_when_ready(t.first, queue_index))
+			return std::move(t.second);
+
+		if(execute_if_ready && ((get_current_thread_idx() == queue_index) || (queue_index != 0)))
 		{
-			t.first();
+			invoke(t.first);
 
 			return std::move(t.second);
 		}
 		else
 		{
-			_queues[queue_index].push(std::move(t.first));
+			schedule(std::move(t.first), queue_index);
 			return std::move(t.second);
 		}
 	}
 
+	//-----------------------------------------------------------------------------
+	//  Name : invoke ()
+	/// <summary>
+	/// Runs a task on the calling thread. Every task the system runs goes
+	/// through here so that it can be traced.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	void invoke(task& t)
+	{
+#if TASK_SYSTEM_TRACING
+		if(details::task_trace::is_enabled())
+		{
+			invoke_traced(t);
+			return;
+		}
+#endif
+		t();
+	}
+
+#if TASK_SYSTEM_TRACING
+	//-----------------------------------------------------------------------------
+	//  Name : invoke_traced ()
+	/// <summary>
+	/// Runs a task and records it in the trace of the calling thread.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	void invoke_traced(task& t);
+#endif
+
+	//-----------------------------------------------------------------------------
+	//  Name : push_when_ready ()
+	/// <summary>
+	/// Parks a task until all of its dependencies complete. Each dependency
+	/// decrements a counter when it finishes and the last one schedules the
+	/// task, so blocked tasks never sit in a queue. Returns false and leaves
+	/// the task untouched if it has nothing to wait for.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	bool push_when_ready(task& t, std::size_t queue_index);
+
+	//-----------------------------------------------------------------------------
+	//  Name : schedule ()
+	/// <summary>
+	/// Pushes a ready task to the queue. Lock-free when called from the thread
+	/// that owns the queue.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	void schedule(task t, std::size_t queue_index);
+
 	//-----------------------------------------------------------------------------
 	//  Name : processing_wait ()
 	/// <summary>
@@ -814,30 +1330,14 @@ private:
 	template <typename T>
 	bool processing_wait(const task_future<T>& t)
 	{
-		using namespace std::literals;
-		constexpr std::size_t invalid_index = 77777;
-
-		std::pair<bool, task> p = {false, task()};
-
-		const auto this_thread_id = std::this_thread::get_id();
-
-		std::size_t queue_index = invalid_index;
-
-		for(std::size_t i = 0; i < _threads_count; ++i)
-		{
-			if(get_thread_id(i) == this_thread_id)
-			{
-				queue_index = get_thread_queue_idx(i, 0);
-				break;
-			}
-		}
-
-		if(queue_index == invalid_index)
+		const auto queue_index = get_current_thread_idx();
+		// io threads just block, they have no queue of their own to process
+		if(queue_index == invalid_index || queue_index == get_io_queue_idx())
 			return false;
 
 		const auto condition = [&t]() { return !t.is_ready(); };
 
-		run(queue_index, condition, 5ms);
+		run(queue_index, condition, t._state.get());
 
 		return true;
 	}
@@ -845,10 +1345,62 @@ private:
 	//-----------------------------------------------------------------------------
 	//  Name : run ()
 	/// <summary>
-	/// Main loop of our worker threads
+	/// Main loop of our worker threads. Runs tasks while condition holds,
+	/// spinning for a while and then parking when there is nothing to do. A
+	/// thread waiting on a future passes its state as awaited so that its
+	/// completion wakes the thread up.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	void run(std::size_t idx, const std::function<bool()>& condition,
+			 details::task_state_base* awaited = nullptr);
+
+	//-----------------------------------------------------------------------------
+	//  Name : has_work ()
+	/// <summary>
+	/// Whether the thread owning the queue could find a task, either in its
+	/// own queue or, for workers, by stealing.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	bool has_work(std::size_t queue_index) const;
+
+	//-----------------------------------------------------------------------------
+	//  Name : spin ()
+	/// <summary>
+	/// Busy waits for work or for the condition to change. The spin length
+	/// adapts per thread: it grows when spinning pays off and shrinks when
+	/// the thread ends up parking anyway.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	bool spin(std::size_t queue_index, const std::function<bool()>& condition);
+
+	//-----------------------------------------------------------------------------
+	//  Name : park ()
+	/// <summary>
+	/// Puts the calling thread to sleep until it is woken up by wake or unpark.
+	/// The thread is registered as idle before its last check for work, and
+	/// pushers check for idle threads after queuing, so no wake up is lost.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	void park(std::size_t queue_index, const std::function<bool()>& condition);
+
+	//-----------------------------------------------------------------------------
+	//  Name : unpark ()
+	/// <summary>
+	/// Wakes up the thread owning the queue. The wake up is remembered if the
+	/// thread is not parked yet.
 	/// </summary>
 	//-----------------------------------------------------------------------------
-	void run(std::size_t idx, std::function<bool()> condition, duration_t pop_timeout = duration_t::max());
+	void unpark(std::size_t queue_index);
+
+	//-----------------------------------------------------------------------------
+	//  Name : wake ()
+	/// <summary>
+	/// Called after a task was queued. Wakes up exactly one parked thread that
+	/// can run it, preferring the owner of the queue. Cheap when nobody is
+	/// parked.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	void wake(std::size_t queue_index);
 
 	//-----------------------------------------------------------------------------
 	//  Name : get_thread_queue_idx ()
@@ -866,35 +1418,186 @@ private:
 	//-----------------------------------------------------------------------------
 	std::thread::id get_thread_id(std::size_t index);
 
+	//-----------------------------------------------------------------------------
+	//  Name : get_current_thread_idx ()
+	/// <summary>
+	/// Gets the index of the calling thread or invalid_index if the calling
+	/// thread is not managed by this system.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	std::size_t get_current_thread_idx() const;
+
+	//-----------------------------------------------------------------------------
+	//  Name : try_steal ()
+	/// <summary>
+	/// Tries to steal a task from the other worker queues. Victims are visited
+	/// round-robin starting from a rotating offset, looking only at the
+	/// approximate pending counts so no queue is ever locked for selection.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	std::pair<bool, task> try_steal(std::size_t thief_idx);
+
+	//-----------------------------------------------------------------------------
+	//  Name : get_io_queue_idx ()
+	/// <summary>
+	/// The io queue comes after the owner and worker queues. It has no owner,
+	/// every io thread pops from its inbox.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	std::size_t get_io_queue_idx() const
+	{
+		return _threads_count;
+	}
+
+	//-----------------------------------------------------------------------------
+	//  Name : run_io ()
+	/// <summary>
+	/// Main loop of the io threads
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	void run_io();
+
+	constexpr static std::size_t invalid_index = std::size_t(-1);
+
 	class task_queue
 	{
 
 	public:
-		task_queue();
+		task_queue() = default;
 		task_queue(task_queue const&) = delete;
-		task_queue(task_queue&& other) noexcept;
+		~task_queue();
 
 		std::size_t get_pending_tasks() const;
+		std::size_t get_pending_tasks(task_priority priority) const;
 		void set_done();
 		bool is_done() const;
+
+		//-----------------------------------------------------------------------------
+		//  Name : push_local ()
+		/// <summary>
+		/// Lock-free push of a task. Must be called from the owner of the queue.
+		/// </summary>
+		//-----------------------------------------------------------------------------
+		void push_local(task t);
+
+		//-----------------------------------------------------------------------------
+		//  Name : push ()
+		/// <summary>
+		/// Pushes a task from any thread. Goes through the locked inbox.
+		/// </summary>
+		//-----------------------------------------------------------------------------
+		void push(task t);
+
+		//-----------------------------------------------------------------------------
+		//  Name : try_pop ()
+		/// <summary>
+		/// Pops the highest priority task without blocking. Must be called from
+		/// the owner of the queue.
+		/// </summary>
+		//-----------------------------------------------------------------------------
 		std::pair<bool, task> try_pop();
-		bool try_push(task& t);
+
+		//-----------------------------------------------------------------------------
+		//  Name : try_pop ()
+		/// <summary>
+		/// Pops a task of the given priority only. Waits for the inbox lock
+		/// instead of giving up on it. Must be called from the owner of the queue.
+		/// </summary>
+		//-----------------------------------------------------------------------------
+		std::pair<bool, task> try_pop(task_priority priority);
+
+		//-----------------------------------------------------------------------------
+		//  Name : pop ()
+		/// <summary>
+		/// Pops the highest priority task, waiting on the inbox for at most
+		/// pop_timeout. Must be called from the owner of the queue.
+		/// </summary>
+		//-----------------------------------------------------------------------------
 		std::pair<bool, task> pop(duration_t pop_timeout = duration_t::max());
 
-		void push(task t);
+		//-----------------------------------------------------------------------------
+		//  Name : steal ()
+		/// <summary>
+		/// Steals the highest priority task. Safe to call from any thread.
+		/// </summary>
+		//-----------------------------------------------------------------------------
+		std::pair<bool, task> steal();
+
+		//-----------------------------------------------------------------------------
+		//  Name : pop_shared ()
+		/// <summary>
+		/// Pops the highest priority task from the inbox, waiting until there is
+		/// one or the queue is done. For queues that are only pushed to through
+		/// the inbox. Safe to call from any thread.
+		/// </summary>
+		//-----------------------------------------------------------------------------
+		std::pair<bool, task> pop_shared();
+
+		//-----------------------------------------------------------------------------
+		//  Name : clear ()
+		/// <summary>
+		/// Destroys all queued tasks. Returns whether there were any. Must be
+		/// called from the owner of the queue.
+		/// </summary>
+		//-----------------------------------------------------------------------------
+		bool clear();
 
 	private:
-		void sort();
-		std::deque<task> _tasks;
+		//-----------------------------------------------------------------------------
+		//  Name : lane (Class)
+		/// <summary>
+		/// Tasks of one priority.
+		/// </summary>
+		//-----------------------------------------------------------------------------
+		struct lane
+		{
+			std::size_t get_pending_tasks() const;
+
+			/// lock-free deque, tasks pushed by the owner live here
+			work_stealing_deque<task::task_concept*> local;
+			/// tasks pushed by other threads, a ring buffer which only ever grows
+			std::vector<task::task_concept*> inbox;
+			std::size_t inbox_head = 0;
+			std::size_t inbox_count = 0;
+			/// size of the inbox, readable without the lock
+			std::atomic<std::size_t> inbox_size{0};
+		};
+
+		lane& get_lane(const task& t);
+		std::pair<bool, task> pop_lane(lane& l, bool wait_for_lock);
+		std::pair<bool, task> try_pop_inbox(lane& l, std::unique_lock<std::mutex>& lock);
+		bool has_inbox_tasks(std::unique_lock<std::mutex>& lock) const;
+
+		std::array<lane, task_priorities_count> _lanes;
 		std::condition_variable _cv;
 		mutable std::mutex _mutex;
 		std::atomic_bool _done{false};
 	};
 
-	std::vector<task_queue> _queues;
+	struct parking_slot
+	{
+		std::mutex mutex;
+		std::condition_variable cv;
+		bool signaled = false;
+		/// current spin length, only touched by the owning thread
+		std::size_t spin_limit = 1024;
+	};
+
+	struct wake_continuation;
+
+	std::vector<std::unique_ptr<task_queue>> _queues;
+	/// one per owner and worker thread
+	std::vector<std::unique_ptr<parking_slot>> _parking;
+	/// parked threads, by queue index
+	std::vector<std::size_t> _idle;
+	std::atomic<std::size_t> _idle_count{0};
+	std::mutex _idle_mutex;
 	std::vector<std::thread> _threads;
-	typename allocator_t::template rebind<task::task_concept>::other _alloc;
+	std::vector<std::thread> _io_threads;
 	std::size_t _threads_count;
+	/// counters of the last run_on_owner_thread
+	std::atomic<std::size_t> _owner_tasks_ran{0};
+	std::atomic<std::size_t> _owner_tasks_deferred{0};
 	//
 	const std::thread::id _owner_thread_id = std::this_thread::get_id();
 };
@@ -902,23 +1605,14 @@ private:
 template <typename T>
 void task_future<T>::wait() const
 {
-	if(!future.valid())
+	if(!valid() || is_ready())
 		return;
 
-	if(!is_ready())
-	{
-		if(_system)
-		{
-			if(!_system->processing_wait(*this))
-			{
-				future.wait();
-			}
-		}
-		else
-		{
-			future.wait();
-		}
-	}
+	if(_system)
+		_system->processing_wait(*this);
+
+	// processing_wait gives up on shutdown, and unmanaged threads cannot help
+	_state->wait();
 }
 } // namespace core
 
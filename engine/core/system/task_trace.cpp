@@ -0,0 +1,332 @@
+#include "task_trace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+#if defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+#include <intrin.h>
+#endif
+
+namespace core
+{
+#if TASK_SYSTEM_TRACING
+namespace details
+{
+std::atomic_bool task_trace_enabled{false};
+
+namespace
+{
+/// events kept per thread, a power of two
+constexpr std::uint64_t ring_capacity = 16 * 1024;
+
+struct event_slot
+{
+	std::atomic<const char*> name{nullptr};
+	std::atomic<std::int64_t> enqueued{0};
+	std::atomic<std::int64_t> start{0};
+	std::atomic<std::int64_t> end{0};
+	std::atomic<std::uint32_t> queue_index{0};
+	std::atomic<std::uint32_t> thread_index{0};
+	std::atomic_bool stolen{false};
+};
+
+//-----------------------------------------------------------------------------
+//  Name : thread_buffer (Class)
+/// <summary>
+/// Ring of the last events of one thread. Only the owning thread writes.
+/// Readers copy the slots and then check how far the writer got meanwhile,
+/// like a sequence lock, dropping any slot that may have been rewritten.
+/// </summary>
+//-----------------------------------------------------------------------------
+struct thread_buffer
+{
+	explicit thread_buffer(std::uint32_t id)
+		: tid(id)
+		, name("thread " + std::to_string(id))
+		, slots(new event_slot[ring_capacity])
+	{
+	}
+
+	void push(const task_event& e) noexcept
+	{
+		const auto h = head.load(std::memory_order_relaxed);
+		writing.store(h + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+
+		auto& slot = slots[h & (ring_capacity - 1)];
+		slot.name.store(e.name, std::memory_order_relaxed);
+		slot.enqueued.store(e.enqueued, std::memory_order_relaxed);
+		slot.start.store(e.start, std::memory_order_relaxed);
+		slot.end.store(e.end, std::memory_order_relaxed);
+		slot.queue_index.store(e.queue_index, std::memory_order_relaxed);
+		slot.thread_index.store(e.thread_index, std::memory_order_relaxed);
+		slot.stolen.store(e.stolen, std::memory_order_relaxed);
+
+		head.store(h + 1, std::memory_order_release);
+	}
+
+	void read(std::vector<task_event>& events) const
+	{
+		const auto h = head.load(std::memory_order_acquire);
+		const auto from = std::max(first.load(std::memory_order_relaxed),
+								   h > ring_capacity ? h - ring_capacity : std::uint64_t(0));
+
+		const auto offset = events.size();
+		for(auto i = from; i < h; ++i)
+		{
+			const auto& slot = slots[i & (ring_capacity - 1)];
+			task_event e;
+			e.name = slot.name.load(std::memory_order_relaxed);
+			e.enqueued = slot.enqueued.load(std::memory_order_relaxed);
+			e.start = slot.start.load(std::memory_order_relaxed);
+			e.end = slot.end.load(std::memory_order_relaxed);
+			e.queue_index = slot.queue_index.load(std::memory_order_relaxed);
+			e.thread_index = slot.thread_index.load(std::memory_order_relaxed);
+			e.stolen = slot.stolen.load(std::memory_order_relaxed);
+			events.emplace_back(e);
+		}
+
+		// whatever the writer touched while copying is not trustworthy
+		std::atomic_thread_fence(std::memory_order_acquire);
+		const auto w = writing.load(std::memory_order_relaxed);
+		const auto valid_from = w > ring_capacity ? w - ring_capacity : std::uint64_t(0);
+		if(valid_from > from)
+		{
+			const auto invalid = static_cast<std::size_t>(std::min(valid_from, h) - from);
+			events.erase(events.begin() + static_cast<std::ptrdiff_t>(offset),
+						 events.begin() + static_cast<std::ptrdiff_t>(offset + invalid));
+		}
+	}
+
+	const std::uint32_t tid;
+	/// guarded by the registry mutex
+	std::string name;
+	std::unique_ptr<event_slot[]> slots;
+	/// events published
+	std::atomic<std::uint64_t> head{0};
+	/// events started, one ahead of head during a write
+	std::atomic<std::uint64_t> writing{0};
+	/// first event of the current capture
+	std::atomic<std::uint64_t> first{0};
+};
+
+struct registry
+{
+	std::mutex mutex;
+	std::vector<std::shared_ptr<thread_buffer>> buffers;
+	std::uint32_t next_tid = 0;
+	/// start of the capture in ticks and in nanoseconds
+	std::int64_t epoch_ticks = 0;
+	std::int64_t epoch_ns = 0;
+};
+
+registry& get_registry()
+{
+	// Intentionally never destroyed, threads may record until they exit.
+	static auto r = new registry();
+	return *r;
+}
+
+thread_local std::shared_ptr<thread_buffer> this_thread_buffer_owner;
+thread_local thread_buffer* this_thread_buffer = nullptr;
+thread_local const char* this_thread_task_name = nullptr;
+
+thread_buffer& get_thread_buffer()
+{
+	if(!this_thread_buffer)
+	{
+		auto& r = get_registry();
+		std::lock_guard<std::mutex> lock(r.mutex);
+		this_thread_buffer_owner = std::make_shared<thread_buffer>(r.next_tid++);
+		this_thread_buffer = this_thread_buffer_owner.get();
+		r.buffers.emplace_back(this_thread_buffer_owner);
+	}
+	return *this_thread_buffer;
+}
+
+void write_string(std::ostream& out, const char* str)
+{
+	out << '"';
+	for(; str && *str; ++str)
+	{
+		if(*str == '"' || *str == '\\')
+			out << '\\';
+		out << *str;
+	}
+	out << '"';
+}
+
+std::int64_t now_ns()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+			   std::chrono::steady_clock::now().time_since_epoch())
+		.count();
+}
+
+void write_us(std::ostream& out, std::int64_t ns)
+{
+	if(ns < 0)
+	{
+		out << '-';
+		ns = -ns;
+	}
+	const auto frac = ns % 1000;
+	out << ns / 1000 << '.' << char('0' + frac / 100) << char('0' + (frac / 10) % 10) << char('0' + frac % 10);
+}
+}
+
+std::int64_t task_trace::now() noexcept
+{
+// Three timestamps are taken per task, the steady clock is too slow for that
+// on some systems.
+#if defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+	return static_cast<std::int64_t>(__rdtsc());
+#elif defined(__i386__) || defined(__x86_64__)
+	return static_cast<std::int64_t>(__builtin_ia32_rdtsc());
+#else
+	return now_ns();
+#endif
+}
+
+const char* task_trace::get_current_name() noexcept
+{
+	return this_thread_task_name;
+}
+
+const char* task_trace::set_current_name(const char* name) noexcept
+{
+	const auto previous = this_thread_task_name;
+	this_thread_task_name = name;
+	return previous;
+}
+
+void task_trace::set_thread_name(const std::string& name)
+{
+	auto& buffer = get_thread_buffer();
+	std::lock_guard<std::mutex> lock(get_registry().mutex);
+	buffer.name = name;
+}
+
+void task_trace::record(const task_event& e) noexcept
+{
+	get_thread_buffer().push(e);
+}
+}
+
+task_trace_scope::task_trace_scope(const char* name) noexcept
+	: _previous(details::task_trace::set_current_name(name))
+{
+}
+
+task_trace_scope::~task_trace_scope() noexcept
+{
+	details::task_trace::set_current_name(_previous);
+}
+
+void task_tracer::start()
+{
+	auto& r = details::get_registry();
+	{
+		std::lock_guard<std::mutex> lock(r.mutex);
+
+		// forget the threads that exited
+		r.buffers.erase(std::remove_if(std::begin(r.buffers), std::end(r.buffers),
+									   [](const std::shared_ptr<details::thread_buffer>& buffer) {
+										   return buffer.use_count() == 1;
+									   }),
+						std::end(r.buffers));
+
+		for(auto& buffer : r.buffers)
+			buffer->first.store(buffer->head.load(std::memory_order_acquire), std::memory_order_relaxed);
+
+		r.epoch_ticks = details::task_trace::now();
+		r.epoch_ns = details::now_ns();
+	}
+	details::task_trace_enabled.store(true, std::memory_order_relaxed);
+}
+
+void task_tracer::stop()
+{
+	details::task_trace_enabled.store(false, std::memory_order_relaxed);
+}
+
+bool task_tracer::is_running() noexcept
+{
+	return details::task_trace::is_enabled();
+}
+
+std::size_t task_tracer::write_chrome_trace(std::ostream& out)
+{
+	auto& r = details::get_registry();
+	std::lock_guard<std::mutex> lock(r.mutex);
+
+	// ticks to nanoseconds, measured over the capture so far
+	const auto ticks = details::task_trace::now() - r.epoch_ticks;
+	const auto ns = details::now_ns() - r.epoch_ns;
+	const double ns_per_tick = (ticks > 0 && ns > 0) ? double(ns) / double(ticks) : 1.0;
+	const auto to_ns = [ns_per_tick](std::int64_t t) { return static_cast<std::int64_t>(double(t) * ns_per_tick); };
+
+	std::size_t written = 0;
+	std::vector<details::task_event> events;
+	const char* separator = "\n";
+
+	out << "{\"traceEvents\":[";
+	for(const auto& buffer : r.buffers)
+	{
+		events.clear();
+		buffer->read(events);
+
+		out << separator << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->tid
+			<< ",\"args\":{\"name\":";
+		details::write_string(out, buffer->name.c_str());
+		out << "}}";
+		separator = ",\n";
+
+		for(const auto& e : events)
+		{
+			out << separator << "{\"name\":";
+			details::write_string(out, e.name ? e.name : "task");
+			out << ",\"cat\":\"task\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->tid << ",\"ts\":";
+			details::write_us(out, to_ns(e.start - r.epoch_ticks));
+			out << ",\"dur\":";
+			details::write_us(out, to_ns(e.end - e.start));
+			out << ",\"args\":{\"queue\":" << e.queue_index << ",\"thread\":";
+			if(e.thread_index == std::uint32_t(-1))
+				out << -1;
+			else
+				out << e.thread_index;
+			out << ",\"stolen\":" << (e.stolen ? "true" : "false") << ",\"queued_us\":";
+			details::write_us(out, e.enqueued != 0 ? to_ns(e.start - e.enqueued) : 0);
+			out << "}}";
+			++written;
+		}
+	}
+	out << "\n],\"displayTimeUnit\":\"ns\"}\n";
+
+	return written;
+}
+#else
+void task_tracer::start()
+{
+}
+
+void task_tracer::stop()
+{
+}
+
+bool task_tracer::is_running() noexcept
+{
+	return false;
+}
+
+std::size_t task_tracer::write_chrome_trace(std::ostream& out)
+{
+	out << "{\"traceEvents\":[]}\n";
+	return 0;
+}
+#endif
+}
@@ -0,0 +1,161 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+
+// Task tracing is compiled in with -DTASK_SYSTEM_TRACING=1 (cmake option
+// TASK_SYSTEM_TRACING). Without it none of the hooks below exist in the task
+// system and task_trace_scope is an empty object.
+#ifndef TASK_SYSTEM_TRACING
+#define TASK_SYSTEM_TRACING 0
+#endif
+
+namespace core
+{
+//-----------------------------------------------------------------------------
+// Main Class Declarations
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+//  Name : task_tracer (Class)
+/// <summary>
+/// Records what the task system threads execute. Every thread writes the
+/// tasks it runs into its own ring buffer, so recording does not lock and
+/// only the most recent events of each thread are kept. A capture can be
+/// written at any time as a chrome trace json file, which can be opened in
+/// chrome://tracing or in Perfetto.
+/// </summary>
+//-----------------------------------------------------------------------------
+class task_tracer
+{
+public:
+	//-----------------------------------------------------------------------------
+	//  Name : is_available ()
+	/// <summary>
+	/// Whether tracing was compiled in.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	static bool is_available() noexcept
+	{
+		return TASK_SYSTEM_TRACING != 0;
+	}
+
+	//-----------------------------------------------------------------------------
+	//  Name : start ()
+	/// <summary>
+	/// Starts a new capture, previously recorded events are dropped.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	static void start();
+
+	//-----------------------------------------------------------------------------
+	//  Name : stop ()
+	/// <summary>
+	/// Stops recording. The capture is kept until the next start.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	static void stop();
+
+	//-----------------------------------------------------------------------------
+	//  Name : is_running ()
+	/// <summary>
+	///
+	///
+	///
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	static bool is_running() noexcept;
+
+	//-----------------------------------------------------------------------------
+	//  Name : write_chrome_trace ()
+	/// <summary>
+	/// Writes the current capture in the chrome trace event format. Returns
+	/// the number of tasks written. Safe to call while recording, events that
+	/// get overwritten during the call are skipped.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	static std::size_t write_chrome_trace(std::ostream& out);
+};
+
+#if TASK_SYSTEM_TRACING
+//-----------------------------------------------------------------------------
+//  Name : task_trace_scope (Class)
+/// <summary>
+/// Names the tasks pushed from this thread while the scope is alive. Tasks
+/// pushed from inside a running task inherit its name unless they are
+/// named again.
+/// </summary>
+//-----------------------------------------------------------------------------
+class task_trace_scope
+{
+public:
+	explicit task_trace_scope(const char* name) noexcept;
+	~task_trace_scope() noexcept;
+
+	task_trace_scope(const task_trace_scope&) = delete;
+	task_trace_scope& operator=(const task_trace_scope&) = delete;
+
+private:
+	const char* _previous = nullptr;
+};
+
+namespace details
+{
+/// set while a capture is recording
+extern std::atomic_bool task_trace_enabled;
+
+struct task_event
+{
+	/// name of the task, static storage
+	const char* name = nullptr;
+	/// when the task was queued, 0 if it ran inline, in task_trace::now ticks
+	std::int64_t enqueued = 0;
+	std::int64_t start = 0;
+	std::int64_t end = 0;
+	/// queue the task was pushed to
+	std::uint32_t queue_index = 0;
+	/// queue of the thread that ran it
+	std::uint32_t thread_index = 0;
+	/// ran by a thread that does not own the queue it was pushed to
+	bool stolen = false;
+};
+
+//-----------------------------------------------------------------------------
+//  Name : task_trace (Class)
+/// <summary>
+/// Recording side of the task_tracer used by the task system.
+/// </summary>
+//-----------------------------------------------------------------------------
+struct task_trace
+{
+	static bool is_enabled() noexcept
+	{
+		return task_trace_enabled.load(std::memory_order_relaxed);
+	}
+
+	/// timestamp in cpu ticks where available, converted when written
+	static std::int64_t now() noexcept;
+
+	/// name of the tasks pushed by this thread right now
+	static const char* get_current_name() noexcept;
+	static const char* set_current_name(const char* name) noexcept;
+
+	/// labels the calling thread in the written traces
+	static void set_thread_name(const std::string& name);
+
+	/// appends to the ring buffer of the calling thread
+	static void record(const task_event& e) noexcept;
+};
+}
+#else
+class task_trace_scope
+{
+public:
+	explicit task_trace_scope(const char*) noexcept
+	{
+	}
+};
+#endif
+}
@@ -0,0 +1,190 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+namespace core
+{
+//-----------------------------------------------------------------------------
+// Main Class Declarations
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+//  Name : work_stealing_deque (Class)
+/// <summary>
+/// Lock-free Chase-Lev work stealing deque. The owning thread pushes and pops
+/// at the bottom end, any other thread may steal from the top end. Elements
+/// must be trivially copyable (usually raw pointers) since they are stored in
+/// atomics. Retired ring buffers are kept alive until the deque is destroyed
+/// because a thief may still be reading from them.
+/// </summary>
+//-----------------------------------------------------------------------------
+template <typename T>
+class work_stealing_deque
+{
+	static_assert(std::is_trivially_copyable<T>::value, "T should be trivially copyable.");
+
+	struct ring_buffer
+	{
+		explicit ring_buffer(std::int64_t cap)
+			: capacity(cap)
+			, mask(cap - 1)
+			, items(new std::atomic<T>[static_cast<std::size_t>(cap)])
+		{
+		}
+
+		void put(std::int64_t i, T item) noexcept
+		{
+			items[static_cast<std::size_t>(i & mask)].store(item, std::memory_order_relaxed);
+		}
+
+		T get(std::int64_t i) const noexcept
+		{
+			return items[static_cast<std::size_t>(i & mask)].load(std::memory_order_relaxed);
+		}
+
+		ring_buffer* grow(std::int64_t bottom, std::int64_t top) const
+		{
+			auto buffer = new ring_buffer(capacity * 2);
+			for(std::int64_t i = top; i != bottom; ++i)
+				buffer->put(i, get(i));
+			return buffer;
+		}
+
+		std::int64_t capacity;
+		std::int64_t mask;
+		std::unique_ptr<std::atomic<T>[]> items;
+	};
+
+public:
+	//-----------------------------------------------------------------------------
+	//  Name : work_stealing_deque ()
+	/// <summary>
+	/// Capacity must be a power of two. The deque grows on demand.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	explicit work_stealing_deque(std::int64_t capacity = 1024)
+	{
+		auto buffer = new ring_buffer(capacity);
+		_retired.emplace_back(buffer);
+		_buffer.store(buffer, std::memory_order_relaxed);
+	}
+
+	work_stealing_deque(const work_stealing_deque&) = delete;
+	work_stealing_deque& operator=(const work_stealing_deque&) = delete;
+
+	//-----------------------------------------------------------------------------
+	//  Name : empty ()
+	/// <summary>
+	/// Approximate, may be stale by the time it returns.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	bool empty() const noexcept
+	{
+		return size() == 0;
+	}
+
+	//-----------------------------------------------------------------------------
+	//  Name : size ()
+	/// <summary>
+	/// Approximate number of elements, safe to call from any thread.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	std::size_t size() const noexcept
+	{
+		const auto b = _bottom.load(std::memory_order_relaxed);
+		const auto t = _top.load(std::memory_order_relaxed);
+		return static_cast<std::size_t>(b >= t ? b - t : 0);
+	}
+
+	//-----------------------------------------------------------------------------
+	//  Name : push ()
+	/// <summary>
+	/// Pushes an element at the bottom. Owner thread only.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	void push(T item)
+	{
+		const auto b = _bottom.load(std::memory_order_relaxed);
+		const auto t = _top.load(std::memory_order_acquire);
+		auto buffer = _buffer.load(std::memory_order_relaxed);
+
+		if(buffer->capacity - 1 < (b - t))
+		{
+			buffer = buffer->grow(b, t);
+			_retired.emplace_back(buffer);
+			_buffer.store(buffer, std::memory_order_release);
+		}
+
+		buffer->put(b, item);
+		_bottom.store(b + 1, std::memory_order_release);
+	}
+
+	//-----------------------------------------------------------------------------
+	//  Name : pop ()
+	/// <summary>
+	/// Pops an element from the bottom. Owner thread only.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	bool pop(T& item)
+	{
+		const auto b = _bottom.load(std::memory_order_relaxed) - 1;
+		auto buffer = _buffer.load(std::memory_order_relaxed);
+		_bottom.store(b, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		auto t = _top.load(std::memory_order_relaxed);
+
+		if(t > b)
+		{
+			// empty
+			_bottom.store(b + 1, std::memory_order_relaxed);
+			return false;
+		}
+
+		item = buffer->get(b);
+		if(t == b)
+		{
+			// last element, race against the thieves
+			const bool won =
+				_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+			_bottom.store(b + 1, std::memory_order_relaxed);
+			return won;
+		}
+
+		return true;
+	}
+
+	//-----------------------------------------------------------------------------
+	//  Name : steal ()
+	/// <summary>
+	/// Steals an element from the top. Safe to call from any thread.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	bool steal(T& item)
+	{
+		auto t = _top.load(std::memory_order_acquire);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		const auto b = _bottom.load(std::memory_order_acquire);
+
+		if(t >= b)
+			return false;
+
+		auto buffer = _buffer.load(std::memory_order_acquire);
+		item = buffer->get(t);
+		return _top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+	}
+
+private:
+	/// top index, thieves advance it
+	std::atomic<std::int64_t> _top{0};
+	/// bottom index, owned by the owner thread
+	std::atomic<std::int64_t> _bottom{0};
+	/// current ring buffer
+	std::atomic<ring_buffer*> _buffer{nullptr};
+	/// every buffer ever allocated, owner thread only
+	std::vector<std::unique_ptr<ring_buffer>> _retired;
+};
+}
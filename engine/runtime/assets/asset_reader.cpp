@@ -19,6 +19,7 @@
 #include "core/serialization/types/map.hpp"
 #include "core/serialization/types/vector.hpp"
 #include <cstdint>
+#include <sstream>
 
 namespace runtime
 {
@@ -94,7 +95,8 @@ bool load_from_file<gfx::texture>(core::task_future<asset_handle<gfx::texture>>&
 		return result;
 	};
 
-	auto ready_memory_task = ts.push_on_worker_thread(read_memory_func);
+	core::task_trace_scope trace_scope("load_texture");
+	auto ready_memory_task = ts.push_io(read_memory_func);
 	output = ts.push_on_owner_thread(create_resource_func, ready_memory_task);
 	return true;
 }
@@ -167,7 +169,8 @@ bool load_from_file<gfx::shader>(core::task_future<asset_handle<gfx::shader>>& o
 		return result;
 	};
 
-	auto ready_memory_task = ts.push_on_worker_thread(read_memory_func);
+	core::task_trace_scope trace_scope("load_shader");
+	auto ready_memory_task = ts.push_io(read_memory_func);
 	output = ts.push_on_owner_thread(create_resource_func, ready_memory_task);
 	return true;
 }
@@ -212,20 +215,35 @@ bool load_from_file<mesh>(core::task_future<asset_handle<mesh>>& output, const s
 
 	auto wrapper = std::make_shared<wrapper_t>();
 	wrapper->mesh = std::make_shared<mesh>();
-	auto read_memory_func = [wrapper, compiled_absolute_key]() mutable {
-		mesh::load_data data;
+	auto read_memory = std::make_shared<fs::byte_array_t>();
+
+	auto read_memory_func = [read_memory, compiled_absolute_key]() {
+		std::ifstream stream{compiled_absolute_key, std::ios::in | std::ios::binary};
+
+		if(stream.bad())
 		{
-			std::ifstream stream{compiled_absolute_key, std::ios::in | std::ios::binary};
+			return false;
+		}
 
-			if(stream.bad())
-			{
-				return false;
-			}
+		*read_memory = fs::read_stream(stream);
+
+		return true;
+	};
+
+	auto prepare_resource_func = [wrapper, read_memory](bool read_result) mutable {
+		if(!read_result)
+			return false;
+
+		mesh::load_data data;
+		{
+			fs::byte_array_buf buffer(*read_memory);
+			std::istream stream(&buffer);
 
 			cereal::iarchive_binary_t ar(stream);
 
 			try_load(ar, cereal::make_nvp("mesh", data));
 		}
+		read_memory->clear();
 		wrapper->mesh->prepare_mesh(data.vertex_format);
 		wrapper->mesh->set_vertex_source(&data.vertex_data[0], data.vertex_count, data.vertex_format);
 		wrapper->mesh->add_primitives(data.triangle_data);
@@ -256,8 +274,10 @@ bool load_from_file<mesh>(core::task_future<asset_handle<mesh>>& output, const s
 		return result;
 	};
 
-	auto ready_memory_task = ts.push_on_worker_thread(read_memory_func);
-	output = ts.push_on_owner_thread(create_resource_func, ready_memory_task);
+	core::task_trace_scope trace_scope("load_mesh");
+	auto ready_memory_task = ts.push_io(read_memory_func);
+	auto prepared_task = ts.push_on_worker_thread(prepare_resource_func, ready_memory_task);
+	output = ts.push_on_owner_thread(create_resource_func, prepared_task);
 	return true;
 }
 
@@ -301,17 +321,34 @@ bool load_from_file<material>(core::task_future<asset_handle<material>>& output,
 
 	auto wrapper = std::make_shared<wrapper_t>();
 	wrapper->material = std::make_shared<material>();
+	auto read_memory = std::make_shared<fs::byte_array_t>();
 
-	auto read_memory_func = [wrapper, compiled_absolute_key]() mutable {
+	auto read_memory_func = [read_memory, compiled_absolute_key]() {
 		std::ifstream stream{compiled_absolute_key, std::ios::in | std::ios::binary};
 
 		if(stream.bad())
 		{
 			return false;
 		}
-		cereal::iarchive_associative_t ar(stream);
 
-		try_load(ar, cereal::make_nvp("material", wrapper->material));
+		*read_memory = fs::read_stream(stream);
+
+		return true;
+	};
+
+	auto prepare_resource_func = [wrapper, read_memory](bool read_result) mutable {
+		if(!read_result)
+			return false;
+
+		{
+			fs::byte_array_buf buffer(*read_memory);
+			std::istream stream(&buffer);
+
+			cereal::iarchive_associative_t ar(stream);
+
+			try_load(ar, cereal::make_nvp("material", wrapper->material));
+		}
+		read_memory->clear();
 
 		return true;
 	};
@@ -325,8 +362,10 @@ bool load_from_file<material>(core::task_future<asset_handle<material>>& output,
 		return result;
 	};
 
-	auto ready_memory_task = ts.push_on_worker_thread(read_memory_func);
-	output = ts.push_on_owner_thread(create_resource_func, ready_memory_task);
+	core::task_trace_scope trace_scope("load_material");
+	auto ready_memory_task = ts.push_io(read_memory_func);
+	auto prepared_task = ts.push_on_worker_thread(prepare_resource_func, ready_memory_task);
+	output = ts.push_on_owner_thread(create_resource_func, prepared_task);
 	return true;
 }
 
@@ -391,7 +430,8 @@ bool load_from_file<prefab>(core::task_future<asset_handle<prefab>>& output, con
 		return result;
 	};
 
-	auto ready_memory_task = ts.push_on_worker_thread(read_memory_func);
+	core::task_trace_scope trace_scope("load_prefab");
+	auto ready_memory_task = ts.push_io(read_memory_func);
 	output = ts.push_on_owner_thread(create_resource_func, ready_memory_task);
 	return true;
 }
@@ -457,7 +497,8 @@ bool load_from_file<scene>(core::task_future<asset_handle<scene>>& output, const
 		return result;
 	};
 
-	auto ready_memory_task = ts.push_on_worker_thread(read_memory_func);
+	core::task_trace_scope trace_scope("load_scene");
+	auto ready_memory_task = ts.push_io(read_memory_func);
 	output = ts.push_on_owner_thread(create_resource_func, ready_memory_task);
 	return true;
 }
@@ -1,4 +1,5 @@
 #include "camera_component.h"
+#include "../world_snapshot.h"
 #include "core/graphics/graphics.h"
 
 camera_component::camera_component()
@@ -12,8 +13,6 @@ camera_component::~camera_component()
 
 void camera_component::update(const math::transform& t)
 {
-	// Release the unused fbos and textures
-	_render_view.release_unused_resources();
 	// First update so the camera can cache the previous matrices
 	_camera.record_current_matrices();
 	// Set new transform
@@ -99,3 +98,36 @@ projection_mode camera_component::get_projection_mode() const
 {
 	return _camera.get_projection_mode();
 }
+
+namespace runtime
+{
+template <>
+struct component_snapshot<camera_component>
+{
+	// The render view is left alone, it only caches gpu resources.
+	struct state
+	{
+		camera cam;
+		bool hdr = true;
+	};
+
+	static state save(const camera_component& comp)
+	{
+		state saved;
+		saved.cam = comp.get_camera();
+		saved.hdr = comp.get_hdr();
+		return saved;
+	}
+
+	static void restore(camera_component& comp, const state& saved)
+	{
+		comp.get_camera() = saved.cam;
+		comp.set_hdr(saved.hdr);
+	}
+};
+}
+
+namespace
+{
+const bool snapshot_registered = runtime::register_component_snapshot<camera_component>();
+}
@@ -145,9 +145,8 @@ public:
 	//-----------------------------------------------------------------------------
 	//  Name : update ()
 	/// <summary>
-	///
-	///
-	///
+	/// Updates the camera matrices from the transform. Does not touch the
+	/// render view so it can run on any thread.
 	/// </summary>
 	//-----------------------------------------------------------------------------
 	void update(const math::transform& t);
@@ -1,4 +1,5 @@
 #include "light_component.h"
+#include "../world_snapshot.h"
 
 int light_component::compute_projected_sphere_rect(irect& rect, const math::vec3& light_position,
 												   const math::vec3& light_direction,
@@ -32,3 +33,25 @@ int light_component::compute_projected_sphere_rect(irect& rect, const math::vec3
 		return 1;
 	}
 }
+
+namespace runtime
+{
+template <>
+struct component_snapshot<light_component>
+{
+	static const light& save(const light_component& comp)
+	{
+		return comp.get_light();
+	}
+
+	static void restore(light_component& comp, const light& saved)
+	{
+		comp.set_light(saved);
+	}
+};
+}
+
+namespace
+{
+const bool snapshot_registered = runtime::register_component_snapshot<light_component>();
+}
@@ -1,5 +1,6 @@
 #include "model_component.h"
 #include "transform_component.h"
+#include "../world_snapshot.h"
 
 model_component& model_component::set_casts_shadow(bool cast_shadow)
 {
@@ -91,3 +92,81 @@ bool model_component::casts_reflection() const
 {
 	return _casts_reflection;
 }
+
+const math::bbox& model_component::get_world_bounds() const
+{
+	return _world_bounds;
+}
+
+const math::bsphere& model_component::get_world_sphere() const
+{
+	return _world_sphere;
+}
+
+bool model_component::has_world_bounds() const
+{
+	return _has_world_bounds;
+}
+
+std::uint32_t model_component::get_world_bounds_tick() const
+{
+	return _world_bounds_tick;
+}
+
+void model_component::set_world_bounds(const math::bbox& bounds, std::uint32_t tick)
+{
+	_world_bounds = bounds;
+	_world_sphere = math::bsphere(bounds.get_center(), math::length(bounds.get_extents()));
+	_world_bounds_tick = tick;
+	_has_world_bounds = true;
+}
+
+void model_component::reset_world_bounds()
+{
+	_has_world_bounds = false;
+}
+
+namespace runtime
+{
+template <>
+struct component_snapshot<model_component>
+{
+	// Holds asset handles and vectors, copied member by member.
+	struct state
+	{
+		bool is_static = true;
+		bool casts_shadow = true;
+		bool casts_reflection = true;
+		model mdl;
+		std::vector<runtime::entity> bone_entities;
+		std::vector<math::transform> bone_transforms;
+	};
+
+	static state save(const model_component& comp)
+	{
+		state saved;
+		saved.is_static = comp.is_static();
+		saved.casts_shadow = comp.casts_shadow();
+		saved.casts_reflection = comp.casts_reflection();
+		saved.mdl = comp.get_model();
+		saved.bone_entities = comp.get_bone_entities();
+		saved.bone_transforms = comp.get_bone_transforms();
+		return saved;
+	}
+
+	static void restore(model_component& comp, const state& saved)
+	{
+		comp.set_static(saved.is_static);
+		comp.set_casts_shadow(saved.casts_shadow);
+		comp.set_casts_reflection(saved.casts_reflection);
+		comp.set_model(saved.mdl);
+		comp.set_bone_entities(saved.bone_entities);
+		comp.set_bone_transforms(saved.bone_transforms);
+	}
+};
+}
+
+namespace
+{
+const bool snapshot_registered = runtime::register_component_snapshot<model_component>();
+}
@@ -110,6 +110,57 @@ public:
 	model_component& set_bone_transforms(const std::vector<math::transform>& bone_transforms);
 	const std::vector<math::transform>& get_bone_transforms() const;
 
+	//-----------------------------------------------------------------------------
+	//  Name : get_world_bounds ()
+	/// <summary>
+	/// World space box of the first lod at the world transform of the entity,
+	/// kept up to date by the bounds_system. Only meaningful when
+	/// has_world_bounds is true.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	const math::bbox& get_world_bounds() const;
+
+	//-----------------------------------------------------------------------------
+	//  Name : get_world_sphere ()
+	/// <summary>
+	/// Sphere enclosing get_world_bounds.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	const math::bsphere& get_world_sphere() const;
+
+	//-----------------------------------------------------------------------------
+	//  Name : has_world_bounds ()
+	/// <summary>
+	/// False until the bounds_system found the first lod loaded.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	bool has_world_bounds() const;
+
+	//-----------------------------------------------------------------------------
+	//  Name : get_world_bounds_tick ()
+	/// <summary>
+	/// World tick the world bounds were computed at.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	std::uint32_t get_world_bounds_tick() const;
+
+	//-----------------------------------------------------------------------------
+	//  Name : set_world_bounds ()
+	/// <summary>
+	/// Stores the world bounds computed at the world tick. Does not touch the
+	/// component since they follow from the transform and the model.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	void set_world_bounds(const math::bbox& bounds, std::uint32_t tick);
+
+	//-----------------------------------------------------------------------------
+	//  Name : reset_world_bounds ()
+	/// <summary>
+	/// Marks the world bounds as unknown, for a model that is not loaded.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	void reset_world_bounds();
+
 private:
 	//-------------------------------------------------------------------------
 	// Private Member Variables.
@@ -125,4 +176,9 @@ private:
 	///
 	std::vector<runtime::entity> _bone_entities;
 	std::vector<math::transform> _bone_transforms;
+	/// world space bounds of the first lod, see get_world_bounds
+	math::bbox _world_bounds;
+	math::bsphere _world_sphere;
+	std::uint32_t _world_bounds_tick = 0;
+	bool _has_world_bounds = false;
 };
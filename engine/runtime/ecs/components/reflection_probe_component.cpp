@@ -1,4 +1,5 @@
 #include "reflection_probe_component.h"
+#include "../world_snapshot.h"
 
 int reflection_probe_component::compute_projected_sphere_rect(irect& rect, const math::vec3& position,
 															  const math::transform& view,
@@ -53,3 +54,25 @@ void reflection_probe_component::set_probe(const reflection_probe& probe)
 
 	_probe = probe;
 }
+
+namespace runtime
+{
+template <>
+struct component_snapshot<reflection_probe_component>
+{
+	static const reflection_probe& save(const reflection_probe_component& comp)
+	{
+		return comp.get_probe();
+	}
+
+	static void restore(reflection_probe_component& comp, const reflection_probe& saved)
+	{
+		comp.set_probe(saved);
+	}
+};
+}
+
+namespace
+{
+const bool snapshot_registered = runtime::register_component_snapshot<reflection_probe_component>();
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "../ecs.h"
+#include "../world_snapshot.h"
 #include <string>
 #include <unordered_set>
 
@@ -44,3 +45,26 @@ private:
 		tags.insert(tag);
 	}
 };
+
+namespace runtime
+{
+template <>
+struct component_snapshot<tags_component>
+{
+	static const std::unordered_set<std::string>& save(const tags_component& comp)
+	{
+		return comp.tags;
+	}
+
+	static void restore(tags_component& comp, const std::unordered_set<std::string>& saved)
+	{
+		comp.tags = saved;
+	}
+};
+}
+
+// The component has no translation unit of its own.
+namespace
+{
+const bool tags_snapshot_registered = runtime::register_component_snapshot<tags_component>();
+}
@@ -1,9 +1,29 @@
 #include "transform_component.h"
+#include "../world_snapshot.h"
 #include "core/logging/logging.h"
 #include <algorithm>
+#include <atomic>
+#include <mutex>
+
+namespace
+{
+std::atomic<std::uint32_t> hierarchy_version{0};
+
+std::mutex changed_mutex;
+std::vector<std::uint32_t> changed_nodes;
+std::atomic<std::uint32_t> changed_epoch{0};
+
+void hierarchy_changed()
+{
+	hierarchy_version.fetch_add(1, std::memory_order_relaxed);
+}
+}
 
 void transform_component::on_entity_set()
 {
+	if(!_children.empty())
+		hierarchy_changed();
+
 	for(auto& child : _children)
 	{
 		if(child.valid())
@@ -580,6 +600,7 @@ const runtime::entity& transform_component::get_parent() const
 void transform_component::attach_child(const runtime::entity& child)
 {
 	_children.push_back(child);
+	hierarchy_changed();
 }
 
 void transform_component::remove_child(const runtime::entity& child)
@@ -587,6 +608,7 @@ void transform_component::remove_child(const runtime::entity& child)
 	_children.erase(std::remove_if(std::begin(_children), std::end(_children),
 								   [&child](const auto& other) { return child == other; }),
 					std::end(_children));
+	hierarchy_changed();
 }
 
 void transform_component::cleanup_dead_children()
@@ -594,6 +616,7 @@ void transform_component::cleanup_dead_children()
 	_children.erase(std::remove_if(std::begin(_children), std::end(_children),
 								   [](const auto& other) { return other.valid() == false; }),
 					std::end(_children));
+	hierarchy_changed();
 }
 
 transform_component& transform_component::set_transform(const math::transform& tr)
@@ -639,25 +662,71 @@ void transform_component::resolve(bool force)
 {
 	if(force || is_dirty())
 	{
+		math::transform world_transform = _local_transform;
 		if(_parent.valid())
 		{
 			auto parent_transform = _parent.get_component<transform_component>().lock();
 			if(parent_transform)
 			{
-				_world_transform = parent_transform->get_transform() * _local_transform;
-			}
-			else
-			{
-				_world_transform = _local_transform;
+				world_transform = parent_transform->get_transform() * _local_transform;
 			}
 		}
-		else
-		{
-			_world_transform = _local_transform;
-		}
+
+		// A moved parent moves the children too, so change filters see them.
+		if(_world_transform != world_transform)
+			touch();
+
+		_world_transform = world_transform;
 	}
 }
 
+bool transform_component::resolve(const math::transform* parent_transform)
+{
+	const math::transform world_transform =
+		parent_transform ? *parent_transform * _local_transform : _local_transform;
+
+	// Any difference is passed on, however small, or the children would keep
+	// the old one.
+	const bool changed = _world_transform != world_transform;
+	if(changed)
+		component::touch();
+
+	_world_transform = world_transform;
+	return changed;
+}
+
+void transform_component::touch()
+{
+	component::touch();
+
+	const auto epoch = changed_epoch.load(std::memory_order_relaxed);
+	if(_graph_node == std::uint32_t(-1) || _changed_epoch == epoch)
+		return;
+
+	_changed_epoch = epoch;
+	std::lock_guard<std::mutex> lock(changed_mutex);
+	changed_nodes.push_back(_graph_node);
+}
+
+void transform_component::set_graph_node(std::uint32_t node)
+{
+	_graph_node = node;
+	_changed_epoch = std::uint32_t(-1);
+}
+
+void transform_component::collect_changed_nodes(std::vector<std::uint32_t>& nodes)
+{
+	nodes.clear();
+	std::lock_guard<std::mutex> lock(changed_mutex);
+	nodes.swap(changed_nodes);
+	changed_epoch.fetch_add(1, std::memory_order_relaxed);
+}
+
+std::uint32_t transform_component::get_hierarchy_version()
+{
+	return hierarchy_version.load(std::memory_order_relaxed);
+}
+
 bool transform_component::is_dirty() const
 {
 	bool dirty = component::is_dirty();
@@ -677,3 +746,43 @@ const std::vector<runtime::entity>& transform_component::get_children() const
 {
 	return _children;
 }
+
+namespace runtime
+{
+template <>
+struct component_snapshot<transform_component>
+{
+	// Written directly, the setters would attach and detach children.
+	struct state
+	{
+		runtime::entity parent;
+		std::vector<runtime::entity> children;
+		math::transform local_transform;
+		math::transform world_transform;
+	};
+
+	static state save(const transform_component& comp)
+	{
+		state saved;
+		saved.parent = comp._parent;
+		saved.children = comp._children;
+		saved.local_transform = comp._local_transform;
+		saved.world_transform = comp._world_transform;
+		return saved;
+	}
+
+	static void restore(transform_component& comp, const state& saved)
+	{
+		comp._parent = saved.parent;
+		comp._children = saved.children;
+		comp._local_transform = saved.local_transform;
+		comp._world_transform = saved.world_transform;
+		hierarchy_changed();
+	}
+};
+}
+
+namespace
+{
+const bool snapshot_registered = runtime::register_component_snapshot<transform_component>();
+}
@@ -18,6 +18,7 @@ class transform_component : public runtime::component_impl<transform_component>
 {
 	SERIALIZABLE(transform_component)
 	REFLECTABLEV(transform_component, runtime::component)
+	friend struct runtime::component_snapshot<transform_component>;
 
 public:
 	//-------------------------------------------------------------------------
@@ -56,6 +57,53 @@ public:
 	//-----------------------------------------------------------------------------
 	void resolve(bool force = false);
 
+	//-----------------------------------------------------------------------------
+	//  Name : resolve ()
+	/// <summary>
+	/// Computes the world transformation from an already resolved world
+	/// transformation of the parent, or from the local one alone when it is
+	/// null. Returns whether the world transformation changed at all. The
+	/// scene graph resolves its nodes this way, so the transform is not
+	/// reported to collect_changed_nodes.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	bool resolve(const math::transform* parent_transform);
+
+	//-----------------------------------------------------------------------------
+	//  Name : touch (virtual )
+	/// <summary>
+	/// Marks the component as changed and reports its graph node, once until
+	/// the next collect_changed_nodes.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	virtual void touch();
+
+	//-----------------------------------------------------------------------------
+	//  Name : set_graph_node ()
+	/// <summary>
+	/// Position of the transform in scene_graph::get_nodes, set when the scene
+	/// graph lays the hierarchy out. Transforms outside of it have npos.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	void set_graph_node(std::uint32_t node);
+
+	//-----------------------------------------------------------------------------
+	//  Name : collect_changed_nodes ()
+	/// <summary>
+	/// Replaces the nodes with the graph nodes of the transforms touched since
+	/// the last call, possibly several times and in no particular order.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	static void collect_changed_nodes(std::vector<std::uint32_t>& nodes);
+
+	//-----------------------------------------------------------------------------
+	//  Name : get_hierarchy_version ()
+	/// <summary>
+	/// Advances whenever any transform gains or loses a parent or a child.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	static std::uint32_t get_hierarchy_version();
+
 	//-----------------------------------------------------------------------------
 	//  Name : is_dirty (virtual )
 	/// <summary>
@@ -554,4 +602,8 @@ protected:
 	math::transform _local_transform;
 	/// Cached world transformation at pivot point.
 	math::transform _world_transform;
+	/// Position in scene_graph::get_nodes.
+	std::uint32_t _graph_node = std::uint32_t(-1);
+	/// Collection the graph node was last reported to.
+	std::uint32_t _changed_epoch = std::uint32_t(-1);
 };
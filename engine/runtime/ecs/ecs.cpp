@@ -1,9 +1,49 @@
 #include "ecs.h"
+#include "../system/events.h"
+#include "ecs_command_buffer.h"
+
+#include <cctype>
+#include <thread>
 
 namespace runtime
 {
+namespace details
+{
+std::atomic<std::uint32_t> world_tick{0};
+}
+
+namespace
+{
+std::atomic<std::uint64_t> ecs_instances{0};
+/// fewest free indices apply_command_buffers sets aside for reserve_id
+constexpr std::size_t reusable_id_count = 1024;
+
+struct cached_command_buffer
+{
+	std::uint64_t instance = 0;
+	ecs_command_buffer* buffer = nullptr;
+};
+
+std::array<std::atomic<details::component_pool_stats_t>, MAX_COMPONENTS>& get_component_pools()
+{
+	static std::array<std::atomic<details::component_pool_stats_t>, MAX_COMPONENTS> pools{};
+	return pools;
+}
+}
+
+namespace details
+{
+void register_component_pool(std::size_t family, component_pool_stats_t get_stats)
+{
+	expects(family < MAX_COMPONENTS);
+	get_component_pools()[family].store(get_stats, std::memory_order_release);
+}
+}
+
 event<void(entity)> on_entity_created;
 event<void(entity)> on_entity_destroyed;
+event<void(const std::vector<entity>&)> on_entities_created;
+event<void(const std::vector<entity>&)> on_entities_destroyed;
 event<void(entity, chandle<component>)> on_component_added;
 event<void(entity, chandle<component>)> on_component_removed;
 
@@ -41,6 +81,158 @@ std::weak_ptr<component> component_storage::set(unsigned int index, std::shared_
 	return component;
 }
 
+const std::uint32_t entity_query::npos;
+
+entity_query::entity_query(const component_mask_t& mask)
+	: mask_(mask)
+{
+}
+
+void entity_query::unlock()
+{
+	// Entities only leave a query during structural changes, which never run
+	// next to other systems, so the holes are not touched concurrently.
+	if(locks_.fetch_sub(1, std::memory_order_acq_rel) == 1 && holes_ > 0)
+		compact();
+}
+
+void entity_query::insert(std::uint32_t index)
+{
+	if(sparse_.size() <= index)
+		sparse_.resize(index + 1, npos);
+
+	sparse_[index] = static_cast<std::uint32_t>(dense_.size());
+	dense_.push_back(index);
+}
+
+void entity_query::erase(std::uint32_t index)
+{
+	expects(contains(index));
+	const auto slot = sparse_[index];
+	sparse_[index] = npos;
+
+	if(locks_.load(std::memory_order_relaxed) > 0)
+	{
+		dense_[slot] = npos;
+		++holes_;
+		return;
+	}
+
+	const auto last = dense_.back();
+	dense_.pop_back();
+	if(last != index)
+	{
+		dense_[slot] = last;
+		sparse_[last] = slot;
+	}
+}
+
+void entity_query::clear()
+{
+	dense_.clear();
+	sparse_.clear();
+	holes_ = 0;
+}
+
+void entity_query::compact()
+{
+	std::size_t count = 0;
+	for(auto index : dense_)
+	{
+		if(index == npos)
+			continue;
+
+		sparse_[index] = static_cast<std::uint32_t>(count);
+		dense_[count++] = index;
+	}
+	dense_.resize(count);
+	holes_ = 0;
+}
+
+const std::size_t archetype::chunk_bytes;
+const std::uint32_t archetype::npos;
+
+archetype::archetype(const component_mask_t& mask,
+					 const std::array<const details::chunk_type*, MAX_COMPONENTS>& types)
+	: mask_(mask)
+{
+	std::size_t row_bytes = sizeof(std::uint32_t);
+	for(std::size_t family = 0; family < MAX_COMPONENTS; ++family)
+	{
+		if(!mask.test(family))
+			continue;
+
+		expects(types[family]);
+		families_.emplace_back(family);
+		types_[family] = types[family];
+		row_bytes += types[family]->size;
+	}
+
+	// As many rows as fit once the columns are aligned.
+	const auto align = [](std::size_t offset, std::size_t alignment) {
+		return (offset + alignment - 1) / alignment * alignment;
+	};
+	for(rows_per_chunk_ = chunk_bytes / row_bytes; rows_per_chunk_ > 0; --rows_per_chunk_)
+	{
+		std::size_t offset = 0;
+		for(auto family : families_)
+		{
+			offset = align(offset, types_[family]->align);
+			offsets_[family] = offset;
+			offset += rows_per_chunk_ * types_[family]->size;
+		}
+		indices_offset_ = align(offset, alignof(std::uint32_t));
+		if(indices_offset_ + rows_per_chunk_ * sizeof(std::uint32_t) <= chunk_bytes)
+			break;
+	}
+	expects(rows_per_chunk_ > 0 && "chunk components too large for a chunk");
+}
+
+std::uint32_t archetype::push(std::uint32_t index)
+{
+	const auto row = static_cast<std::uint32_t>(size_);
+	if(row / rows_per_chunk_ == chunks_.size())
+		chunks_.emplace_back(new chunk);
+
+	++size_;
+	indices(row / rows_per_chunk_)[row % rows_per_chunk_] = index;
+	return row;
+}
+
+void archetype::destroy(std::uint32_t row)
+{
+	for(auto family : families_)
+		types_[family]->destroy(get(row, family));
+}
+
+std::uint32_t archetype::remove(std::uint32_t row)
+{
+	expects(row < size_);
+	const auto last = static_cast<std::uint32_t>(size_ - 1);
+	auto moved = npos;
+	if(row != last)
+	{
+		for(auto family : families_)
+			types_[family]->relocate(get(row, family), get(last, family));
+
+		moved = index(last);
+		indices(row / rows_per_chunk_)[row % rows_per_chunk_] = moved;
+	}
+	--size_;
+
+	// One empty chunk is kept, so that an entity going back and forth at the
+	// end does not allocate every time.
+	while(chunks_.size() > chunk_count() + 1)
+		chunks_.pop_back();
+	return moved;
+}
+
+entity chunk_view::get_entity(std::size_t row) const
+{
+	expects(row < size());
+	return entity(manager_, manager_->create_id(indices()[row]));
+}
+
 /////////////////////////////////////////////////////////////////////////////
 const entity::id_t entity::INVALID;
 
@@ -50,7 +242,7 @@ void entity::set_name(std::string name)
 	manager_->set_entity_name(id_, name);
 }
 
-const std::string& entity::get_name() const
+std::string entity::get_name() const
 {
 	expects(valid());
 	return manager_->get_entity_name(id_);
@@ -75,17 +267,43 @@ std::bitset<MAX_COMPONENTS> entity::component_mask() const
 }
 
 entity_component_system::entity_component_system()
+	: instance_id_(++ecs_instances)
+	, names_(std::make_shared<name_table>())
 {
 }
 
 entity_component_system::~entity_component_system()
 {
+	on_frame_end.disconnect(this, &entity_component_system::frame_end);
 	dispose();
 }
 
+bool entity_component_system::initialize()
+{
+	on_frame_end.connect(this, &entity_component_system::frame_end);
+	return true;
+}
+
+void entity_component_system::frame_end(std::chrono::duration<float>)
+{
+	details::world_tick.fetch_add(1, std::memory_order_relaxed);
+
+	const auto& pools = get_component_pools();
+	for(std::size_t family = 0; family < pools.size(); ++family)
+	{
+		const auto get_stats = pools[family].load(std::memory_order_acquire);
+		if(!get_stats)
+			continue;
+
+		const auto allocations = get_stats().allocations;
+		pool_allocations_per_frame_[family] = allocations - pool_allocations_[family];
+		pool_allocations_[family] = allocations;
+	}
+}
+
 size_t entity_component_system::size() const
 {
-	return entity_component_mask_.size() - free_list_.size();
+	return size_;
 }
 
 size_t entity_component_system::capacity() const
@@ -104,11 +322,18 @@ bool entity_component_system::valid_index(uint32_t index) const
 }
 
 entity entity_component_system::create()
+{
+	auto entity = create_unannounced();
+	on_entity_created(entity);
+	return entity;
+}
+
+entity entity_component_system::create_unannounced()
 {
 	std::uint32_t index, version;
 	if(free_list_.empty())
 	{
-		index = index_counter_++;
+		index = index_counter_.fetch_add(1, std::memory_order_relaxed);
 		accomodate_entity(index);
 		version = entity_version_[index] = 1;
 	}
@@ -118,33 +343,314 @@ entity entity_component_system::create()
 		free_list_.pop_back();
 		version = entity_version_[index];
 	}
-	entity entity(this, entity::id_t(index, version));
+	++size_;
+	update_queries(index, component_mask_t(), false, component_mask_t(), true);
+	return entity(this, entity::id_t(index, version));
+}
+
+void entity_component_system::reserve(std::size_t n)
+{
+	entity_component_mask_.reserve(n);
+	entity_version_.reserve(n);
+	entity_name_ids_.reserve(n);
+	entity_chunk_rows_.reserve(n);
+	for(auto& pool : component_pools_)
+	{
+		if(pool)
+			pool->reserve(n);
+	}
+}
+
+void entity_component_system::create_many(std::size_t n, std::vector<entity>& out)
+{
+	if(n == 0)
+		return;
+
+	const auto first = out.size();
+	out.reserve(first + n);
+
+	const auto reused = std::min(n, free_list_.size());
+	for(std::size_t i = 0; i < reused; ++i)
+	{
+		const auto index = free_list_.back();
+		free_list_.pop_back();
+		out.emplace_back(this, entity::id_t(index, entity_version_[index]));
+	}
+
+	const auto fresh = static_cast<std::uint32_t>(n - reused);
+	if(fresh > 0)
+	{
+		const auto begin = index_counter_.fetch_add(fresh, std::memory_order_relaxed);
+		accomodate_entity(begin + fresh - 1);
+		for(auto index = begin; index < begin + fresh; ++index)
+		{
+			entity_version_[index] = 1;
+			out.emplace_back(this, entity::id_t(index, 1));
+		}
+	}
+	size_ += n;
+
+	// New entities have no components, only queries with an empty mask take them.
+	for(auto& query : queries_)
+	{
+		if(!query->matches(component_mask_t()))
+			continue;
+
+		for(auto i = first; i < out.size(); ++i)
+			query->insert(out[i].id().index());
+	}
+
+	if(first == 0)
+	{
+		on_entities_created(out);
+	}
+	else
+	{
+		const std::vector<entity> created(out.begin() + static_cast<std::ptrdiff_t>(first), out.end());
+		on_entities_created(created);
+	}
+}
+
+entity::id_t entity_component_system::reserve_id()
+{
+	// The free list belongs to the owner thread, only the indices set aside
+	// for reserve_id are reused here.
+	const auto slot = reusable_next_.fetch_add(1, std::memory_order_relaxed);
+	if(slot < reusable_ids_.size())
+		return reusable_ids_[slot];
+
+	return entity::id_t(index_counter_.fetch_add(1, std::memory_order_relaxed), 1);
+}
+
+entity entity_component_system::create_reserved(entity::id_t id)
+{
+	const auto index = id.index();
+	accomodate_entity(index);
+	expects(entity_version_[index] == 0 && "entity id was not reserved or is already created");
+	entity_version_[index] = id.version();
+
+	++size_;
+	update_queries(index, component_mask_t(), false, component_mask_t(), true);
+	entity entity(this, id);
 	on_entity_created(entity);
 	return entity;
 }
 
-void entity_component_system::set_entity_name(entity::id_t id, std::string name)
+void entity_component_system::release_reserved_ids(const std::vector<entity::id_t>& ids)
 {
-	entity_names_[id.id()] = name;
+	std::lock_guard<std::mutex> lock(released_ids_mutex_);
+	released_ids_.insert(released_ids_.end(), ids.begin(), ids.end());
 }
 
-const std::string& entity_component_system::get_entity_name(entity::id_t id)
+void entity_component_system::return_reserved_ids()
 {
-	return entity_names_[id.id()];
+	// The ids handed out are created by now or released, the others go back
+	// so that they are taken again in the same order.
+	const auto used = std::min(reusable_next_.load(std::memory_order_relaxed), reusable_ids_.size());
+	for(auto i = reusable_ids_.size(); i > used; --i)
+	{
+		const auto id = reusable_ids_[i - 1];
+		entity_version_[id.index()] = id.version();
+		free_list_.push_back(id.index());
+	}
+	reusable_ids_.clear();
+	reusable_next_.store(0, std::memory_order_relaxed);
+
+	std::lock_guard<std::mutex> lock(released_ids_mutex_);
+	for(const auto& id : released_ids_)
+	{
+		// The next version keeps the handles to the dropped entity invalid.
+		accomodate_entity(id.index());
+		entity_version_[id.index()] = id.version() + 1;
+		free_list_.push_back(id.index());
+	}
+	released_ids_.clear();
+}
+
+void entity_component_system::recycle_reserved_ids()
+{
+	// As many as were reserved since the last time, so that a steady rate of
+	// reservations does not grow the storage.
+	const auto reserved = reusable_next_.load(std::memory_order_relaxed);
+	return_reserved_ids();
+
+	// Version 0 marks the indices as reserved, nothing else takes them.
+	const auto count = std::min(std::max(reusable_id_count, reserved), free_list_.size());
+	reusable_ids_.reserve(count);
+	for(std::size_t i = 0; i < count; ++i)
+	{
+		const auto index = free_list_.back();
+		free_list_.pop_back();
+		reusable_ids_.emplace_back(index, entity_version_[index]);
+		entity_version_[index] = 0;
+	}
+}
+
+ecs_command_buffer& entity_component_system::get_command_buffer()
+{
+	// A thread may record into several instances, the cache only saves taking
+	// the lock. Each thread has one buffer per instance whatever it holds.
+	thread_local std::array<cached_command_buffer, 4> cache;
+	thread_local std::size_t next_slot = 0;
+	for(const auto& cached : cache)
+	{
+		if(cached.instance == instance_id_)
+			return *cached.buffer;
+	}
+
+	ecs_command_buffer* buffer = nullptr;
+	{
+		const auto thread = std::this_thread::get_id();
+		std::lock_guard<std::mutex> lock(command_buffers_mutex_);
+		auto it = std::find_if(std::begin(command_buffers_), std::end(command_buffers_),
+							   [thread](const thread_command_buffer& entry) { return entry.first == thread; });
+		if(it == std::end(command_buffers_))
+		{
+			command_buffers_.emplace_back(thread, std::unique_ptr<ecs_command_buffer>(new ecs_command_buffer(*this)));
+			it = std::prev(std::end(command_buffers_));
+		}
+		buffer = it->second.get();
+	}
+
+	auto& cached = cache[next_slot++ % cache.size()];
+	cached.instance = instance_id_;
+	cached.buffer = buffer;
+	return *buffer;
+}
+
+void entity_component_system::apply_command_buffers()
+{
+	// Handlers fired while applying may ask for a buffer of their own, so the
+	// list is not locked meanwhile. Buffers are never removed.
+	std::vector<ecs_command_buffer*> buffers;
+	{
+		std::lock_guard<std::mutex> lock(command_buffers_mutex_);
+		buffers.reserve(command_buffers_.size());
+		for(auto& entry : command_buffers_)
+			buffers.emplace_back(entry.second.get());
+	}
+
+	// A thread may record commands on an entity another thread reserved, so
+	// every recorded entity exists before any other command is applied.
+	for(auto buffer : buffers)
+		buffer->apply_creates();
+	for(auto buffer : buffers)
+		buffer->apply();
+
+	recycle_reserved_ids();
+}
+
+void entity_component_system::set_entity_name(entity::id_t id, const std::string& name)
+{
+	assert_valid(id);
+	entity_name_ids_[id.index()] = names_->intern(name);
+}
+
+std::string entity_component_system::get_entity_name(entity::id_t id) const
+{
+	assert_valid(id);
+	const auto name = entity_name_ids_[id.index()];
+	return std::string(names_->get(name), names_->length(name));
+}
+
+name_table::name_id entity_component_system::get_entity_name_id(entity::id_t id) const
+{
+	assert_valid(id);
+	return entity_name_ids_[id.index()];
+}
+
+std::vector<entity> entity_component_system::find_entities_by_name(const std::string& name)
+{
+	std::vector<entity> result;
+	const auto name_id = names_->find(name);
+	if(name_id == name_table::empty || name_id == name_table::npos)
+		return result;
+
+	// Free slots and reserved ids have no name.
+	for(std::uint32_t index = 0; index < entity_name_ids_.size(); ++index)
+	{
+		if(entity_name_ids_[index] == name_id)
+			result.emplace_back(this, create_id(index));
+	}
+	return result;
+}
+
+std::vector<entity> entity_component_system::search_entities_by_name(const std::string& text)
+{
+	std::vector<entity> result;
+	if(text.empty())
+		return result;
+
+	const auto equal = [](char lhs, char rhs) {
+		return std::tolower(static_cast<unsigned char>(lhs)) == std::tolower(static_cast<unsigned char>(rhs));
+	};
+
+	std::vector<bool> matches(names_->size(), false);
+	bool any = false;
+	for(name_table::name_id name = 1; name < names_->size(); ++name)
+	{
+		const auto begin = names_->get(name);
+		const auto end = begin + names_->length(name);
+		matches[name] = std::search(begin, end, text.begin(), text.end(), equal) != end;
+		any = any || matches[name];
+	}
+
+	if(!any)
+		return result;
+
+	for(std::uint32_t index = 0; index < entity_name_ids_.size(); ++index)
+	{
+		if(matches[entity_name_ids_[index]])
+			result.emplace_back(this, create_id(index));
+	}
+	return result;
+}
+
+name_table::memory_stats entity_component_system::get_name_memory_stats() const
+{
+	auto stats = names_->get_memory_stats();
+	stats.lookup_bytes += entity_name_ids_.capacity() * sizeof(name_table::name_id);
+	return stats;
 }
 
 void entity_component_system::dispose()
 {
-	for(entity entity : all_entities())
+	auto& all = get_query(component_mask_t());
+	std::vector<entity::id_t> ids;
+	ids.reserve(all.size());
+	for(std::size_t slot = 0; slot < all.slots(); ++slot)
 	{
-		entity.destroy();
+		const auto index = all.at(slot);
+		if(index != entity_query::npos)
+			ids.emplace_back(create_id(index));
 	}
+	destroy_many(ids);
 
 	component_pools_.clear();
+	archetypes_.clear();
+	archetype_lookup_.clear();
+	entity_chunk_rows_.clear();
 	entity_component_mask_.clear();
 	entity_version_.clear();
 	free_list_.clear();
+	for(auto& query : queries_)
+		query->clear();
+	entity_name_ids_.clear();
+	// Snapshots may still refer to the old names.
+	names_ = std::make_shared<name_table>();
 	index_counter_ = 0;
+	size_ = 0;
+
+	{
+		std::lock_guard<std::mutex> lock(command_buffers_mutex_);
+		for(auto& entry : command_buffers_)
+			entry.second->clear();
+	}
+	// The ids are of the entities disposed of.
+	reusable_ids_.clear();
+	reusable_next_.store(0, std::memory_order_relaxed);
+	std::lock_guard<std::mutex> lock(released_ids_mutex_);
+	released_ids_.clear();
 }
 
 void entity_component_system::remove(entity::id_t id, std::shared_ptr<component> component)
@@ -156,16 +662,27 @@ void entity_component_system::remove(entity::id_t id, const rtti::type_index_seq
 {
 	assert_valid(id);
 	const std::uint32_t index = id.index();
+	if(chunk_families_.test(family))
+	{
+		remove_chunk_component(index, family);
+		return;
+	}
 
 	// Find the pool for this component family.
 	auto& pool = component_pools_[family];
 	chandle<component> handle(pool->get(id.index()));
 	on_component_removed(get(id), handle);
 	// Remove component bit.
-	entity_component_mask_[id.index()].reset(family);
+	const auto before = entity_component_mask_[index];
+	entity_component_mask_[index].reset(family);
+	update_queries(index, before, true, entity_component_mask_[index], true);
+
+	pool->get_raw(index)->_storage_tick = nullptr;
+	pool->changed_tick.store(get_tick(), std::memory_order_relaxed);
 
 	// Call destructor.
 	pool->destroy(index);
+	--pool->live;
 }
 
 bool entity_component_system::has_component(entity::id_t id, std::shared_ptr<component> component) const
@@ -177,6 +694,8 @@ bool entity_component_system::has_component(entity::id_t id,
 											rtti::type_index_sequential_t::index_t family) const
 {
 	assert_valid(id);
+	if(chunk_families_.test(family))
+		return entity_component_mask_[id.index()][family];
 	// We don't bother checking the component mask, as we return a nullptr anyway.
 	if(family >= component_pools_.size())
 		return false;
@@ -227,9 +746,28 @@ chandle<component> entity_component_system::assign(entity::id_t id, std::shared_
 	// Placement new into the component pool.
 	auto& pool = accomodate_component(family);
 
+	// A replaced component may outlive the pool.
+	if(entity_component_mask_[id.index()].test(family))
+		pool.get_raw(id.index())->_storage_tick = nullptr;
+	else
+		++pool.live;
+
+	if(pool.type_name.empty())
+	{
+		const auto type = rttr::type::get(*comp);
+		pool.type_name = type.get_name().to_string();
+		pool.object_size = type.get_sizeof();
+	}
+
 	auto ptr = pool.set(id.index(), comp);
 	// Set the bit for this component.
+	const auto before = entity_component_mask_[id.index()];
 	entity_component_mask_[id.index()].set(family);
+	update_queries(id.index(), before, true, entity_component_mask_[id.index()], true);
+
+	// Adding counts as a change.
+	comp->_storage_tick = &pool.changed_tick;
+	comp->touch();
 
 	// Create and return handle.
 	comp->_entity = get(id);
@@ -241,9 +779,9 @@ chandle<component> entity_component_system::assign(entity::id_t id, std::shared_
 
 void entity_component_system::destroy(entity::id_t id)
 {
-	entity_names_[id.id()] = "";
 	assert_valid(id);
 	std::uint32_t index = id.index();
+	entity_name_ids_[index] = name_table::empty;
 	auto mask = entity_component_mask_[index];
 	for(size_t i = 0; i < component_pools_.size(); ++i)
 	{
@@ -258,10 +796,167 @@ void entity_component_system::destroy(entity::id_t id)
 		}
 	}
 
+	if(entity_chunk_rows_[index].type != archetype::npos)
+	{
+		const auto before = entity_component_mask_[index];
+		release_chunk_row(index);
+		entity_component_mask_[index] &= ~chunk_families_;
+		update_queries(index, before, true, entity_component_mask_[index], true);
+	}
+
 	on_entity_destroyed(get(id));
+	update_queries(index, entity_component_mask_[index], true, component_mask_t(), false);
 	entity_component_mask_[index].reset();
 	entity_version_[index]++;
 	free_list_.push_back(index);
+	--size_;
+}
+
+void entity_component_system::destroy_many(const entity::id_t* ids, std::size_t count)
+{
+	if(count == 0)
+		return;
+
+	std::vector<entity> entities;
+	entities.reserve(count);
+	for(std::size_t i = 0; i < count; ++i)
+	{
+		assert_valid(ids[i]);
+		entities.emplace_back(this, ids[i]);
+	}
+
+	// Released once the batch is done, destructors may destroy further entities.
+	std::vector<std::shared_ptr<component>> released;
+
+	const auto tick = get_tick();
+	for(const auto& e : entities)
+	{
+		const auto index = e.id().index();
+		const auto mask = entity_component_mask_[index];
+		for(std::size_t i = 0; i < component_pools_.size(); ++i)
+		{
+			if(mask.test(i) && component_pools_[i])
+				on_component_removed(e, chandle<component>(component_pools_[i]->get(index)));
+		}
+
+		if(entity_chunk_rows_[index].type != archetype::npos)
+			release_chunk_row(index);
+
+		// Leave the queries in one step.
+		entity_component_mask_[index].reset();
+		update_queries(index, mask, true, component_mask_t(), true);
+
+		for(std::size_t i = 0; i < component_pools_.size(); ++i)
+		{
+			if(!mask.test(i) || !component_pools_[i])
+				continue;
+
+			auto& pool = *component_pools_[i];
+			pool.get_raw(index)->_storage_tick = nullptr;
+			pool.changed_tick.store(tick, std::memory_order_relaxed);
+			released.emplace_back(pool.get(index));
+			pool.destroy(index);
+			--pool.live;
+		}
+	}
+
+	on_entities_destroyed(entities);
+
+	for(const auto& e : entities)
+	{
+		const auto index = e.id().index();
+		entity_name_ids_[index] = name_table::empty;
+		update_queries(index, component_mask_t(), true, component_mask_t(), false);
+		entity_version_[index]++;
+		free_list_.push_back(index);
+	}
+	size_ -= count;
+
+	released.clear();
+}
+
+void* entity_component_system::place_chunk_component(std::uint32_t index, std::size_t family)
+{
+	const auto& location = entity_chunk_rows_[index];
+	const auto before = entity_component_mask_[index];
+	if(before.test(family))
+	{
+		auto value = archetypes_[location.type]->get(location.row, family);
+		chunk_types_[family]->destroy(value);
+		return value;
+	}
+
+	auto mask = before & chunk_families_;
+	move_chunk_row(index, get_archetype(mask.set(family)));
+
+	entity_component_mask_[index].set(family);
+	update_queries(index, before, true, entity_component_mask_[index], true);
+	return archetypes_[location.type]->get(location.row, family);
+}
+
+void entity_component_system::remove_chunk_component(std::uint32_t index, std::size_t family)
+{
+	const auto& location = entity_chunk_rows_[index];
+	const auto before = entity_component_mask_[index];
+	expects(before.test(family));
+
+	chunk_types_[family]->destroy(archetypes_[location.type]->get(location.row, family));
+	auto mask = before & chunk_families_;
+	mask.reset(family);
+	move_chunk_row(index, mask.none() ? archetype::npos : get_archetype(mask));
+
+	entity_component_mask_[index].reset(family);
+	update_queries(index, before, true, entity_component_mask_[index], true);
+}
+
+void entity_component_system::release_chunk_row(std::uint32_t index)
+{
+	const auto& location = entity_chunk_rows_[index];
+	archetypes_[location.type]->destroy(location.row);
+	move_chunk_row(index, archetype::npos);
+}
+
+void entity_component_system::move_chunk_row(std::uint32_t index, std::uint32_t type)
+{
+	auto& location = entity_chunk_rows_[index];
+	chunk_row to;
+	if(type != archetype::npos)
+	{
+		to.type = type;
+		to.row = archetypes_[type]->push(index);
+	}
+
+	if(location.type != archetype::npos)
+	{
+		// Values the new archetype does not have were destroyed already.
+		auto& from = *archetypes_[location.type];
+		if(to.type != archetype::npos)
+		{
+			auto& target = *archetypes_[to.type];
+			for(std::size_t family = 0; family < MAX_COMPONENTS; ++family)
+			{
+				if(from.mask().test(family) && target.mask().test(family))
+					chunk_types_[family]->relocate(target.get(to.row, family), from.get(location.row, family));
+			}
+		}
+
+		const auto moved = from.remove(location.row);
+		if(moved != archetype::npos)
+			entity_chunk_rows_[moved].row = location.row;
+	}
+	location = to;
+}
+
+std::uint32_t entity_component_system::get_archetype(const component_mask_t& mask)
+{
+	auto it = archetype_lookup_.find(mask);
+	if(it != archetype_lookup_.end())
+		return it->second;
+
+	const auto type = static_cast<std::uint32_t>(archetypes_.size());
+	archetypes_.emplace_back(new archetype(mask, chunk_types_));
+	archetype_lookup_.emplace(mask, type);
+	return type;
 }
 
 entity entity_component_system::get(entity::id_t id)
@@ -270,6 +965,115 @@ entity entity_component_system::get(entity::id_t id)
 	return entity(this, id);
 }
 
+entity_query& entity_component_system::get_query(const component_mask_t& mask)
+{
+	std::lock_guard<std::mutex> lock(query_mutex_);
+	auto it = query_lookup_.find(mask);
+	if(it != query_lookup_.end())
+		return *it->second;
+
+	queries_.emplace_back(new entity_query(mask));
+	auto& query = *queries_.back();
+	query_lookup_.emplace(mask, &query);
+
+	// Filled once with a scan, kept up to date after that.
+	std::vector<bool> is_free(capacity(), false);
+	for(auto index : free_list_)
+		is_free[index] = true;
+
+	// Version 0 is a reserved id that was not created yet.
+	for(std::uint32_t index = 0; index < capacity(); ++index)
+	{
+		if(!is_free[index] && entity_version_[index] != 0 && query.matches(entity_component_mask_[index]))
+			query.insert(index);
+	}
+
+	return query;
+}
+
+void entity_component_system::update_queries(std::uint32_t index, const component_mask_t& before,
+											 bool was_alive, const component_mask_t& after, bool alive)
+{
+	for(auto& query : queries_)
+	{
+		const bool was_in = was_alive && query->matches(before);
+		const bool is_in = alive && query->matches(after);
+		if(was_in == is_in)
+			continue;
+
+		if(is_in)
+			query->insert(index);
+		else
+			query->erase(index);
+	}
+}
+
+std::vector<component_pool_stats> entity_component_system::get_component_pool_stats()
+{
+	std::vector<component_pool_stats> result;
+	const auto& pools = get_component_pools();
+	for(std::size_t family = 0; family < pools.size(); ++family)
+	{
+		const auto get_stats = pools[family].load(std::memory_order_acquire);
+		if(!get_stats)
+			continue;
+
+		component_pool_stats stats;
+		stats.family = family;
+		stats.pool = get_stats();
+		result.emplace_back(stats);
+	}
+	return result;
+}
+
+std::vector<component_memory_stats> entity_component_system::get_component_memory_stats() const
+{
+	std::vector<component_memory_stats> result;
+	const auto& pools = get_component_pools();
+	const auto slot_size = sizeof(std::shared_ptr<component>);
+	for(std::size_t family = 0; family < component_pools_.size(); ++family)
+	{
+		const auto& storage = component_pools_[family];
+		if(!storage)
+			continue;
+
+		component_memory_stats stats;
+		stats.family = family;
+		stats.type_name = storage->type_name;
+		stats.live = storage->live;
+		stats.capacity = storage->capacity();
+		stats.bytes_used = stats.live * (slot_size + storage->object_size);
+		stats.bytes_wasted = (stats.capacity - stats.live) * slot_size;
+
+		const auto get_stats = family < pools.size() ? pools[family].load(std::memory_order_acquire) : nullptr;
+		if(get_stats)
+		{
+			// The control block shares the block, it counts as padding.
+			const auto pool = get_stats();
+			const auto object_size = storage->object_size > 0 && storage->object_size < pool.block_size
+										 ? storage->object_size
+										 : pool.block_size;
+			stats.bytes_used = stats.live * (slot_size + object_size);
+			stats.bytes_wasted += stats.live * (pool.block_size - object_size);
+			stats.bytes_wasted += (pool.capacity - pool.size) * pool.block_size;
+			stats.allocations_per_frame = pool_allocations_per_frame_[family];
+		}
+
+		result.emplace_back(std::move(stats));
+	}
+	return result;
+}
+
+void entity_component_system::write_component_memory_csv(std::ostream& out) const
+{
+	out << "family,type,live,capacity,bytes_used,bytes_wasted,allocations_per_frame\n";
+	for(const auto& stats : get_component_memory_stats())
+	{
+		out << stats.family << ',' << stats.type_name << ',' << stats.live << ',' << stats.capacity << ','
+			<< stats.bytes_used << ',' << stats.bytes_wasted << ',' << stats.allocations_per_frame << '\n';
+	}
+}
+
 entity::id_t entity_component_system::create_id(uint32_t index) const
 {
 	return entity::id_t(index, entity_version_[index]);
@@ -2,14 +2,20 @@
 
 #include "core/common/assert.hpp"
 #include "core/common/nonstd/type_traits.hpp"
+#include "core/memory/pool_allocator.hpp"
 #include "core/reflection/registration.h"
 #include "core/serialization/serialization.h"
 #include "core/signals/event.hpp"
+#include "core/system/parallel.h"
 #include "core/system/simulation.h"
 #include "core/system/subsystem.h"
+#include "name_table.h"
 
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <bitset>
+#include <chrono>
 #include <cstdint>
 #include <cstdlib>
 #include <functional>
@@ -21,8 +27,10 @@
 #include <set>
 #include <sstream>
 #include <string>
+#include <thread>
 #include <tuple>
 #include <type_traits>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -31,6 +39,37 @@ namespace runtime
 static const std::size_t MAX_COMPONENTS = 128;
 
 class component;
+
+template <typename C, typename... Args>
+std::shared_ptr<C> make_component(Args&&... args);
+
+//-----------------------------------------------------------------------------
+//  Name : component_snapshot (Struct)
+/// <summary>
+/// Specialized for every component type, world snapshots save and restore
+/// the state of the components through it, see register_component_snapshot.
+/// A specialization provides static state save(const C&), which may return a
+/// const reference, and static void restore(C&, const state&). Both are
+/// called once per component, even for trivially copyable state. Entity ids
+/// in the state are kept as they are. Types without one keep their current
+/// state when a snapshot is restored.
+/// </summary>
+//-----------------------------------------------------------------------------
+template <typename C>
+struct component_snapshot;
+
+namespace details
+{
+/// World tick of the entity_component_system, advanced once per frame.
+/// Component changes are stamped with it.
+extern std::atomic<std::uint32_t> world_tick;
+
+using component_pool_stats_t = core::memory_pool_stats (*)();
+/// Makes the pool of a component family visible to
+/// entity_component_system::get_component_pool_stats.
+void register_component_pool(std::size_t family, component_pool_stats_t get_stats);
+}
+
 class component_storage
 {
 public:
@@ -62,22 +101,157 @@ public:
 	template <typename T, typename... Args>
 	std::weak_ptr<T> set(unsigned int index, Args&&... args)
 	{
-		auto element = std::make_shared<T>(std::forward<Args>(args)...);
+		auto element = make_component<T>(std::forward<Args>(args)...);
 		data[index] = std::move(element);
 		return std::static_pointer_cast<T>(data[index]);
 	}
 
 	std::weak_ptr<component> set(unsigned int index, std::shared_ptr<component> component);
 
+	/// Raw pointer to the component at n, does not touch the reference count.
+	inline component* get_raw(std::size_t n) const
+	{
+		return data[n].get();
+	}
+
+	/// Last world tick any component of the pool changed, was added or removed.
+	inline std::uint32_t get_changed_tick() const
+	{
+		return changed_tick.load(std::memory_order_relaxed);
+	}
+
 private:
+	friend class component;
+	friend class entity_component_system;
+
 	std::vector<std::shared_ptr<component>> data;
+	std::atomic<std::uint32_t> changed_tick{0};
+	/// components attached right now
+	std::size_t live = 0;
+	/// rttr name and size of the type, taken from the first component assigned
+	std::string type_name;
+	std::size_t object_size = 0;
 };
 
 class entity_component_system;
+class ecs_command_buffer;
+class world_snapshot;
 
 template <typename C>
 using chandle = std::weak_ptr<C>;
 
+namespace details
+{
+/// Family ids of chunk components, taken from the same sequence as the ids
+/// of the component types so that both share the component masks.
+struct chunk_family : rtti::type_index_sequential_t
+{
+	template <typename T>
+	static index_t id()
+	{
+		static index_t sid = get_counter<component>()++;
+		return sid;
+	}
+};
+
+//-----------------------------------------------------------------------------
+//  Name : chunk_type (Struct)
+/// <summary>
+/// How the values of a chunk component type are laid out in the chunks,
+/// moved from one row to another and destroyed.
+/// </summary>
+//-----------------------------------------------------------------------------
+struct chunk_type
+{
+	std::size_t size = 0;
+	std::size_t align = 0;
+	/// move constructs the value at dst from the one at src and destroys src
+	void (*relocate)(void* dst, void* src) = nullptr;
+	void (*destroy)(void* value) = nullptr;
+};
+
+template <typename T>
+const chunk_type& get_chunk_type()
+{
+	static_assert(alignof(T) <= alignof(std::max_align_t), "Over-aligned chunk components are not supported.");
+
+	static const chunk_type type = []() {
+		chunk_type t;
+		t.size = sizeof(T);
+		t.align = alignof(T);
+		t.relocate = [](void* dst, void* src) {
+			auto& value = *static_cast<T*>(src);
+			new(dst) T(std::move(value));
+			value.~T();
+		};
+		t.destroy = [](void* value) { static_cast<T*>(value)->~T(); };
+		return t;
+	}();
+	return type;
+}
+}
+
+//-----------------------------------------------------------------------------
+//  Name : chunk_component (Class)
+/// <summary>
+/// Base of the components stored by value in the 16KB chunks of their
+/// archetype instead of one shared_ptr per entity. They are plain data: no
+/// virtual functions, no handles and no events, and their destructors must
+/// not use the entity_component_system. A component_impl<T> type moves over
+/// by deriving from chunk_component<T> instead. assign and get_component
+/// then return a T* in place of a chandle<T>, each is replaced by
+/// for_each_chunk, and has_component and remove work as before. Ecs command
+/// buffers may remove them but not assign them. World snapshots do not save
+/// them.
+/// </summary>
+//-----------------------------------------------------------------------------
+template <typename T>
+struct chunk_component
+{
+	static rtti::type_index_sequential_t::index_t static_id()
+	{
+		return details::chunk_family::id<T>();
+	}
+};
+
+template <typename C>
+struct is_chunk_component : std::is_base_of<chunk_component<C>, C>
+{
+};
+
+/// What assign and get_component return for a component type, a raw pointer
+/// into the chunk for chunk components.
+template <typename C>
+using component_ref = typename std::conditional<is_chunk_component<C>::value, C*, chandle<C>>::type;
+
+namespace details
+{
+template <typename C>
+rtti::type_index_sequential_t::index_t component_family(std::false_type)
+{
+	return rtti::type_index_sequential_t::id<component, C>();
+}
+
+template <typename C>
+rtti::type_index_sequential_t::index_t component_family(std::true_type)
+{
+	return chunk_family::id<C>();
+}
+}
+
+//-----------------------------------------------------------------------------
+//  Name : component_family ()
+/// <summary>
+/// Family of a component or chunk component type, its bit in the component
+/// masks.
+/// </summary>
+//-----------------------------------------------------------------------------
+template <typename C>
+rtti::type_index_sequential_t::index_t component_family()
+{
+	return details::component_family<C>(is_chunk_component<C>());
+}
+
 /** A convenience handle around an entity::Id.
  *
  * If an entity is destroyed, any copies will be invalidated. Use valid() to
@@ -177,7 +351,7 @@ public:
 		return other.id_ < id_;
 	}
 	void set_name(std::string name);
-	const std::string& get_name() const;
+	std::string get_name() const;
 	/**
 	 * Is this entity handle valid?
 	 *
@@ -205,7 +379,7 @@ public:
 	}
 
 	template <typename C, typename... Args>
-	chandle<C> assign(Args&&... args);
+	component_ref<C> assign(Args&&... args);
 
 	chandle<component> assign(std::shared_ptr<component> component);
 
@@ -215,7 +389,7 @@ public:
 	void remove(std::shared_ptr<component> component);
 
 	template <typename C>
-	chandle<C> get_component() const;
+	component_ref<C> get_component() const;
 
 	template <typename... Components>
 	std::tuple<chandle<Components>...> components() const;
@@ -296,7 +470,11 @@ public:
 	//-----------------------------------------------------------------------------
 	virtual void touch()
 	{
-		_last_touched = static_cast<std::uint32_t>(core::get_subsystem<core::simulation>().get_frame()) + 1;
+		_last_touched = details::world_tick.load(std::memory_order_relaxed);
+		// Only written when it moves so components touched from several
+		// threads do not keep fighting over the cache line.
+		if(_storage_tick && _storage_tick->load(std::memory_order_relaxed) != _last_touched)
+			_storage_tick->store(_last_touched, std::memory_order_relaxed);
 	}
 
 	//-----------------------------------------------------------------------------
@@ -309,8 +487,19 @@ public:
 	//-----------------------------------------------------------------------------
 	virtual bool is_dirty() const
 	{
-		return _last_touched >=
-			   static_cast<std::uint32_t>(core::get_subsystem<core::simulation>().get_frame());
+		// Changed this frame or the previous one.
+		return _last_touched + 1 >= details::world_tick.load(std::memory_order_relaxed);
+	}
+
+	//-----------------------------------------------------------------------------
+	//  Name : get_changed_tick ()
+	/// <summary>
+	/// World tick of the last change of the component.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	std::uint32_t get_changed_tick() const
+	{
+		return _last_touched;
 	}
 
 	//-----------------------------------------------------------------------------
@@ -348,8 +537,10 @@ protected:
 	/// </summary>
 	//-----------------------------------------------------------------------------
 	virtual rtti::type_index_sequential_t::index_t runtime_id() const = 0;
-	/// Was the component touched.
+	/// World tick the component was last touched.
 	std::uint32_t _last_touched = 0;
+	/// Changed tick of the pool holding the component.
+	std::atomic<std::uint32_t>* _storage_tick = nullptr;
 	/// Owning entity
 	entity _entity;
 };
@@ -379,11 +570,303 @@ public:
 	}
 };
 
+/// Components of one type share a pool, together with their control block.
+template <typename C>
+using component_allocator = core::pool_allocator<C>;
+
+//-----------------------------------------------------------------------------
+//  Name : make_component ()
+/// <summary>
+/// Creates a component in the pool of its type. Used by assign<C>, so that
+/// components of one type sit together and creating and destroying them
+/// does not go to the global heap.
+/// </summary>
+//-----------------------------------------------------------------------------
+template <typename C, typename... Args>
+std::shared_ptr<C> make_component(Args&&... args)
+{
+	static const bool registered =
+		(details::register_component_pool(rtti::type_index_sequential_t::id<component, C>(),
+										  &component_allocator<C>::get_stats),
+		 true);
+	(void)registered;
+
+	return std::allocate_shared<C>(component_allocator<C>(), std::forward<Args>(args)...);
+}
+
+//-----------------------------------------------------------------------------
+//  Name : archetype (Class)
+/// <summary>
+/// The entities having the same set of chunk components. Their values are
+/// kept in 16KB chunks, each holding one contiguous column per component
+/// type followed by the entity indices. Rows are packed, the last row is
+/// moved into the hole a removed one leaves, so all chunks but the last one
+/// are full. Regular components are not part of the set, assigning or
+/// removing them does not move anything.
+/// </summary>
+//-----------------------------------------------------------------------------
+class archetype
+{
+public:
+	typedef std::bitset<MAX_COMPONENTS> component_mask_t;
+	static const std::size_t chunk_bytes = 16 * 1024;
+	static const std::uint32_t npos = std::uint32_t(-1);
+
+	archetype(const component_mask_t& mask,
+			  const std::array<const details::chunk_type*, MAX_COMPONENTS>& types);
+
+	inline const component_mask_t& mask() const
+	{
+		return mask_;
+	}
+	/// Number of rows.
+	inline std::size_t size() const
+	{
+		return size_;
+	}
+	inline std::size_t rows_per_chunk() const
+	{
+		return rows_per_chunk_;
+	}
+	/// Number of chunks holding rows.
+	inline std::size_t chunk_count() const
+	{
+		return (size_ + rows_per_chunk_ - 1) / rows_per_chunk_;
+	}
+	/// Number of rows in a chunk.
+	inline std::size_t chunk_size(std::size_t chunk) const
+	{
+		return std::min(rows_per_chunk_, size_ - chunk * rows_per_chunk_);
+	}
+	/// First value of a family in a chunk.
+	inline void* column(std::size_t chunk, std::size_t family) const
+	{
+		return chunks_[chunk]->bytes + offsets_[family];
+	}
+	/// Entity indices of the rows of a chunk.
+	inline std::uint32_t* indices(std::size_t chunk) const
+	{
+		return reinterpret_cast<std::uint32_t*>(chunks_[chunk]->bytes + indices_offset_);
+	}
+	inline void* get(std::uint32_t row, std::size_t family) const
+	{
+		return static_cast<unsigned char*>(column(row / rows_per_chunk_, family)) +
+			   (row % rows_per_chunk_) * types_[family]->size;
+	}
+	inline std::uint32_t index(std::uint32_t row) const
+	{
+		return indices(row / rows_per_chunk_)[row % rows_per_chunk_];
+	}
+
+	/// Adds a row for the entity index, its values are not constructed.
+	std::uint32_t push(std::uint32_t index);
+	/// Destroys the values of a row.
+	void destroy(std::uint32_t row);
+	/// Moves the last row into a row whose values were destroyed or moved
+	/// out. Returns the entity index moved, npos when the row was the last.
+	std::uint32_t remove(std::uint32_t row);
+
+private:
+	struct chunk
+	{
+		alignas(std::max_align_t) unsigned char bytes[chunk_bytes];
+	};
+
+	component_mask_t mask_;
+	std::vector<std::size_t> families_;
+	std::array<const details::chunk_type*, MAX_COMPONENTS> types_{};
+	/// column of each family in a chunk
+	std::array<std::size_t, MAX_COMPONENTS> offsets_{};
+	std::size_t indices_offset_ = 0;
+	std::size_t rows_per_chunk_ = 0;
+	std::size_t size_ = 0;
+	std::vector<std::unique_ptr<chunk>> chunks_;
+};
+
+//-----------------------------------------------------------------------------
+//  Name : chunk_view (Class)
+/// <summary>
+/// One chunk of an archetype, handed out by
+/// entity_component_system::for_each_chunk.
+/// </summary>
+//-----------------------------------------------------------------------------
+class chunk_view
+{
+public:
+	chunk_view(entity_component_system* manager, const archetype& type, std::size_t chunk)
+		: manager_(manager)
+		, type_(&type)
+		, chunk_(chunk)
+	{
+	}
+
+	/// Number of entities in the chunk.
+	inline std::size_t size() const
+	{
+		return type_->chunk_size(chunk_);
+	}
+	/// Values of a chunk component type the archetype has, size() of them.
+	template <typename C>
+	C* get() const
+	{
+		static_assert(is_chunk_component<C>::value, "Invalid chunk component type.");
+		expects(type_->mask().test(component_family<C>()));
+		return static_cast<C*>(type_->column(chunk_, component_family<C>()));
+	}
+	/// Entity indices of the rows, size() of them.
+	inline const std::uint32_t* indices() const
+	{
+		return type_->indices(chunk_);
+	}
+	entity get_entity(std::size_t row) const;
+
+private:
+	entity_component_system* manager_;
+	const archetype* type_;
+	std::size_t chunk_;
+};
+
+struct component_pool_stats
+{
+	/// component family, see component::runtime_id
+	std::size_t family = 0;
+	core::memory_pool_stats pool;
+};
+
+struct component_memory_stats
+{
+	/// component family, see component::runtime_id
+	std::size_t family = 0;
+	/// rttr name of the type
+	std::string type_name;
+	/// components attached to entities
+	std::size_t live = 0;
+	/// slots of the storage, one per entity index
+	std::size_t capacity = 0;
+	/// live components and the slots pointing to them
+	std::size_t bytes_used = 0;
+	/// empty slots, free pool blocks and the padding of used blocks
+	std::size_t bytes_wasted = 0;
+	/// components taken from the pool during the last frame
+	std::size_t allocations_per_frame = 0;
+};
+
 extern event<void(entity)> on_entity_created;
 extern event<void(entity)> on_entity_destroyed;
+/// fired once by create_many and destroy_many instead of the events above
+extern event<void(const std::vector<entity>&)> on_entities_created;
+extern event<void(const std::vector<entity>&)> on_entities_destroyed;
 extern event<void(entity, chandle<component>)> on_component_added;
 extern event<void(entity, chandle<component>)> on_component_removed;
 
+//-----------------------------------------------------------------------------
+//  Name : entity_query (Class)
+/// <summary>
+/// Persistent set of the valid entities that have all the components of a
+/// mask, an empty mask matches every valid entity. Queries are created by the
+/// entity_component_system on first use and kept up to date in create,
+/// assign, remove and destroy, so iterating one costs the number of matches
+/// instead of the entity capacity. The indices are packed in slots. An
+/// entity leaving the query while it is locked by an iterator leaves an
+/// empty slot behind, the slots are compacted when the last lock goes away.
+/// </summary>
+//-----------------------------------------------------------------------------
+class entity_query
+{
+public:
+	typedef std::bitset<MAX_COMPONENTS> component_mask_t;
+	static const std::uint32_t npos = std::uint32_t(-1);
+
+	explicit entity_query(const component_mask_t& mask);
+
+	inline const component_mask_t& mask() const
+	{
+		return mask_;
+	}
+	inline bool matches(const component_mask_t& entity_mask) const
+	{
+		return (entity_mask & mask_) == mask_;
+	}
+	/// Number of entities in the query.
+	inline std::size_t size() const
+	{
+		return dense_.size() - holes_;
+	}
+	inline bool contains(std::uint32_t index) const
+	{
+		return index < sparse_.size() && sparse_[index] != npos;
+	}
+	/// Number of slots, including the empty ones.
+	inline std::size_t slots() const
+	{
+		return dense_.size();
+	}
+	/// Entity index in a slot, npos for an empty slot.
+	inline std::uint32_t at(std::size_t slot) const
+	{
+		return dense_[slot];
+	}
+
+	/// Keeps the slots in place, used by iterators. Systems running side by
+	/// side may lock the same query.
+	inline void lock()
+	{
+		locks_.fetch_add(1, std::memory_order_relaxed);
+	}
+	void unlock();
+
+private:
+	friend class entity_component_system;
+
+	void insert(std::uint32_t index);
+	void erase(std::uint32_t index);
+	void clear();
+	void compact();
+
+	component_mask_t mask_;
+	/// entity indices, npos for an empty slot
+	std::vector<std::uint32_t> dense_;
+	/// slot of each entity index, npos if not in the query
+	std::vector<std::uint32_t> sparse_;
+	std::size_t holes_ = 0;
+	std::atomic<std::size_t> locks_{0};
+};
+
+//-----------------------------------------------------------------------------
+//  Name : changed_filter (Class)
+/// <summary>
+/// Filter for entity_component_system::each keeping the entities where any
+/// of the components changed at or after a world tick. Create it with
+/// changed<Components...>(tick).
+/// </summary>
+//-----------------------------------------------------------------------------
+template <typename... Components>
+struct changed_filter
+{
+	std::uint32_t since = 0;
+};
+
+//-----------------------------------------------------------------------------
+//  Name : changed ()
+/// <summary>
+/// A system that remembers entity_component_system::get_tick() when it runs
+/// passes it here on its next run to visit only what changed in between:
+///
+///     ecs.each<transform_component, model_component>(
+///         changed<transform_component, model_component>(_last_tick), fn);
+///     _last_tick = ecs.get_tick();
+///
+/// Changes made during the tick the system last ran are visited again.
+/// </summary>
+//-----------------------------------------------------------------------------
+template <typename... Components>
+changed_filter<Components...> changed(std::uint32_t since)
+{
+	changed_filter<Components...> filter;
+	filter.since = since;
+	return filter;
+}
+
 /**
  * Manages entity::Id creation and component assignment.
  */
@@ -395,13 +878,46 @@ public:
 	explicit entity_component_system();
 	virtual ~entity_component_system();
 
-	/// An iterator over a view of the entities in an entity_component_system.
-	/// If All is true it will iterate over all valid entities and will ignore the
-	/// entity mask.
-	template <class Delegate, bool All = false>
+	//-----------------------------------------------------------------------------
+	//  Name : initialize ()
+	/// <summary>
+	///
+	///
+	///
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	bool initialize() override;
+
+	/// An iterator over the entities of an entity_query. While it exists the
+	/// query keeps its slots in place, entities leaving the query meanwhile
+	/// are skipped and entities joining it are not visited.
+	template <class Delegate>
 	class view_iterator : public std::iterator<std::input_iterator_tag, entity::id_t>
 	{
 	public:
+		view_iterator(const view_iterator& other)
+			: manager_(other.manager_)
+			, query_(other.query_)
+			, i_(other.i_)
+			, slots_(other.slots_)
+		{
+			query_->lock();
+		}
+		view_iterator& operator=(const view_iterator& other)
+		{
+			other.query_->lock();
+			query_->unlock();
+			manager_ = other.manager_;
+			query_ = other.query_;
+			i_ = other.i_;
+			slots_ = other.slots_;
+			return *this;
+		}
+		~view_iterator()
+		{
+			query_->unlock();
+		}
+
 		Delegate& operator++()
 		{
 			++i_;
@@ -418,88 +934,53 @@ public:
 		}
 		entity operator*()
 		{
-			return entity(manager_, manager_->create_id(i_));
+			return entity(manager_, manager_->create_id(query_->at(i_)));
 		}
 		const entity operator*() const
 		{
-			return entity(manager_, manager_->create_id(i_));
+			return entity(manager_, manager_->create_id(query_->at(i_)));
 		}
 
 	protected:
-		view_iterator(entity_component_system* manager, std::uint32_t index)
-			: manager_(manager)
-			, i_(index)
-			, capacity_(manager_->capacity())
-			, free_cursor_(~0UL)
-		{
-			if(All)
-			{
-				std::sort(manager_->free_list_.begin(), manager_->free_list_.end());
-				free_cursor_ = 0;
-			}
-		}
-		view_iterator(entity_component_system* manager, const component_mask_t mask, std::uint32_t index)
+		view_iterator(entity_component_system* manager, entity_query* query, std::size_t slot)
 			: manager_(manager)
-			, mask_(mask)
-			, i_(index)
-			, capacity_(manager_->capacity())
-			, free_cursor_(~0UL)
+			, query_(query)
+			, i_(slot)
+			, slots_(query->slots())
 		{
-			if(All)
-			{
-				std::sort(manager_->free_list_.begin(), manager_->free_list_.end());
-				free_cursor_ = 0;
-			}
+			query_->lock();
 		}
 
 		void next()
 		{
-			while(i_ < capacity_ && !predicate())
+			while(i_ < slots_ && query_->at(i_) == entity_query::npos)
 			{
 				++i_;
 			}
 
-			if(i_ < capacity_)
+			if(i_ < slots_)
 			{
-				entity entity = manager_->get(manager_->create_id(i_));
+				entity entity = manager_->get(manager_->create_id(query_->at(i_)));
 				static_cast<Delegate*>(this)->next_entity(entity);
 			}
 		}
 
-		inline bool predicate()
-		{
-			return (All && valid_entity()) || (manager_->entity_component_mask_[i_] & mask_) == mask_;
-		}
-
-		inline bool valid_entity()
-		{
-			const std::vector<std::uint32_t>& free_list = manager_->free_list_;
-			if(free_cursor_ < free_list.size() && free_list[free_cursor_] == i_)
-			{
-				++free_cursor_;
-				return false;
-			}
-			return true;
-		}
-
 		entity_component_system* manager_;
-		component_mask_t mask_;
-		std::uint32_t i_;
-		size_t capacity_;
-		size_t free_cursor_;
+		entity_query* query_;
+		std::size_t i_;
+		std::size_t slots_;
 	};
 
-	template <bool All>
 	class base_view
 	{
 	public:
-		class iterator_type : public view_iterator<iterator_type, All>
+		class iterator_type : public view_iterator<iterator_type>
 		{
 		public:
-			iterator_type(entity_component_system* manager, const component_mask_t mask, std::uint32_t index)
-				: view_iterator<iterator_type, All>(manager, mask, index)
+			iterator_type(entity_component_system* manager, entity_query* query, std::size_t slot)
+				: view_iterator<iterator_type>(manager, query, slot)
 			{
-				view_iterator<iterator_type, All>::next();
+				view_iterator<iterator_type>::next();
 			}
 
 			void next_entity(entity&)
@@ -509,41 +990,41 @@ public:
 
 		iterator_type begin()
 		{
-			return iterator_type(manager_, mask_, 0);
+			return iterator_type(manager_, query_, 0);
 		}
 		iterator_type end()
 		{
-			return iterator_type(manager_, mask_, std::uint32_t(manager_->capacity()));
+			return iterator_type(manager_, query_, query_->slots());
 		}
 		const iterator_type begin() const
 		{
-			return iterator_type(manager_, mask_, 0);
+			return iterator_type(manager_, query_, 0);
 		}
 		const iterator_type end() const
 		{
-			return iterator_type(manager_, mask_, manager_->capacity());
+			return iterator_type(manager_, query_, query_->slots());
+		}
+
+		std::size_t size() const
+		{
+			return query_->size();
 		}
 
 	private:
 		friend class entity_component_system;
 
-		explicit base_view(entity_component_system* manager)
+		base_view(entity_component_system* manager, entity_query& query)
 			: manager_(manager)
-		{
-			mask_.set();
-		}
-		base_view(entity_component_system* manager, component_mask_t mask)
-			: manager_(manager)
-			, mask_(mask)
+			, query_(&query)
 		{
 		}
 
 		entity_component_system* manager_;
-		component_mask_t mask_;
+		entity_query* query_;
 	};
 
-	template <bool All, typename... Components>
-	class typed_view : public base_view<All>
+	template <typename... Components>
+	class typed_view : public base_view
 	{
 	public:
 		template <typename T>
@@ -561,18 +1042,14 @@ public:
 	private:
 		friend class entity_component_system;
 
-		explicit typed_view(entity_component_system* manager)
-			: base_view<All>(manager)
-		{
-		}
-		typed_view(entity_component_system* manager, component_mask_t mask)
-			: base_view<All>(manager, mask)
+		typed_view(entity_component_system* manager, entity_query& query)
+			: base_view(manager, query)
 		{
 		}
 	};
 
 	template <typename... Components>
-	using View = typed_view<false, Components...>;
+	using View = typed_view<Components...>;
 
 	template <typename... Components>
 	class unpacking_view
@@ -610,9 +1087,9 @@ public:
 		class iterator_type : public view_iterator<iterator_type>
 		{
 		public:
-			iterator_type(entity_component_system* manager, const component_mask_t mask, std::uint32_t index,
+			iterator_type(entity_component_system* manager, entity_query* query, std::size_t slot,
 						  const unpacker& unpacker)
-				: view_iterator<iterator_type>(manager, mask, index)
+				: view_iterator<iterator_type>(manager, query, slot)
 				, unpacker_(unpacker)
 			{
 				view_iterator<iterator_type>::next();
@@ -629,36 +1106,33 @@ public:
 
 		iterator_type begin()
 		{
-			return iterator_type(manager_, mask_, 0, unpacker_);
+			return iterator_type(manager_, query_, 0, unpacker_);
 		}
 		iterator_type end()
 		{
-			return iterator_type(manager_, mask_, static_cast<std::uint32_t>(manager_->capacity()),
-								 unpacker_);
+			return iterator_type(manager_, query_, query_->slots(), unpacker_);
 		}
 		const iterator_type begin() const
 		{
-			return iterator_type(manager_, mask_, 0, unpacker_);
+			return iterator_type(manager_, query_, 0, unpacker_);
 		}
 		const iterator_type end() const
 		{
-			return iterator_type(manager_, mask_, static_cast<std::uint32_t>(manager_->capacity()),
-								 unpacker_);
+			return iterator_type(manager_, query_, query_->slots(), unpacker_);
 		}
 
 	private:
 		friend class entity_component_system;
 
-		unpacking_view(entity_component_system* manager, component_mask_t mask,
-					   chandle<Components>&... handles)
+		unpacking_view(entity_component_system* manager, entity_query& query, chandle<Components>&... handles)
 			: manager_(manager)
-			, mask_(mask)
+			, query_(&query)
 			, unpacker_(handles...)
 		{
 		}
 
 		entity_component_system* manager_;
-		component_mask_t mask_;
+		entity_query* query_;
 		unpacker unpacker_;
 	};
 
@@ -688,6 +1162,72 @@ public:
 	 */
 	entity create();
 
+	//-----------------------------------------------------------------------------
+	//  Name : create_unannounced ()
+	/// <summary>
+	/// Creates an entity without emitting on_entity_created. The caller emits
+	/// on_entities_created for it later, along with the other entities it
+	/// creates piece by piece.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	entity create_unannounced();
+
+	//-----------------------------------------------------------------------------
+	//  Name : reserve ()
+	/// <summary>
+	/// Makes room for n entities in total, so that creating up to that many
+	/// does not grow the per entity storage again. Component pools created
+	/// later are sized to the entities that exist at that point.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	void reserve(std::size_t n);
+
+	//-----------------------------------------------------------------------------
+	//  Name : create_many ()
+	/// <summary>
+	/// Creates n entities and appends them to out. Free slots are reused
+	/// first, the storage grows at most once for the rest. Emits
+	/// on_entities_created once with the new entities.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	void create_many(std::size_t n, std::vector<entity>& out);
+
+	//-----------------------------------------------------------------------------
+	//  Name : reserve_id ()
+	/// <summary>
+	/// Reserves the id of an entity to be created later, from any thread. Used
+	/// by ecs_command_buffer, the entity becomes valid when the buffer that
+	/// recorded its creation is applied. Freed indices are reused, each
+	/// apply_command_buffers sets aside as many as were reserved since the
+	/// last one and at least 1024. New ones are taken past that.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	entity::id_t reserve_id();
+
+	//-----------------------------------------------------------------------------
+	//  Name : get_command_buffer ()
+	/// <summary>
+	/// Command buffer of the calling thread, safe to call from any thread.
+	/// Systems record their structural changes here while they run, the
+	/// buffers are applied by apply_command_buffers when the stage of the
+	/// system_scheduler ends. A thread keeps the same buffer for as long as
+	/// the instance lives.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	ecs_command_buffer& get_command_buffer();
+
+	//-----------------------------------------------------------------------------
+	//  Name : apply_command_buffers ()
+	/// <summary>
+	/// Applies the command buffers of all threads. The entities recorded in
+	/// any of them are created first. It is a structural change, nothing else
+	/// may use the entity_component_system meanwhile. Commands recorded by
+	/// the handlers are applied the next time. Sets aside the freed indices
+	/// reserve_id reuses until then.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	void apply_command_buffers();
+
 	/**
 	 * Destroy an existing entity::Id and its associated Components.
 	 *
@@ -695,6 +1235,22 @@ public:
 	 */
 	void destroy(entity::id_t id);
 
+	//-----------------------------------------------------------------------------
+	//  Name : destroy_many ()
+	/// <summary>
+	/// Destroys count distinct valid entities and their components. Every
+	/// entity leaves its queries once instead of once per component. Emits
+	/// on_component_removed for each component and then on_entities_destroyed
+	/// once, while the entities are still valid.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	void destroy_many(const entity::id_t* ids, std::size_t count);
+
+	void destroy_many(const std::vector<entity::id_t>& ids)
+	{
+		destroy_many(ids.data(), ids.size());
+	}
+
 	entity get(entity::id_t id);
 
 	/**
@@ -711,13 +1267,13 @@ public:
 	 *
 	 *     Position &position = em.assign<Position>(e, x, y);
 	 *
-	 * @returns Smart pointer to newly created component.
+	 * @returns Smart pointer to newly created component, or a raw pointer into
+	 * its chunk for a chunk_component.
 	 */
 	template <typename C, typename... Args>
-	chandle<C> assign(entity::id_t id, Args&&... args)
+	component_ref<C> assign(entity::id_t id, Args&&... args)
 	{
-		return std::static_pointer_cast<C>(
-			assign(id, std::make_shared<C>(std::forward<Args>(args)...)).lock());
+		return assign_impl<C>(is_chunk_component<C>(), id, std::forward<Args>(args)...);
 	}
 
 	chandle<component> assign(entity::id_t id, std::shared_ptr<component> comp);
@@ -730,7 +1286,7 @@ public:
 	template <typename C>
 	void remove(entity::id_t id)
 	{
-		remove(id, rtti::type_index_sequential_t::id<component, C>());
+		remove(id, component_family<C>());
 	}
 	void remove(entity::id_t id, std::shared_ptr<component> component);
 	void remove(entity::id_t id, const rtti::type_index_sequential_t::index_t family);
@@ -741,7 +1297,7 @@ public:
 	template <typename C>
 	bool has_component(entity::id_t id) const
 	{
-		return has_component(id, rtti::type_index_sequential_t::id<component, C>());
+		return has_component(id, component_family<C>());
 	}
 
 	bool has_component(entity::id_t id, std::shared_ptr<component> component) const;
@@ -751,21 +1307,14 @@ public:
 	 * Retrieve a component assigned to an entity::Id.
 	 *
 	 * @returns Pointer to an instance of C, or nullptr if the entity::Id does not
-	 * have that component.
+	 * have that component. A pointer into the chunk of a chunk_component stays
+	 * valid until a chunk component of any entity of the same archetype is
+	 * assigned or removed, or one of them is destroyed.
 	 */
 	template <typename C>
-	chandle<C> get_component(entity::id_t id)
+	component_ref<C> get_component(entity::id_t id)
 	{
-		assert_valid(id);
-		auto family = rtti::type_index_sequential_t::id<component, C>();
-		// We don't bother checking the component mask, as we return a nullptr
-		// anyway.
-		if(family >= component_pools_.size())
-			return chandle<C>();
-		auto& pool = component_pools_[family];
-		if(!pool || !entity_component_mask_[id.index()][family])
-			return chandle<C>();
-		return chandle<C>(pool->template get<C>(id.index()));
+		return get_component_impl<C>(is_chunk_component<C>(), id);
 	}
 
 	template <typename... Components>
@@ -792,8 +1341,7 @@ public:
 	template <typename... Components>
 	View<Components...> entities_with_components()
 	{
-		auto mask = component_mask<Components...>();
-		return View<Components...>(this, mask);
+		return View<Components...>(this, query<Components...>());
 	}
 
 	template <typename T>
@@ -805,7 +1353,177 @@ public:
 	template <typename... Components>
 	void for_each(typename identity<std::function<void(entity entity, Components&...)>>::type f)
 	{
-		return entities_with_components<Components...>().for_each(f);
+		each<Components...>(f);
+	}
+
+	//-----------------------------------------------------------------------------
+	//  Name : each ()
+	/// <summary>
+	/// Calls fn(entity, Components&...) for every entity having all of the
+	/// components. Same as for_each, but the callable is not wrapped in a
+	/// std::function and the components are handed out as plain references
+	/// taken straight from the pools, so no handle is created or locked.
+	/// The same changes as during a view iteration are allowed: entities
+	/// leaving the query meanwhile are skipped, entities joining it are not
+	/// visited.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	template <typename... Components, typename F>
+	void each(F&& fn)
+	{
+		each_impl<Components...>(fn, std::index_sequence_for<Components...>());
+	}
+
+	//-----------------------------------------------------------------------------
+	//  Name : each ()
+	/// <summary>
+	/// Same as each(fn) but only visits the entities passing the changed
+	/// filter. When none of the filtered pools changed since the tick nothing
+	/// is iterated at all.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	template <typename... Components, typename... Changed, typename F>
+	void each(const changed_filter<Changed...>& filter, F&& fn)
+	{
+		const std::array<std::size_t, sizeof...(Changed)> families = {
+			{rtti::type_index_sequential_t::id<component, Changed>()...}};
+
+		bool any_changed = false;
+		for(auto family : families)
+		{
+			if(family < component_pools_.size() && component_pools_[family] &&
+			   component_pools_[family]->get_changed_tick() >= filter.since)
+				any_changed = true;
+		}
+		if(!any_changed)
+			return;
+
+		auto filtered = [this, &families, &filter, &fn](entity e, Components&... components) {
+			const auto index = e.id().index();
+			const auto& mask = entity_component_mask_[index];
+			for(auto family : families)
+			{
+				if(mask.test(family) && component_pools_[family]->get_raw(index)->_last_touched >= filter.since)
+				{
+					fn(e, components...);
+					return;
+				}
+			}
+		};
+		each_impl<Components...>(filtered, std::index_sequence_for<Components...>());
+	}
+
+	//-----------------------------------------------------------------------------
+	//  Name : get_tick ()
+	/// <summary>
+	/// Current world tick. It is advanced at the end of every frame.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	std::uint32_t get_tick() const
+	{
+		return details::world_tick.load(std::memory_order_relaxed);
+	}
+
+	//-----------------------------------------------------------------------------
+	//  Name : get_changed_tick ()
+	/// <summary>
+	/// World tick of the last change to any component of the type, including
+	/// adding and removing one. 0 while no component of the type was added.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	template <typename C>
+	std::uint32_t get_changed_tick() const
+	{
+		const auto family = rtti::type_index_sequential_t::id<component, C>();
+		if(family >= component_pools_.size() || !component_pools_[family])
+			return 0;
+		return component_pools_[family]->get_changed_tick();
+	}
+
+	//-----------------------------------------------------------------------------
+	//  Name : par_for_each ()
+	/// <summary>
+	/// Calls fn(entity, Components&...) for every entity having all of the
+	/// components, split into ranges of grain entities that run on the
+	/// task_system workers and on the calling thread. Returns when all calls
+	/// finished and rethrows the first exception thrown by fn. A grain of 0
+	/// picks one from the number of entities and workers.
+	///
+	/// fn runs concurrently with itself, so:
+	/// - it may read and write the components it is handed, each entity is
+	///   visited by exactly one call.
+	/// - it may read components of other entities only when nothing writes
+	///   those component types meanwhile, which the system_access of the
+	///   calling system must declare.
+	/// - it must not create or destroy entities, assign or remove components
+	///   or fire events whose handlers do.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	template <typename... Components, typename F>
+	void par_for_each(F&& fn, std::size_t grain = 0)
+	{
+		par_for_each_impl<Components...>(fn, grain, std::index_sequence_for<Components...>());
+	}
+
+	//-----------------------------------------------------------------------------
+	//  Name : for_each_chunk ()
+	/// <summary>
+	/// Calls fn(const chunk_view&, Components*...) for every chunk of the
+	/// archetypes having all of the chunk components, with the column of
+	/// each. The columns hold chunk.size() values, in the order of
+	/// chunk.indices(). Entities must not be destroyed and chunk components
+	/// must not be assigned or removed meanwhile, record those in
+	/// get_command_buffer instead.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	template <typename... Components, typename F>
+	void for_each_chunk(F&& fn)
+	{
+		static_assert(sizeof...(Components) > 0, "Name the chunk components to iterate.");
+
+		const auto mask = component_mask<Components...>();
+		for(const auto& type : archetypes_)
+		{
+			if((type->mask() & mask) != mask)
+				continue;
+
+			for(std::size_t chunk = 0; chunk < type->chunk_count(); ++chunk)
+			{
+				const chunk_view view(this, *type, chunk);
+				fn(view, view.template get<Components>()...);
+			}
+		}
+	}
+
+	//-----------------------------------------------------------------------------
+	//  Name : par_for_each_chunk ()
+	/// <summary>
+	/// Same as for_each_chunk, with the chunks spread over the task_system
+	/// workers and the calling thread. fn may write the values it is handed
+	/// and nothing else, the rules of par_for_each apply.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	template <typename... Components, typename F>
+	void par_for_each_chunk(F&& fn)
+	{
+		static_assert(sizeof...(Components) > 0, "Name the chunk components to iterate.");
+
+		const auto mask = component_mask<Components...>();
+		std::vector<chunk_view> chunks;
+		for(const auto& type : archetypes_)
+		{
+			if((type->mask() & mask) != mask)
+				continue;
+
+			for(std::size_t chunk = 0; chunk < type->chunk_count(); ++chunk)
+				chunks.emplace_back(this, *type, chunk);
+		}
+
+		core::parallel_for(core::get_subsystem<core::task_system>(), 0, chunks.size(), 1,
+						   [&chunks, &fn](std::size_t i) {
+							   const auto& view = chunks[i];
+							   fn(view, view.template get<Components>()...);
+						   });
 	}
 
 	/**
@@ -824,23 +1542,74 @@ public:
 	template <typename... Components>
 	unpacking_view<Components...> entities_with_components(chandle<Components>&... components)
 	{
-		auto mask = component_mask<Components...>();
-		return unpacking_view<Components...>(this, mask, components...);
+		return unpacking_view<Components...>(this, query<Components...>(), components...);
 	}
 
+	//-----------------------------------------------------------------------------
+	//  Name : get_component_pool_stats ()
+	/// <summary>
+	/// Occupancy of the component pools, one entry per component type created
+	/// through make_component so far. The pools are shared by all instances.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	static std::vector<component_pool_stats> get_component_pool_stats();
+
+	//-----------------------------------------------------------------------------
+	//  Name : get_component_memory_stats ()
+	/// <summary>
+	/// Memory taken by the components of each family that has a storage here.
+	/// Pool figures are shared by all instances, block sizes include the
+	/// shared_ptr control block. Components not created through
+	/// make_component count their rttr size only.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	std::vector<component_memory_stats> get_component_memory_stats() const;
+
+	//-----------------------------------------------------------------------------
+	//  Name : write_component_memory_csv ()
+	/// <summary>
+	/// Writes get_component_memory_stats as csv, with a header line.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	void write_component_memory_csv(std::ostream& out) const;
+
 	/**
-	 * Iterate over all *valid* entities (ie. not in the free list). Not fast
+	 * Iterate over all *valid* entities (ie. not in the free list).
 	 *
 	 * @code
 	 * for (entity entity : entity_manager.all_entities()) {}
 	 *
 	 * @return An iterator view over all valid entities.
 	 */
-	base_view<true> all_entities()
+	base_view all_entities()
 	{
-		return base_view<true>(this);
+		return base_view(this, get_query(component_mask_t()));
 	}
 
+	//-----------------------------------------------------------------------------
+	//  Name : query ()
+	/// <summary>
+	/// The persistent query of the entities having all of the components. It
+	/// is created and filled on first use, after that it is kept up to date
+	/// and the reference stays valid for the lifetime of the
+	/// entity_component_system.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	template <typename... Components>
+	entity_query& query()
+	{
+		return get_query(component_mask<Components...>());
+	}
+
+	//-----------------------------------------------------------------------------
+	//  Name : get_query ()
+	/// <summary>
+	/// The persistent query of a component mask, an empty mask matches all
+	/// valid entities.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	entity_query& get_query(const component_mask_t& mask);
+
 	template <typename C>
 	void unpack(entity::id_t id, chandle<C>& a)
 	{
@@ -872,11 +1641,108 @@ public:
 	 */
 	void dispose();
 
-	void set_entity_name(entity::id_t id, std::string name);
-	const std::string& get_entity_name(entity::id_t id);
+	void set_entity_name(entity::id_t id, const std::string& name);
+	std::string get_entity_name(entity::id_t id) const;
+
+	//-----------------------------------------------------------------------------
+	//  Name : get_entity_name_id ()
+	/// <summary>
+	/// Interned name of the entity, name_table::empty when it has none.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	name_table::name_id get_entity_name_id(entity::id_t id) const;
+
+	//-----------------------------------------------------------------------------
+	//  Name : find_entities_by_name ()
+	/// <summary>
+	/// Entities named exactly name, in index order. Unnamed entities are not
+	/// looked up.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	std::vector<entity> find_entities_by_name(const std::string& name);
+
+	//-----------------------------------------------------------------------------
+	//  Name : search_entities_by_name ()
+	/// <summary>
+	/// Entities whose name contains text, ignoring case, in index order. Each
+	/// distinct name is compared once.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	std::vector<entity> search_entities_by_name(const std::string& text);
+
+	inline const name_table& get_names() const
+	{
+		return *names_;
+	}
+
+	//-----------------------------------------------------------------------------
+	//  Name : get_name_memory_stats ()
+	/// <summary>
+	/// Memory taken by entity names. lookup_bytes includes the name id kept
+	/// per entity. Names of destroyed or renamed entities stay in the table
+	/// until dispose.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	name_table::memory_stats get_name_memory_stats() const;
+
+	//-----------------------------------------------------------------------------
+	//  Name : take_snapshot ()
+	/// <summary>
+	/// Saves the entities, their components and names, see world_snapshot.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	world_snapshot take_snapshot() const;
+
+	//-----------------------------------------------------------------------------
+	//  Name : restore ()
+	/// <summary>
+	/// Puts this entity_component_system back into the state of a snapshot
+	/// it took earlier. Entities created since are destroyed, destroyed ones
+	/// are created again with the same id, and every entity gets the
+	/// components it had back. Creation, destruction and component events
+	/// fire for everything that changes.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	void restore(const world_snapshot& snapshot);
 
 private:
 	friend class entity;
+	friend class ecs_command_buffer;
+
+	//-----------------------------------------------------------------------------
+	//  Name : create_reserved ()
+	/// <summary>
+	/// Creates the entity of an id returned by reserve_id.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	entity create_reserved(entity::id_t id);
+
+	//-----------------------------------------------------------------------------
+	//  Name : release_reserved_ids ()
+	/// <summary>
+	/// Gives back ids returned by reserve_id whose entities are not going to
+	/// be created, from any thread. They are freed by apply_command_buffers.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	void release_reserved_ids(const std::vector<entity::id_t>& ids);
+
+	//-----------------------------------------------------------------------------
+	//  Name : return_reserved_ids ()
+	/// <summary>
+	/// Puts the indices set aside for reserve_id that were not handed out and
+	/// the released ones back on the free list.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	void return_reserved_ids();
+
+	//-----------------------------------------------------------------------------
+	//  Name : recycle_reserved_ids ()
+	/// <summary>
+	/// Sets aside free indices for reserve_id, after returning the ones that
+	/// were not handed out.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	void recycle_reserved_ids();
 
 	inline void assert_valid(entity::id_t id) const
 	{
@@ -900,7 +1766,7 @@ private:
 	component_mask_t component_mask()
 	{
 		component_mask_t mask;
-		mask.set(rtti::type_index_sequential_t::id<component, C>());
+		mask.set(component_family<C>());
 		return mask;
 	}
 
@@ -928,6 +1794,8 @@ private:
 		{
 			entity_component_mask_.resize(index + 1);
 			entity_version_.resize(index + 1);
+			entity_name_ids_.resize(index + 1, name_table::empty);
+			entity_chunk_rows_.resize(index + 1);
 			for(auto& pool : component_pools_)
 			{
 				if(pool)
@@ -953,13 +1821,176 @@ private:
 		{
 
 			component_pools_[family].reset(new component_storage);
-			component_pools_[family]->expand(index_counter_);
+			component_pools_[family]->expand(capacity());
 		}
 
 		return *component_pools_[family].get();
 	}
 
-	std::uint32_t index_counter_ = 0;
+	template <typename C, typename... Args>
+	chandle<C> assign_impl(std::false_type, entity::id_t id, Args&&... args)
+	{
+		return std::static_pointer_cast<C>(
+			assign(id, make_component<C>(std::forward<Args>(args)...)).lock());
+	}
+
+	template <typename C, typename... Args>
+	C* assign_impl(std::true_type, entity::id_t id, Args&&... args)
+	{
+		assert_valid(id);
+		const auto family = component_family<C>();
+		chunk_types_[family] = &details::get_chunk_type<C>();
+		chunk_families_.set(family);
+
+		// Built before anything moves, so that a throwing constructor leaves
+		// the entity as it was.
+		C value(std::forward<Args>(args)...);
+		return new(place_chunk_component(id.index(), family)) C(std::move(value));
+	}
+
+	template <typename C>
+	chandle<C> get_component_impl(std::false_type, entity::id_t id)
+	{
+		assert_valid(id);
+		auto family = rtti::type_index_sequential_t::id<component, C>();
+		// We don't bother checking the component mask, as we return a nullptr
+		// anyway.
+		if(family >= component_pools_.size())
+			return chandle<C>();
+		auto& pool = component_pools_[family];
+		if(!pool || !entity_component_mask_[id.index()][family])
+			return chandle<C>();
+		return chandle<C>(pool->template get<C>(id.index()));
+	}
+
+	template <typename C>
+	C* get_component_impl(std::true_type, entity::id_t id)
+	{
+		assert_valid(id);
+		const auto family = component_family<C>();
+		if(!entity_component_mask_[id.index()][family])
+			return nullptr;
+
+		const auto& location = entity_chunk_rows_[id.index()];
+		return static_cast<C*>(archetypes_[location.type]->get(location.row, family));
+	}
+
+	//-----------------------------------------------------------------------------
+	//  Name : place_chunk_component ()
+	/// <summary>
+	/// Moves the entity to the archetype that has the chunk component too and
+	/// sets its bit. Returns the storage to construct the value at, the old
+	/// value is destroyed when the entity had the component already.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	void* place_chunk_component(std::uint32_t index, std::size_t family);
+
+	//-----------------------------------------------------------------------------
+	//  Name : remove_chunk_component ()
+	/// <summary>
+	/// Destroys the value of a chunk component and moves the entity to the
+	/// archetype without it.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	void remove_chunk_component(std::uint32_t index, std::size_t family);
+
+	//-----------------------------------------------------------------------------
+	//  Name : release_chunk_row ()
+	/// <summary>
+	/// Destroys all chunk components of the entity and frees its row. Its
+	/// component mask is left to the caller.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	void release_chunk_row(std::uint32_t index);
+
+	//-----------------------------------------------------------------------------
+	//  Name : move_chunk_row ()
+	/// <summary>
+	/// Moves the row of the entity to an archetype, or frees it for npos. The
+	/// values both archetypes have are moved along, the others must have
+	/// been destroyed.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	void move_chunk_row(std::uint32_t index, std::uint32_t type);
+
+	//-----------------------------------------------------------------------------
+	//  Name : get_archetype ()
+	/// <summary>
+	/// Index of the archetype of a set of chunk components, created on first
+	/// use.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	std::uint32_t get_archetype(const component_mask_t& mask);
+
+	template <typename... Components, typename F, std::size_t... I>
+	void each_impl(F& fn, std::index_sequence<I...>)
+	{
+		auto& query = this->query<Components...>();
+		// The pools of the components exist once any entity has them.
+		if(query.size() == 0)
+			return;
+
+		const std::array<component_storage*, sizeof...(Components)> pools = {
+			{component_pools_[rtti::type_index_sequential_t::id<component, Components>()].get()...}};
+
+		std::lock_guard<entity_query> lock(query);
+		const auto slots = query.slots();
+		for(std::size_t slot = 0; slot < slots; ++slot)
+		{
+			const auto index = query.at(slot);
+			if(index == entity_query::npos)
+				continue;
+
+			fn(entity(this, create_id(index)), static_cast<Components&>(*pools[I]->get_raw(index))...);
+		}
+	}
+
+	template <typename... Components, typename F, std::size_t... I>
+	void par_for_each_impl(F& fn, std::size_t grain, std::index_sequence<I...>)
+	{
+		auto& query = this->query<Components...>();
+		// The pools of the components exist once any entity has them.
+		if(query.size() == 0)
+			return;
+
+		const std::array<component_storage*, sizeof...(Components)> pools = {
+			{component_pools_[rtti::type_index_sequential_t::id<component, Components>()].get()...}};
+
+		// Keeps the slots in place, nothing may leave the query meanwhile anyway.
+		std::lock_guard<entity_query> lock(query);
+		core::parallel_for(core::get_subsystem<core::task_system>(), 0, query.slots(), grain,
+						   [this, &query, &pools, &fn](std::size_t slot) {
+							   const auto index = query.at(slot);
+							   if(index == entity_query::npos)
+								   return;
+
+							   fn(entity(this, create_id(index)),
+								  static_cast<Components&>(*pools[I]->get_raw(index))...);
+						   });
+	}
+
+	//-----------------------------------------------------------------------------
+	//  Name : frame_end ()
+	/// <summary>
+	/// Advances the world tick.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	void frame_end(std::chrono::duration<float> dt);
+
+	//-----------------------------------------------------------------------------
+	//  Name : update_queries ()
+	/// <summary>
+	/// Adds the entity to or removes it from every query whose membership
+	/// changed with its component mask or with it being alive.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	void update_queries(std::uint32_t index, const component_mask_t& before, bool was_alive,
+						const component_mask_t& after, bool alive);
+
+	// Next never used entity index, reserve_id takes from it concurrently.
+	std::atomic<std::uint32_t> index_counter_{0};
+	// Number of valid entities.
+	std::size_t size_ = 0;
 
 	// Each element in component_pools_ corresponds to a Pool for a component.
 	// The index into the vector is the component::family().
@@ -972,12 +2003,51 @@ private:
 	std::vector<std::uint32_t> entity_version_;
 	// List of available entity slots.
 	std::vector<std::uint32_t> free_list_;
-
-	std::unordered_map<std::uint64_t, std::string> entity_names_;
+	// Free slots set aside for reserve_id, handed out in order from
+	// reusable_next_. Refilled by apply_command_buffers.
+	std::vector<entity::id_t> reusable_ids_;
+	std::atomic<std::size_t> reusable_next_{0};
+	// Reserved ids of entities that are not going to be created.
+	std::mutex released_ids_mutex_;
+	std::vector<entity::id_t> released_ids_;
+	// Archetypes of the chunk components in creation order and by mask, and
+	// the row of each entity index. Entities without chunk components have
+	// no row.
+	struct chunk_row
+	{
+		std::uint32_t type = archetype::npos;
+		std::uint32_t row = archetype::npos;
+	};
+	std::vector<std::unique_ptr<archetype>> archetypes_;
+	std::unordered_map<component_mask_t, std::uint32_t> archetype_lookup_;
+	std::vector<chunk_row> entity_chunk_rows_;
+	// Families assigned as chunk components and how their values are stored.
+	component_mask_t chunk_families_;
+	std::array<const details::chunk_type*, MAX_COMPONENTS> chunk_types_{};
+	// Queries in creation order and by component mask. Views are created
+	// from systems running concurrently, so creating a query is guarded.
+	std::mutex query_mutex_;
+	std::vector<std::unique_ptr<entity_query>> queries_;
+	std::unordered_map<component_mask_t, entity_query*> query_lookup_;
+	// Command buffers handed out per thread.
+	using thread_command_buffer = std::pair<std::thread::id, std::unique_ptr<ecs_command_buffer>>;
+	std::mutex command_buffers_mutex_;
+	std::vector<thread_command_buffer> command_buffers_;
+	// Tells the thread local command buffer caches of different instances apart.
+	const std::uint64_t instance_id_;
+
+	// Pool allocations of each family when the last frame ended, and the
+	// difference to the frame before.
+	std::array<std::size_t, MAX_COMPONENTS> pool_allocations_{};
+	std::array<std::size_t, MAX_COMPONENTS> pool_allocations_per_frame_{};
+	// Interned entity names and the name id of each entity index.
+	// Snapshots share the table.
+	std::shared_ptr<name_table> names_;
+	std::vector<name_table::name_id> entity_name_ids_;
 };
 
 template <typename C, typename... Args>
-chandle<C> entity::assign(Args&&... args)
+component_ref<C> entity::assign(Args&&... args)
 {
 	expects(valid());
 	return manager_->assign<C>(id_, std::forward<Args>(args)...);
@@ -1003,7 +2073,7 @@ inline void entity::remove(std::shared_ptr<component> component)
 }
 
 template <typename C>
-chandle<C> entity::get_component() const
+component_ref<C> entity::get_component() const
 {
 	expects(valid());
 	return manager_->get_component<C>(id_);
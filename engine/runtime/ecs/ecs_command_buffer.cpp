@@ -0,0 +1,112 @@
+#include "ecs_command_buffer.h"
+#include <algorithm>
+#include <iterator>
+
+namespace runtime
+{
+ecs_command_buffer::ecs_command_buffer(entity_component_system& ecs)
+	: _ecs(ecs)
+{
+}
+
+entity ecs_command_buffer::create()
+{
+	command cmd;
+	cmd.type = command_type::create;
+	cmd.id = _ecs.reserve_id();
+	_commands.emplace_back(std::move(cmd));
+
+	return entity(&_ecs, _commands.back().id);
+}
+
+void ecs_command_buffer::destroy(entity e)
+{
+	command cmd;
+	cmd.type = command_type::destroy;
+	cmd.id = e.id();
+	_commands.emplace_back(std::move(cmd));
+}
+
+void ecs_command_buffer::assign(entity e, std::shared_ptr<component> comp)
+{
+	command cmd;
+	cmd.type = command_type::assign;
+	cmd.id = e.id();
+	cmd.comp = std::move(comp);
+	_commands.emplace_back(std::move(cmd));
+}
+
+void ecs_command_buffer::remove(entity e, rtti::type_index_sequential_t::index_t family)
+{
+	command cmd;
+	cmd.type = command_type::remove;
+	cmd.id = e.id();
+	cmd.family = family;
+	_commands.emplace_back(std::move(cmd));
+}
+
+void ecs_command_buffer::apply_creates()
+{
+	// Applying may record into this buffer again through event handlers.
+	auto commands = std::move(_commands);
+	_commands.clear();
+
+	for(const auto& cmd : commands)
+	{
+		if(cmd.type == command_type::create)
+			_ecs.create_reserved(cmd.id);
+	}
+
+	commands.erase(std::remove_if(std::begin(commands), std::end(commands),
+								  [](const command& cmd) { return cmd.type == command_type::create; }),
+				   std::end(commands));
+
+	// Whatever the handlers recorded comes after the commands already there.
+	commands.insert(std::end(commands), std::make_move_iterator(std::begin(_commands)),
+					std::make_move_iterator(std::end(_commands)));
+	_commands = std::move(commands);
+}
+
+void ecs_command_buffer::apply()
+{
+	// Applying may record into this buffer again through event handlers.
+	auto commands = std::move(_commands);
+	_commands.clear();
+
+	for(auto& cmd : commands)
+	{
+		switch(cmd.type)
+		{
+			case command_type::create:
+				_ecs.create_reserved(cmd.id);
+				break;
+			case command_type::destroy:
+				if(_ecs.valid(cmd.id))
+					_ecs.destroy(cmd.id);
+				break;
+			case command_type::assign:
+				if(_ecs.valid(cmd.id))
+					_ecs.assign(cmd.id, std::move(cmd.comp));
+				break;
+			case command_type::remove:
+				if(_ecs.valid(cmd.id) && _ecs.has_component(cmd.id, cmd.family))
+					_ecs.remove(cmd.id, cmd.family);
+				break;
+		}
+	}
+}
+
+void ecs_command_buffer::clear()
+{
+	std::vector<entity::id_t> reserved;
+	for(const auto& cmd : _commands)
+	{
+		if(cmd.type == command_type::create)
+			reserved.emplace_back(cmd.id);
+	}
+	_commands.clear();
+
+	if(!reserved.empty())
+		_ecs.release_reserved_ids(reserved);
+}
+}
@@ -0,0 +1,144 @@
+#pragma once
+
+#include "ecs.h"
+
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace runtime
+{
+//-----------------------------------------------------------------------------
+// Main Class Declarations
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+//  Name : ecs_command_buffer (Class)
+/// <summary>
+/// Records structural changes of the entity_component_system so that they
+/// can be made from any thread and played back later in one go. Entities
+/// created through the buffer get their id reserved right away, so the
+/// returned handle can be used in further commands or stored in components
+/// before the entity exists. Components are constructed when they are
+/// recorded. Commands on entities that are no longer valid when the buffer
+/// is applied are dropped. A buffer is used by one thread at a time.
+/// </summary>
+//-----------------------------------------------------------------------------
+class ecs_command_buffer
+{
+public:
+	explicit ecs_command_buffer(entity_component_system& ecs);
+
+	//-----------------------------------------------------------------------------
+	//  Name : create ()
+	/// <summary>
+	/// Reserves an entity id and records its creation. The entity becomes
+	/// valid when the buffer is applied.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	entity create();
+
+	//-----------------------------------------------------------------------------
+	//  Name : destroy ()
+	/// <summary>
+	///
+	///
+	///
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	void destroy(entity e);
+
+	//-----------------------------------------------------------------------------
+	//  Name : assign ()
+	/// <summary>
+	/// Constructs the component now and records attaching it to the entity.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	template <typename C, typename... Args>
+	chandle<C> assign(entity e, Args&&... args)
+	{
+		auto comp = make_component<C>(std::forward<Args>(args)...);
+		assign(e, comp);
+		return comp;
+	}
+
+	void assign(entity e, std::shared_ptr<component> comp);
+
+	//-----------------------------------------------------------------------------
+	//  Name : remove ()
+	/// <summary>
+	///
+	///
+	///
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	template <typename C>
+	void remove(entity e)
+	{
+		remove(e, component_family<C>());
+	}
+
+	void remove(entity e, rtti::type_index_sequential_t::index_t family);
+
+	//-----------------------------------------------------------------------------
+	//  Name : apply_creates ()
+	/// <summary>
+	/// Creates the recorded entities ahead of the other commands, which stay
+	/// recorded. Lets the buffers of other threads refer to these entities
+	/// when they are applied first.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	void apply_creates();
+
+	//-----------------------------------------------------------------------------
+	//  Name : apply ()
+	/// <summary>
+	/// Plays back the recorded commands in order and clears the buffer. Same
+	/// rules as any other structural change, it must not run next to systems
+	/// using the entity_component_system.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	void apply();
+
+	//-----------------------------------------------------------------------------
+	//  Name : clear ()
+	/// <summary>
+	/// Drops the recorded commands. The ids reserved by the buffer are freed
+	/// by the next apply_command_buffers, their handles stay invalid.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	void clear();
+
+	inline bool empty() const
+	{
+		return _commands.empty();
+	}
+
+	inline std::size_t size() const
+	{
+		return _commands.size();
+	}
+
+private:
+	enum class command_type : std::uint8_t
+	{
+		create,
+		destroy,
+		assign,
+		remove
+	};
+
+	struct command
+	{
+		command_type type;
+		entity::id_t id;
+		std::shared_ptr<component> comp;
+		rtti::type_index_sequential_t::index_t family = 0;
+	};
+
+	/// the recorded ecs
+	entity_component_system& _ecs;
+	/// commands in recording order
+	std::vector<command> _commands;
+};
+}
@@ -0,0 +1,122 @@
+#include "name_table.h"
+#include "core/common/assert.hpp"
+
+#include <cstring>
+
+namespace runtime
+{
+namespace
+{
+constexpr std::size_t block_size = 64 * 1024;
+}
+
+const name_table::name_id name_table::empty;
+const name_table::name_id name_table::npos;
+
+std::size_t name_table::key_hash::operator()(const key& k) const
+{
+	// fnv-1a
+	std::uint64_t hash = 14695981039346656037ull;
+	for(std::size_t i = 0; i < k.size; ++i)
+	{
+		hash ^= static_cast<unsigned char>(k.data[i]);
+		hash *= 1099511628211ull;
+	}
+	return static_cast<std::size_t>(hash);
+}
+
+bool name_table::key_equal::operator()(const key& lhs, const key& rhs) const
+{
+	return lhs.size == rhs.size && std::memcmp(lhs.data, rhs.data, lhs.size) == 0;
+}
+
+name_table::name_table()
+{
+	clear();
+}
+
+name_table::name_id name_table::intern(const std::string& name)
+{
+	if(name.empty())
+		return empty;
+
+	auto it = _lookup.find(key{name.data(), name.size()});
+	if(it != _lookup.end())
+		return it->second;
+
+	expects(_names.size() < npos && "too many distinct names");
+	const auto id = static_cast<name_id>(_names.size());
+	const key stored = {store(name), name.size()};
+	_names.emplace_back(stored);
+	_lookup.emplace(stored, id);
+	return id;
+}
+
+name_table::name_id name_table::find(const std::string& name) const
+{
+	if(name.empty())
+		return empty;
+
+	auto it = _lookup.find(key{name.data(), name.size()});
+	return it != _lookup.end() ? it->second : npos;
+}
+
+void name_table::clear()
+{
+	if(_blocks.size() > 1)
+		_blocks.resize(1);
+	if(!_blocks.empty())
+		_blocks.front().size = 0;
+
+	_names.clear();
+	_lookup.clear();
+	_used_bytes = 0;
+
+	_names.emplace_back(key{"", 0});
+}
+
+name_table::memory_stats name_table::get_memory_stats() const
+{
+	memory_stats stats;
+	stats.names = _names.size();
+	stats.used_bytes = _used_bytes;
+	for(const auto& b : _blocks)
+		stats.arena_bytes += b.capacity;
+
+	// one node with a cached hash per entry plus the buckets
+	stats.lookup_bytes = _names.capacity() * sizeof(key) + _lookup.bucket_count() * sizeof(void*) +
+						 _lookup.size() * (sizeof(std::pair<const key, name_id>) + 2 * sizeof(void*));
+	return stats;
+}
+
+const char* name_table::store(const std::string& name)
+{
+	const auto bytes = name.size() + 1;
+	const auto make_block = [](std::size_t capacity) {
+		block b;
+		b.data.reset(new char[capacity]);
+		b.capacity = capacity;
+		return b;
+	};
+
+	block* target = nullptr;
+	if(bytes > block_size)
+	{
+		// Long names get a block of their own, the last block stays the one being filled.
+		_blocks.insert(_blocks.begin(), make_block(bytes));
+		target = &_blocks.front();
+	}
+	else
+	{
+		if(_blocks.empty() || _blocks.back().capacity - _blocks.back().size < bytes)
+			_blocks.emplace_back(make_block(block_size));
+		target = &_blocks.back();
+	}
+
+	auto dest = target->data.get() + target->size;
+	std::memcpy(dest, name.c_str(), bytes);
+	target->size += bytes;
+	_used_bytes += bytes;
+	return dest;
+}
+}
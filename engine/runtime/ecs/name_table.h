@@ -0,0 +1,129 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace runtime
+{
+//-----------------------------------------------------------------------------
+// Main Class Declarations
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+//  Name : name_table (Class)
+/// <summary>
+/// Interned strings. Every distinct name is stored once in an arena of
+/// character blocks and is referred to by a 32 bit id, id 0 being the empty
+/// name. Names stay valid and keep their id until the table is cleared, even
+/// when nothing refers to them anymore.
+/// </summary>
+//-----------------------------------------------------------------------------
+class name_table
+{
+public:
+	using name_id = std::uint32_t;
+
+	/// id of the empty name
+	static const name_id empty = 0;
+	/// returned by find for names that were never interned
+	static const name_id npos = name_id(-1);
+
+	struct memory_stats
+	{
+		/// distinct names, the empty one included
+		std::size_t names = 0;
+		/// characters stored, terminators included
+		std::size_t used_bytes = 0;
+		/// bytes allocated for the arena blocks
+		std::size_t arena_bytes = 0;
+		/// approximate bytes of the id tables
+		std::size_t lookup_bytes = 0;
+	};
+
+	name_table();
+
+	//-----------------------------------------------------------------------------
+	//  Name : intern ()
+	/// <summary>
+	/// Id of the name, which is added first if it is not in the table yet.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	name_id intern(const std::string& name);
+
+	//-----------------------------------------------------------------------------
+	//  Name : find ()
+	/// <summary>
+	/// Id of the name, or npos if it was never interned.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	name_id find(const std::string& name) const;
+
+	//-----------------------------------------------------------------------------
+	//  Name : get ()
+	/// <summary>
+	/// Null terminated characters of a name, owned by the table.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	inline const char* get(name_id id) const
+	{
+		return _names[id].data;
+	}
+
+	inline std::size_t length(name_id id) const
+	{
+		return _names[id].size;
+	}
+
+	/// number of distinct names, the empty one included
+	inline std::size_t size() const
+	{
+		return _names.size();
+	}
+
+	//-----------------------------------------------------------------------------
+	//  Name : clear ()
+	/// <summary>
+	/// Forgets every name except the empty one. The first arena block is kept.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	void clear();
+
+	memory_stats get_memory_stats() const;
+
+private:
+	struct key
+	{
+		const char* data;
+		std::size_t size;
+	};
+
+	struct key_hash
+	{
+		std::size_t operator()(const key& k) const;
+	};
+
+	struct key_equal
+	{
+		bool operator()(const key& lhs, const key& rhs) const;
+	};
+
+	struct block
+	{
+		std::unique_ptr<char[]> data;
+		std::size_t size = 0;
+		std::size_t capacity = 0;
+	};
+
+	const char* store(const std::string& name);
+
+	/// arena blocks, the last one is filled
+	std::vector<block> _blocks;
+	/// names by id
+	std::vector<key> _names;
+	std::unordered_map<key, name_id, key_hash, key_equal> _lookup;
+	std::size_t _used_bytes = 0;
+};
+}
@@ -0,0 +1,277 @@
+#include "system_scheduler.h"
+#include "../system/events.h"
+#include "core/system/task_system.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+
+namespace runtime
+{
+namespace
+{
+using clock_t = std::chrono::steady_clock;
+/// longest the owner thread sleeps between looking for tasks to help with
+const std::chrono::microseconds owner_poll_interval(100);
+}
+
+struct system_scheduler::frame_state
+{
+	struct node
+	{
+		bool claim()
+		{
+			return !claimed.exchange(true, std::memory_order_acq_rel);
+		}
+
+		bool is_ready() const
+		{
+			return pending.load(std::memory_order_acquire) == 0 && !claimed.load(std::memory_order_relaxed);
+		}
+
+		const system_entry* entry = nullptr;
+		std::vector<std::size_t> dependencies;
+		std::vector<std::size_t> successors;
+		std::atomic<std::size_t> pending{0};
+		std::atomic_bool claimed{false};
+		clock_t::time_point start;
+		clock_t::time_point end;
+		std::thread::id thread;
+	};
+
+	frame_state(core::task_system& system, std::size_t count, std::chrono::duration<float> delta)
+		: ts(system)
+		, nodes(count)
+		, dt(delta)
+	{
+	}
+
+	/// Owner thread systems first since nobody else can run them,
+	/// then any system the workers did not pick up yet.
+	std::size_t find_ready() const
+	{
+		std::size_t found = nodes.size();
+		for(std::size_t i = 0; i < nodes.size(); ++i)
+		{
+			if(!nodes[i].is_ready())
+				continue;
+
+			if(nodes[i].entry->access.is_owner_thread)
+				return i;
+
+			if(found == nodes.size())
+				found = i;
+		}
+		return found;
+	}
+
+	core::task_system& ts;
+	std::vector<node> nodes;
+	std::chrono::duration<float> dt;
+
+	std::mutex mutex;
+	std::condition_variable cv;
+	/// guarded by mutex
+	std::size_t completed = 0;
+	/// guarded by mutex
+	std::exception_ptr exception;
+};
+
+bool system_scheduler::initialize()
+{
+	on_frame_update.connect(this, &system_scheduler::frame_update);
+	on_frame_render.connect(this, &system_scheduler::frame_render);
+
+	return true;
+}
+
+void system_scheduler::dispose()
+{
+	on_frame_update.disconnect(this, &system_scheduler::frame_update);
+	on_frame_render.disconnect(this, &system_scheduler::frame_render);
+}
+
+void system_scheduler::frame_update(std::chrono::duration<float> dt)
+{
+	run(system_stage::update, dt);
+}
+
+void system_scheduler::frame_render(std::chrono::duration<float> dt)
+{
+	run(system_stage::render, dt);
+}
+
+void system_scheduler::add_system(system_stage stage, const std::string& name, const system_access& access,
+								  system_t system)
+{
+	auto& systems = _systems[static_cast<std::size_t>(stage)];
+	systems.emplace_back(system_entry{name, access, std::move(system)});
+}
+
+void system_scheduler::remove_system(system_stage stage, const system_t& system)
+{
+	auto& systems = _systems[static_cast<std::size_t>(stage)];
+	systems.erase(std::remove_if(std::begin(systems), std::end(systems),
+								 [&system](const system_entry& entry) { return entry.system == system; }),
+				  std::end(systems));
+}
+
+const system_scheduler::schedule_info& system_scheduler::get_schedule(system_stage stage) const
+{
+	return _schedules[static_cast<std::size_t>(stage)];
+}
+
+void system_scheduler::run(system_stage stage, std::chrono::duration<float> dt)
+{
+	const auto& systems = _systems[static_cast<std::size_t>(stage)];
+	const auto count = systems.size();
+	auto& schedule = _schedules[static_cast<std::size_t>(stage)];
+	if(count == 0)
+	{
+		schedule = {};
+		return;
+	}
+
+	auto& ts = core::get_subsystem<core::task_system>();
+	auto frame = std::make_shared<frame_state>(ts, count, dt);
+
+	// A system depends on every earlier system it conflicts with. Rebuilt
+	// every frame since it only costs a few mask compares per pair.
+	for(std::size_t i = 0; i < count; ++i)
+	{
+		auto& node = frame->nodes[i];
+		node.entry = &systems[i];
+		for(std::size_t j = 0; j < i; ++j)
+		{
+			if(systems[j].access.conflicts_with(systems[i].access))
+			{
+				node.dependencies.emplace_back(j);
+				frame->nodes[j].successors.emplace_back(i);
+			}
+		}
+		node.pending.store(node.dependencies.size(), std::memory_order_relaxed);
+	}
+
+	const auto stage_start = clock_t::now();
+
+	for(std::size_t i = 0; i < count; ++i)
+	{
+		if(frame->nodes[i].dependencies.empty())
+			dispatch(frame, i);
+	}
+
+	{
+		std::unique_lock<std::mutex> lock(frame->mutex);
+		while(frame->completed < count)
+		{
+			const auto idx = frame->find_ready();
+			if(idx < count && frame->nodes[idx].claim())
+			{
+				lock.unlock();
+				execute(frame, idx);
+				lock.lock();
+				continue;
+			}
+
+			// The running systems may split their work into tasks or wait on
+			// owner thread tasks, so help with both rather than sleep until
+			// they are done.
+			lock.unlock();
+			bool ran = ts.run_on_owner_thread();
+			ran = ts.run_pending_task() || ran;
+			lock.lock();
+			if(ran)
+				continue;
+
+			frame->cv.wait_for(lock, owner_poll_interval, [&frame, count]() {
+				return frame->completed == count || frame->find_ready() < count;
+			});
+		}
+	}
+
+	// Sync point, the structural changes the systems recorded are made now.
+	core::get_subsystem<entity_component_system>().apply_command_buffers();
+
+	const auto stage_end = clock_t::now();
+
+	// Fill the schedule and walk back the longest chain of measured durations.
+	schedule.systems.resize(count);
+	schedule.total = stage_end - stage_start;
+
+	std::vector<duration_t> finish(count, duration_t::zero());
+	std::vector<std::size_t> previous(count, count);
+	std::size_t last = 0;
+	for(std::size_t i = 0; i < count; ++i)
+	{
+		const auto& node = frame->nodes[i];
+		auto& info = schedule.systems[i];
+		info.name = node.entry->name;
+		info.dependencies = node.dependencies;
+		info.start = node.start - stage_start;
+		info.end = node.end - stage_start;
+		info.thread = node.thread;
+		info.owner_thread = node.entry->access.is_owner_thread;
+		info.on_critical_path = false;
+
+		for(auto dep : node.dependencies)
+		{
+			if(previous[i] == count || finish[dep] > finish[previous[i]])
+				previous[i] = dep;
+		}
+		finish[i] = (node.end - node.start) + (previous[i] < count ? finish[previous[i]] : duration_t::zero());
+		if(finish[i] > finish[last])
+			last = i;
+	}
+
+	schedule.critical_path = finish[last];
+	for(auto i = last; i < count; i = previous[i])
+		schedule.systems[i].on_critical_path = true;
+
+	if(frame->exception)
+		std::rethrow_exception(frame->exception);
+}
+
+void system_scheduler::execute(const std::shared_ptr<frame_state>& frame, std::size_t idx)
+{
+	auto& node = frame->nodes[idx];
+	node.thread = std::this_thread::get_id();
+	node.start = clock_t::now();
+	try
+	{
+		node.entry->system(frame->dt);
+	}
+	catch(...)
+	{
+		std::lock_guard<std::mutex> lock(frame->mutex);
+		if(!frame->exception)
+			frame->exception = std::current_exception();
+	}
+	node.end = clock_t::now();
+
+	for(auto successor : node.successors)
+	{
+		if(frame->nodes[successor].pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+			dispatch(frame, successor);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(frame->mutex);
+		++frame->completed;
+	}
+	frame->cv.notify_one();
+}
+
+void system_scheduler::dispatch(const std::shared_ptr<frame_state>& frame, std::size_t idx)
+{
+	// Owner thread systems are picked up by the loop in run.
+	if(frame->nodes[idx].entry->access.is_owner_thread || frame->ts.get_threads_count() <= 1)
+		return;
+
+	frame->ts.push_on_worker_thread([frame, idx]() {
+		if(frame->nodes[idx].claim())
+			execute(frame, idx);
+	});
+}
+}
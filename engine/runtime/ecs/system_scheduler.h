@@ -0,0 +1,284 @@
+#pragma once
+
+#include "core/signals/delegate.hpp"
+#include "ecs.h"
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace runtime
+{
+enum class system_stage : std::uint8_t
+{
+	/// runs on runtime::on_frame_update
+	update,
+	/// runs on runtime::on_frame_render
+	render
+};
+constexpr std::size_t system_stages_count = 2;
+
+//-----------------------------------------------------------------------------
+// Main Class Declarations
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+//  Name : system_access (Class)
+/// <summary>
+/// What a system touches while it runs. Two systems conflict when one writes
+/// a component type the other reads or writes, or when either of them is
+/// structural. Structural systems create or destroy entities, add or remove
+/// components or iterate all_entities(), so they never overlap with anything.
+/// </summary>
+//-----------------------------------------------------------------------------
+struct system_access
+{
+	using component_mask_t = entity_component_system::component_mask_t;
+
+	template <typename... Components>
+	system_access& read()
+	{
+		set_mask<Components...>(reads);
+		return *this;
+	}
+
+	template <typename... Components>
+	system_access& write()
+	{
+		set_mask<Components...>(writes);
+		return *this;
+	}
+
+	//-----------------------------------------------------------------------------
+	//  Name : structural ()
+	/// <summary>
+	/// The system changes the layout of the ecs. It runs alone.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	system_access& structural()
+	{
+		is_structural = true;
+		return *this;
+	}
+
+	//-----------------------------------------------------------------------------
+	//  Name : owner_thread ()
+	/// <summary>
+	/// The system must run on the owner thread, for example because it talks
+	/// to the renderer.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	system_access& owner_thread()
+	{
+		is_owner_thread = true;
+		return *this;
+	}
+
+	//-----------------------------------------------------------------------------
+	//  Name : conflicts_with ()
+	/// <summary>
+	/// Returns true if the two systems can not run at the same time.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	bool conflicts_with(const system_access& other) const
+	{
+		if(is_structural || other.is_structural)
+			return true;
+
+		return (writes & (other.reads | other.writes)).any() || (other.writes & reads).any();
+	}
+
+	/// component types read
+	component_mask_t reads;
+	/// component types written
+	component_mask_t writes;
+	/// creates or destroys entities or components
+	bool is_structural = false;
+	/// bound to the owner thread
+	bool is_owner_thread = false;
+
+private:
+	template <typename... Components>
+	static void set_mask(component_mask_t& mask)
+	{
+		using expander = int[];
+		(void)expander{0, (mask.set(rtti::type_index_sequential_t::id<component, Components>()), 0)...};
+	}
+};
+
+//-----------------------------------------------------------------------------
+//  Name : system_scheduler (Class)
+/// <summary>
+/// Runs the systems of a stage each frame. Every system declares its
+/// system_access, the scheduler builds a dependency graph from it where a
+/// system depends on every system registered before it that it conflicts
+/// with, and then runs the graph on the task_system. Systems that do not
+/// conflict run concurrently on the worker threads. The owner thread drives
+/// the graph and picks up any ready system no worker has claimed yet, so a
+/// stage always completes even when the workers are busy. With nothing ready
+/// it runs owner thread tasks and helps with the worker tasks, so systems may
+/// wait on either. When all systems of
+/// the stage finished, the ecs_command_buffer of every thread is applied. The
+/// schedule and the timings of the last run of each stage are kept for
+/// inspection.
+/// Systems must be added and removed from the owner thread outside of a run.
+/// </summary>
+//-----------------------------------------------------------------------------
+class system_scheduler : public core::subsystem
+{
+public:
+	using duration_t = std::chrono::steady_clock::duration;
+	using system_t = delegate<void(std::chrono::duration<float>)>;
+
+	struct system_info
+	{
+		/// name given on registration
+		std::string name;
+		/// indices of the systems this one waited for
+		std::vector<std::size_t> dependencies;
+		/// start time relative to the start of the stage
+		duration_t start = duration_t::zero();
+		/// end time relative to the start of the stage
+		duration_t end = duration_t::zero();
+		/// thread it ran on
+		std::thread::id thread;
+		/// declared as bound to the owner thread
+		bool owner_thread = false;
+		/// part of the longest chain of dependent systems
+		bool on_critical_path = false;
+	};
+
+	struct schedule_info
+	{
+		/// systems in registration order
+		std::vector<system_info> systems;
+		/// wall time of the stage
+		duration_t total = duration_t::zero();
+		/// sum of the durations along the critical path
+		duration_t critical_path = duration_t::zero();
+	};
+
+	//-----------------------------------------------------------------------------
+	//  Name : initialize ()
+	/// <summary>
+	///
+	///
+	///
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	bool initialize() override;
+
+	//-----------------------------------------------------------------------------
+	//  Name : dispose ()
+	/// <summary>
+	///
+	///
+	///
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	void dispose() override;
+
+	//-----------------------------------------------------------------------------
+	//  Name : add_system ()
+	/// <summary>
+	/// Registers a system for a stage. Registration order decides the order of
+	/// conflicting systems.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	void add_system(system_stage stage, const std::string& name, const system_access& access,
+					system_t system);
+
+	template <class C>
+	void add_system(system_stage stage, const std::string& name, const system_access& access, C* object,
+					void (C::*const method)(std::chrono::duration<float>))
+	{
+		add_system(stage, name, access, system_t(object, method));
+	}
+
+	//-----------------------------------------------------------------------------
+	//  Name : remove_system ()
+	/// <summary>
+	/// Unregisters a system previously added with the same delegate.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	void remove_system(system_stage stage, const system_t& system);
+
+	template <class C>
+	void remove_system(system_stage stage, C* object, void (C::*const method)(std::chrono::duration<float>))
+	{
+		remove_system(stage, system_t(object, method));
+	}
+
+	//-----------------------------------------------------------------------------
+	//  Name : run ()
+	/// <summary>
+	/// Runs every system of the stage and returns when all of them finished.
+	/// Owner thread only. The first exception thrown by a system is rethrown
+	/// here after the rest of the stage has completed.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	void run(system_stage stage, std::chrono::duration<float> dt);
+
+	//-----------------------------------------------------------------------------
+	//  Name : get_schedule ()
+	/// <summary>
+	/// Schedule and timings of the last run of the stage. Owner thread only.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	const schedule_info& get_schedule(system_stage stage) const;
+
+private:
+	struct system_entry
+	{
+		std::string name;
+		system_access access;
+		system_t system;
+	};
+
+	struct frame_state;
+
+	//-----------------------------------------------------------------------------
+	//  Name : frame_update ()
+	/// <summary>
+	///
+	///
+	///
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	void frame_update(std::chrono::duration<float> dt);
+
+	//-----------------------------------------------------------------------------
+	//  Name : frame_render ()
+	/// <summary>
+	///
+	///
+	///
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	void frame_render(std::chrono::duration<float> dt);
+
+	//-----------------------------------------------------------------------------
+	//  Name : execute ()
+	/// <summary>
+	/// Runs one system of the frame and releases the systems waiting for it.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	static void execute(const std::shared_ptr<frame_state>& frame, std::size_t idx);
+
+	//-----------------------------------------------------------------------------
+	//  Name : dispatch ()
+	/// <summary>
+	/// Offers a ready system to the worker threads.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	static void dispatch(const std::shared_ptr<frame_state>& frame, std::size_t idx);
+
+	/// registered systems per stage
+	std::array<std::vector<system_entry>, system_stages_count> _systems;
+	/// last schedule per stage
+	std::array<schedule_info, system_stages_count> _schedules;
+};
+}
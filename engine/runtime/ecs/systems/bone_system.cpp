@@ -1,9 +1,9 @@
 #include "bone_system.h"
 
 #include "../../rendering/mesh.h"
-#include "../../system/events.h"
 #include "../components/model_component.h"
 #include "../components/transform_component.h"
+#include "../system_scheduler.h"
 namespace runtime
 {
 
@@ -62,7 +62,7 @@ get_transforms_for_bones(const std::vector<runtime::entity>& bone_entities)
 	return result;
 }
 
-void bone_system::frame_update(std::chrono::duration<float> dt)
+void bone_system::create_armatures(std::chrono::duration<float> dt)
 {
 	auto& ecs = core::get_subsystem<runtime::entity_component_system>();
 	ecs.for_each<model_component>([this, &ecs](runtime::entity e, model_component& model_comp) {
@@ -77,17 +77,36 @@ void bone_system::frame_update(std::chrono::duration<float> dt)
 		const auto& skin_data = mesh->get_skin_bind_data();
 
 		// Has skinning data?
-		if(skin_data.has_bones())
+		if(skin_data.has_bones() && model_comp.get_bone_entities().size() <= 1)
 		{
-			if(model_comp.get_bone_entities().size() <= 1)
-			{
-				const auto& armature = mesh->get_armature();
-				std::vector<runtime::entity> be;
-				process_node(armature, skin_data, e, be, ecs);
-				model_comp.set_bone_entities(be);
-				model_comp.set_static(false);
-			}
+			const auto& armature = mesh->get_armature();
+			std::vector<runtime::entity> be;
+			process_node(armature, skin_data, e, be, ecs);
+			model_comp.set_bone_entities(be);
+			model_comp.set_static(false);
+		}
+	});
+}
+
+void bone_system::frame_update(std::chrono::duration<float> dt)
+{
+	// Every model only writes its own bone transforms and reads the
+	// transforms of its bone entities, so the models are updated in parallel.
+	auto& ecs = core::get_subsystem<runtime::entity_component_system>();
+	ecs.par_for_each<model_component>([](runtime::entity e, model_component& model_comp) {
 
+		const auto& model = model_comp.get_model();
+		auto mesh = model.get_lod(0);
+
+		// If mesh isnt loaded yet skip it.
+		if(!mesh)
+			return;
+
+		const auto& skin_data = mesh->get_skin_bind_data();
+
+		// Has skinning data?
+		if(skin_data.has_bones())
+		{
 			const auto& bone_entities = model_comp.get_bone_entities();
 			auto transforms = get_transforms_for_bones(bone_entities);
 			model_comp.set_bone_transforms(std::move(transforms));
@@ -98,13 +117,22 @@ void bone_system::frame_update(std::chrono::duration<float> dt)
 
 bool bone_system::initialize()
 {
-	runtime::on_frame_update.connect(this, &bone_system::frame_update);
+	// Creating the bone entities changes the ecs layout so it is kept apart
+	// from the per frame update which can run next to other readers.
+	auto& scheduler = core::get_subsystem<system_scheduler>();
+	scheduler.add_system(system_stage::update, "bone_system.armatures", system_access().structural(), this,
+						 &bone_system::create_armatures);
+	scheduler.add_system(system_stage::update, "bone_system",
+						 system_access().read<transform_component>().write<model_component>(), this,
+						 &bone_system::frame_update);
 
 	return true;
 }
 
 void bone_system::dispose()
 {
-	runtime::on_frame_update.disconnect(this, &bone_system::frame_update);
+	auto& scheduler = core::get_subsystem<system_scheduler>();
+	scheduler.remove_system(system_stage::update, this, &bone_system::create_armatures);
+	scheduler.remove_system(system_stage::update, this, &bone_system::frame_update);
 }
 }
@@ -9,6 +9,14 @@ class bone_system : public core::subsystem
 public:
 	bool initialize();
 	void dispose();
+	//-----------------------------------------------------------------------------
+	//  Name : create_armatures ()
+	/// <summary>
+	/// Creates the bone entities of skinned models that do not have them yet.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	void create_armatures(std::chrono::duration<float> dt);
+
 	//-----------------------------------------------------------------------------
 	//  Name : frame_update (virtual )
 	/// <summary>
@@ -0,0 +1,85 @@
+#include "bounds_system.h"
+
+#include "../../rendering/mesh.h"
+#include "../components/model_component.h"
+#include "../components/transform_component.h"
+#include "../system_scheduler.h"
+
+#include <atomic>
+
+namespace runtime
+{
+namespace
+{
+// Bounds computed during a tick are computed again if the transform or the
+// model is touched during that same tick.
+bool has_current_bounds(const transform_component& transform_comp, const model_component& model_comp)
+{
+	const auto bounds_tick = model_comp.get_world_bounds_tick();
+	return model_comp.has_world_bounds() && transform_comp.get_changed_tick() < bounds_tick &&
+		   model_comp.get_changed_tick() < bounds_tick;
+}
+}
+
+void bounds_system::frame_update(std::chrono::duration<float> dt)
+{
+	auto& ecs = core::get_subsystem<runtime::entity_component_system>();
+	if(!_pending && ecs.get_changed_tick<transform_component>() < _last_tick &&
+	   ecs.get_changed_tick<model_component>() < _last_tick)
+		return;
+
+	const auto tick = ecs.get_tick();
+	std::atomic<bool> pending{false};
+	ecs.par_for_each<transform_component, model_component>(
+		[tick, &pending](runtime::entity, transform_component& transform_comp, model_component& model_comp) {
+			if(has_current_bounds(transform_comp, model_comp))
+				return;
+
+			const auto& model = model_comp.get_model();
+			auto mesh = model.get_lod(0);
+
+			// If mesh isnt loaded yet look again next frame.
+			if(!mesh)
+			{
+				model_comp.reset_world_bounds();
+				if(model.is_valid())
+					pending.store(true, std::memory_order_relaxed);
+				return;
+			}
+
+			model_comp.set_world_bounds(math::bbox::mul(mesh->get_bounds(), transform_comp.get_transform()),
+										tick);
+		});
+
+	_pending = pending.load(std::memory_order_relaxed);
+	_last_tick = tick;
+}
+
+math::bbox bounds_system::get_world_bounds(const transform_component& transform_comp,
+										   const model_component& model_comp)
+{
+	if(has_current_bounds(transform_comp, model_comp))
+		return model_comp.get_world_bounds();
+
+	const auto mesh = model_comp.get_model().get_lod(0);
+	return math::bbox::mul(mesh->get_bounds(), transform_comp.get_transform());
+}
+
+bool bounds_system::initialize()
+{
+	// Every model only writes its own bounds, so the models are updated in
+	// parallel after the transforms were resolved.
+	auto& scheduler = core::get_subsystem<system_scheduler>();
+	scheduler.add_system(system_stage::update, "bounds_system",
+						 system_access().read<transform_component>().write<model_component>(), this,
+						 &bounds_system::frame_update);
+
+	return true;
+}
+
+void bounds_system::dispose()
+{
+	auto& scheduler = core::get_subsystem<system_scheduler>();
+	scheduler.remove_system(system_stage::update, this, &bounds_system::frame_update);
+}
+}
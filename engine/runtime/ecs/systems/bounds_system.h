@@ -0,0 +1,44 @@
+#pragma once
+
+#include "../ecs.h"
+#include "core/math/math_includes.h"
+
+class transform_component;
+class model_component;
+
+namespace runtime
+{
+class bounds_system : public core::subsystem
+{
+public:
+	bool initialize();
+	void dispose();
+	//-----------------------------------------------------------------------------
+	//  Name : frame_update (virtual )
+	/// <summary>
+	/// Recomputes the world bounds of the models whose transform or model
+	/// changed since they were computed, and of the models whose first lod
+	/// finished loading.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	void frame_update(std::chrono::duration<float> dt);
+
+	//-----------------------------------------------------------------------------
+	//  Name : get_world_bounds ()
+	/// <summary>
+	/// Cached world bounds of the model, computed on the spot when the model
+	/// has none yet or when the transform or the model changed since they were
+	/// cached, for instance after this frame's update. The model must have its
+	/// first lod loaded.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	static math::bbox get_world_bounds(const transform_component& transform_comp,
+									   const model_component& model_comp);
+
+private:
+	/// world tick of the last update
+	std::uint32_t _last_tick = 0;
+	/// some models were waiting for their mesh at the last update
+	bool _pending = true;
+};
+}
@@ -1,7 +1,7 @@
 #include "camera_system.h"
-#include "../../system/events.h"
 #include "../components/camera_component.h"
 #include "../components/transform_component.h"
+#include "../system_scheduler.h"
 
 namespace runtime
 {
@@ -9,21 +9,33 @@ void camera_system::frame_update(std::chrono::duration<float> dt)
 {
 	auto& ecs = core::get_subsystem<entity_component_system>();
 
-	ecs.for_each<transform_component, camera_component>(
-		[this](entity e, transform_component& transformComponent, camera_component& cameraComponent) {
+	// Cameras are independent of each other so their matrices are updated on
+	// the workers. Render targets are released here on the render thread.
+	ecs.par_for_each<transform_component, camera_component>(
+		[](entity e, transform_component& transformComponent, camera_component& cameraComponent) {
 			cameraComponent.update(transformComponent.get_transform());
 		});
+
+	ecs.each<camera_component>([](entity e, camera_component& cameraComponent) {
+		cameraComponent.get_render_view().release_unused_resources();
+	});
 }
 
 bool camera_system::initialize()
 {
-	on_frame_update.connect(this, &camera_system::frame_update);
+	// Updating the camera releases unused render targets of its view,
+	// so it stays on the render thread.
+	auto& scheduler = core::get_subsystem<system_scheduler>();
+	scheduler.add_system(system_stage::update, "camera_system",
+						 system_access().read<transform_component>().write<camera_component>().owner_thread(),
+						 this, &camera_system::frame_update);
 
 	return true;
 }
 
 void camera_system::dispose()
 {
-	on_frame_update.disconnect(this, &camera_system::frame_update);
+	auto& scheduler = core::get_subsystem<system_scheduler>();
+	scheduler.remove_system(system_stage::update, this, &camera_system::frame_update);
 }
 }
@@ -11,6 +11,8 @@
 #include "../components/model_component.h"
 #include "../components/reflection_probe_component.h"
 #include "../components/transform_component.h"
+#include "../system_scheduler.h"
+#include "bounds_system.h"
 #include "core/graphics/index_buffer.h"
 #include "core/graphics/render_pass.h"
 #include "core/graphics/render_view.h"
@@ -87,17 +89,19 @@ bool should_rebuild_reflections(visibility_set_models_t& visibility_set, const r
 			continue;
 
 		const auto mesh = model.get_lod(0);
+		if(!mesh)
+			continue;
 
 		const auto& world_transform = transform_comp_ref.get_transform();
 
-		const auto& bounds = mesh->get_bounds();
+		const auto bounds = bounds_system::get_world_bounds(transform_comp_ref, model_comp_ref);
 
 		bool result = false;
 
 		for(std::uint32_t i = 0; i < 6; ++i)
 		{
-			const auto& frustum = camera::get_face_camera(i, world_transform).get_frustum();
-			result |= math::frustum::test_obb(frustum, bounds, world_transform);
+			auto face_camera = camera::get_face_camera(i, world_transform);
+			result |= face_camera.get_frustum().test_aabb(bounds);
 		}
 
 		if(result)
@@ -152,71 +156,56 @@ visibility_set_models_t deferred_rendering::gather_visible_models(entity_compone
 																  bool require_reflection_caster /*= false*/)
 {
 	visibility_set_models_t result;
-	chandle<transform_component> transform_comp_handle;
-	chandle<model_component> model_comp_handle;
-	for(auto entity : ecs.entities_with_components(transform_comp_handle, model_comp_handle))
-	{
-		auto model_comp_ptr = model_comp_handle.lock();
-		auto transform_comp_ptr = transform_comp_handle.lock();
-
-		if(static_only && !model_comp_ptr->is_static())
+	_world_bounds.clear();
+	auto gather = [&](entity e, transform_component& transform_comp, model_component& model_comp) {
+		if(static_only && !model_comp.is_static())
 		{
-			continue;
+			return;
 		}
 
-		if(require_reflection_caster && !model_comp_ptr->casts_reflection())
+		if(require_reflection_caster && !model_comp.casts_reflection())
 		{
-			continue;
+			return;
 		}
 
-		auto mesh = model_comp_ptr->get_model().get_lod(0);
+		auto mesh = model_comp.get_model().get_lod(0);
 
 		// If mesh isnt loaded yet skip it.
 		if(!mesh)
-			continue;
+			return;
 
 		if(camera)
-		{
-			const auto& frustum = camera->get_frustum();
+			_world_bounds.push_back(bounds_system::get_world_bounds(transform_comp, model_comp));
 
-			const auto& world_transform = transform_comp_ptr->get_transform();
+		result.push_back(std::make_tuple(e, transform_comp.handle(), model_comp.handle()));
+	};
 
-			const auto& bounds = mesh->get_bounds();
+	// Only dirty mesh components, changed since the previous frame rendered.
+	if(dirty_only)
+		ecs.each<transform_component, model_component>(
+			changed<transform_component, model_component>(_last_render_tick), gather);
+	else
+		ecs.each<transform_component, model_component>(gather);
 
-			// Test the bounding box of the mesh
-			if(math::frustum::test_obb(frustum, bounds, world_transform))
-			{
-				// Only dirty mesh components.
-				if(dirty_only)
-				{
-					if(transform_comp_ptr->is_dirty() || model_comp_ptr->is_dirty())
-					{
-						result.push_back(std::make_tuple(entity, transform_comp_handle, model_comp_handle));
-					}
-				} // End if dirty_only
-				else
-				{
-					result.push_back(std::make_tuple(entity, transform_comp_handle, model_comp_handle));
-				}
+	if(camera && !result.empty())
+	{
+		// Test the world bounding boxes of the meshes all at once and keep
+		// the visible ones in order.
+		camera->get_frustum().test_aabbs(_world_bounds, _visible);
 
-			} // Enf if visble
-		}
-		else
+		std::size_t count = 0;
+		for(std::size_t i = 0; i < result.size(); ++i)
 		{
-			// Only dirty mesh components.
-			if(dirty_only)
-			{
-				if(transform_comp_ptr->is_dirty() || model_comp_ptr->is_dirty())
-				{
-					result.push_back(std::make_tuple(entity, transform_comp_handle, model_comp_handle));
-				}
-			} // End if dirty_only
-			else
-			{
-				result.push_back(std::make_tuple(entity, transform_comp_handle, model_comp_handle));
-			}
+			if((_visible[i / 32] & (1u << (i % 32))) == 0)
+				continue;
+
+			if(count != i)
+				result[count] = std::move(result[i]);
+			++count;
 		}
+		result.erase(result.begin() + count, result.end());
 	}
+
 	return result;
 }
 
@@ -227,12 +216,14 @@ void deferred_rendering::frame_render(std::chrono::duration<float> dt)
 	build_reflections_pass(ecs, dt);
 	build_shadows_pass(ecs, dt);
 	camera_pass(ecs, dt);
+
+	_last_render_tick = ecs.get_tick();
 }
 
 void deferred_rendering::build_reflections_pass(entity_component_system& ecs, std::chrono::duration<float> dt)
 {
 	auto dirty_models = gather_visible_models(ecs, nullptr, true, true, true);
-	ecs.for_each<transform_component, reflection_probe_component>(
+	ecs.each<transform_component, reflection_probe_component>(
 		[this, &ecs, dt, &dirty_models](entity ce, transform_component& transform_comp,
 										reflection_probe_component& reflection_probe_comp) {
 			const auto& world_tranform = transform_comp.get_transform();
@@ -282,7 +273,7 @@ void deferred_rendering::build_reflections_pass(entity_component_system& ecs, st
 void deferred_rendering::build_shadows_pass(entity_component_system& ecs, std::chrono::duration<float> dt)
 {
 	auto dirty_models = gather_visible_models(ecs, nullptr, true, true, true);
-	ecs.for_each<transform_component, light_component>(
+	ecs.each<transform_component, light_component>(
 		[this, &ecs, dt, &dirty_models](entity ce, transform_component& transform_comp,
 										light_component& light_comp) {
 			// const auto& world_tranform = transform_comp.get_transform();
@@ -304,7 +295,7 @@ void deferred_rendering::build_shadows_pass(entity_component_system& ecs, std::c
 
 void deferred_rendering::camera_pass(entity_component_system& ecs, std::chrono::duration<float> dt)
 {
-	ecs.for_each<camera_component>([this, &ecs, dt](entity ce, camera_component& camera_comp) {
+	ecs.each<camera_component>([this, &ecs, dt](entity ce, camera_component& camera_comp) {
 		auto& camera_lods = _lod_data[ce];
 		auto& camera = camera_comp.get_camera();
 		auto& render_view = camera_comp.get_render_view();
@@ -443,7 +434,7 @@ deferred_rendering::lighting_pass(std::shared_ptr<gfx::frame_buffer> input, came
 			.get_texture("RBUFFER", viewport_size.width, viewport_size.height, false, 1, light_buffer_format)
 			.get();
 
-	ecs.for_each<transform_component, light_component>(
+	ecs.each<transform_component, light_component>(
 		[this, bind_indirect_specular, &camera, &pass, &buffer_size, &view, &proj, g_buffer_fbo,
 		 refl_buffer](entity e, transform_component& transform_comp_ref, light_component& light_comp_ref) {
 			const auto& light = light_comp_ref.get_light();
@@ -545,7 +536,7 @@ deferred_rendering::reflection_probe_pass(std::shared_ptr<gfx::frame_buffer> inp
 	pass.clear(BGFX_CLEAR_COLOR, 0, 0.0f, 0);
 	pass.set_view_proj(view, proj);
 
-	ecs.for_each<transform_component, reflection_probe_component>(
+	ecs.each<transform_component, reflection_probe_component>(
 		[this, &camera, &pass, &buffer_size, &view, &proj, g_buffer_fbo](
 			entity e, transform_component& transform_comp_ref, reflection_probe_component& probe_comp_ref) {
 			const auto& probe = probe_comp_ref.get_probe();
@@ -650,7 +641,7 @@ deferred_rendering::atmospherics_pass(std::shared_ptr<gfx::frame_buffer> input,
 	{
 		bool found_sun = false;
 		auto light_direction = math::normalize(math::vec3(0.2f, -0.8f, 1.0f));
-		ecs.for_each<transform_component, light_component>(
+		ecs.each<transform_component, light_component>(
 			[this, &light_direction, &found_sun](entity e, transform_component& transform_comp_ref,
 												 light_component& light_comp_ref) {
 				if(found_sun)
@@ -722,10 +713,30 @@ void deferred_rendering::receive(entity e)
 		pair.second.erase(e);
 	}
 }
+
+void deferred_rendering::receive(const std::vector<entity>& entities)
+{
+	for(const auto& e : entities)
+		_lod_data.erase(e);
+
+	for(auto& pair : _lod_data)
+	{
+		for(const auto& e : entities)
+			pair.second.erase(e);
+	}
+}
 bool deferred_rendering::initialize()
 {
 	on_entity_destroyed.connect(this, &deferred_rendering::receive);
-	on_frame_render.connect(this, &deferred_rendering::frame_render);
+	on_entities_destroyed.connect(this, &deferred_rendering::receive);
+	auto& scheduler = core::get_subsystem<system_scheduler>();
+	scheduler.add_system(system_stage::render, "deferred_rendering",
+						 system_access()
+							 .read<transform_component, model_component, light_component,
+								   reflection_probe_component>()
+							 .write<camera_component>()
+							 .owner_thread(),
+						 this, &deferred_rendering::frame_render);
 
 	auto& ts = core::get_subsystem<core::task_system>();
 	auto& am = core::get_subsystem<runtime::asset_manager>();
@@ -796,6 +807,8 @@ bool deferred_rendering::initialize()
 void deferred_rendering::dispose()
 {
 	on_entity_destroyed.disconnect(this, &deferred_rendering::receive);
-	on_frame_render.disconnect(this, &deferred_rendering::frame_render);
+	on_entities_destroyed.disconnect(this, &deferred_rendering::receive);
+	auto& scheduler = core::get_subsystem<system_scheduler>();
+	scheduler.remove_system(system_stage::render, this, &deferred_rendering::frame_render);
 }
 }
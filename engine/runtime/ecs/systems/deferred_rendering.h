@@ -65,6 +65,14 @@ public:
 	//-----------------------------------------------------------------------------
 	void receive(entity e);
 
+	//-----------------------------------------------------------------------------
+	//  Name : receive ()
+	/// <summary>
+	/// Batched version for entities destroyed together.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	void receive(const std::vector<entity>& entities);
+
 	//-----------------------------------------------------------------------------
 	//  Name : initialize ()
 	/// <summary>
@@ -193,6 +201,12 @@ public:
 
 private:
 	std::unordered_map<entity, std::unordered_map<entity, lod_data>> _lod_data;
+	/// World tick of the last rendered frame.
+	std::uint32_t _last_render_tick = 0;
+	/// World bounds of the models gathered for culling, reused between calls.
+	math::bbox_soa _world_bounds;
+	/// Visibility bits of _world_bounds, reused between calls.
+	std::vector<std::uint32_t> _visible;
 	/// Program that is responsible for rendering.
 	std::unique_ptr<gpu_program> _directional_light_program;
 	/// Program that is responsible for rendering.
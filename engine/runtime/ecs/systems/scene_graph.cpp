@@ -1,32 +1,57 @@
 #include "scene_graph.h"
-#include "../../system/events.h"
 #include "../components/transform_component.h"
+#include "../system_scheduler.h"
+#include "core/system/parallel.h"
+#include <algorithm>
 namespace runtime
 {
-void update_transform(entity e)
+const std::uint32_t scene_graph::npos;
+const std::size_t scene_graph::parallel_level_size;
+const std::size_t scene_graph::parallel_grain;
+
+void scene_graph::frame_update(std::chrono::duration<float> dt)
 {
-	if(e.valid())
+	auto& ecs = core::get_subsystem<runtime::entity_component_system>();
+	const auto hierarchy_version = transform_component::get_hierarchy_version();
+	if(_layout_dirty || _hierarchy_version != hierarchy_version)
 	{
-		auto transform_comp = e.get_component<transform_component>().lock();
-		if(transform_comp)
-		{
-			transform_comp->resolve(true);
+		rebuild(ecs);
+		_layout_dirty = false;
+		_hierarchy_version = hierarchy_version;
+		_resolve_all = true;
+	}
 
-			auto& children = transform_comp->get_children();
-			for(auto& child : children)
-			{
-				update_transform(child);
-			}
-		}
+	// Nodes reported before a rebuild point into the old layout, they are
+	// resolved with everything else anyway.
+	transform_component::collect_changed_nodes(_changed);
+	if(_resolve_all)
+	{
+		resolve_all();
+		_resolve_all = false;
+	}
+	else if(!_changed.empty())
+	{
+		propagate();
 	}
 }
 
-void scene_graph::frame_update(std::chrono::duration<float> dt)
+void scene_graph::rebuild(entity_component_system& ecs)
 {
-	auto& ecs = core::get_subsystem<runtime::entity_component_system>();
 	_roots.clear();
+	_nodes.clear();
+	_transforms.clear();
+	_parents.clear();
+	_child_begin.clear();
+	_levels.clear();
+
+	// The query of all entities keeps no order, roots are listed by entity
+	// index so that they keep their place when others come and go.
 	auto all_entities = ecs.all_entities();
-	for(const auto entity : all_entities)
+	std::vector<entity> entities(all_entities.begin(), all_entities.end());
+	std::sort(std::begin(entities), std::end(entities),
+			  [](const entity& lhs, const entity& rhs) { return lhs.id().index() < rhs.id().index(); });
+
+	for(const auto entity : entities)
 	{
 		auto transform_comp = entity.get_component<transform_component>().lock();
 		if(transform_comp)
@@ -34,7 +59,16 @@ void scene_graph::frame_update(std::chrono::duration<float> dt)
 			auto parent = transform_comp->get_parent();
 			if(parent.valid() == false)
 			{
+				transform_comp->set_graph_node(static_cast<std::uint32_t>(_nodes.size()));
 				_roots.push_back(entity);
+				_nodes.push_back(entity);
+				_transforms.push_back(transform_comp.get());
+				_parents.push_back(npos);
+			}
+			else
+			{
+				// Set again below if the parent leads back to a root.
+				transform_comp->set_graph_node(npos);
 			}
 		}
 		else
@@ -43,15 +77,163 @@ void scene_graph::frame_update(std::chrono::duration<float> dt)
 		}
 	}
 
-	for(auto& entity : _roots)
+	// One level at a time, children only follow the parent they point back to.
+	// The children of a node end up next to each other.
+	std::size_t begin = 0;
+	while(begin < _nodes.size())
 	{
-		update_transform(entity);
+		const auto end = _nodes.size();
+		_levels.push_back(static_cast<std::uint32_t>(begin));
+		for(auto i = begin; i < end; ++i)
+		{
+			const auto parent = _nodes[i];
+			_child_begin.push_back(static_cast<std::uint32_t>(_nodes.size()));
+			for(const auto& child : _transforms[i]->get_children())
+			{
+				if(!child.valid())
+					continue;
+
+				auto child_transform = child.get_component<transform_component>().lock();
+				if(!child_transform || child_transform->get_parent() != parent)
+					continue;
+
+				child_transform->set_graph_node(static_cast<std::uint32_t>(_nodes.size()));
+				_nodes.push_back(child);
+				_transforms.push_back(child_transform.get());
+				_parents.push_back(static_cast<std::uint32_t>(i));
+			}
+		}
+		begin = end;
+	}
+	_levels.push_back(static_cast<std::uint32_t>(_nodes.size()));
+	_child_begin.push_back(static_cast<std::uint32_t>(_nodes.size()));
+	_queued.assign(_nodes.size(), 0);
+}
+
+void scene_graph::resolve_all()
+{
+	const auto resolve_node = [this](std::size_t i) {
+		const auto parent = _parents[i];
+		_transforms[i]->resolve(parent != npos ? &_transforms[parent]->get_transform() : nullptr);
+	};
+
+	// The nodes of a level only read the level above, which is done by then,
+	// so a level can be split across the workers and the result does not
+	// depend on how.
+	auto& ts = core::get_subsystem<core::task_system>();
+	for(std::size_t level = 0; level + 1 < _levels.size(); ++level)
+	{
+		const std::size_t begin = _levels[level];
+		const std::size_t end = _levels[level + 1];
+		if(end - begin < parallel_level_size || ts.get_threads_count() < 2)
+		{
+			for(auto i = begin; i < end; ++i)
+				resolve_node(i);
+		}
+		else
+		{
+			core::parallel_for(ts, begin, end, parallel_grain, resolve_node);
+		}
 	}
 }
 
+void scene_graph::propagate()
+{
+	std::sort(_changed.begin(), _changed.end());
+	_changed.erase(std::unique(_changed.begin(), _changed.end()), _changed.end());
+
+	const auto resolve_node = [this](std::size_t k) {
+		const auto i = _level_nodes[k];
+		const auto parent = _parents[i];
+		_moved[k] = _transforms[i]->resolve(parent != npos ? &_transforms[parent]->get_transform() : nullptr);
+	};
+
+	// Every level resolves its changed nodes and the children of the nodes
+	// that moved on the level above. Nothing below an unchanged node is
+	// visited.
+	auto& ts = core::get_subsystem<core::task_system>();
+	auto changed = _changed.begin();
+	_level_nodes.clear();
+	for(std::size_t level = 0; level + 1 < _levels.size(); ++level)
+	{
+		const auto end = _levels[level + 1];
+		for(; changed != _changed.end() && *changed < end; ++changed)
+		{
+			if(!_queued[*changed])
+			{
+				_queued[*changed] = 1;
+				_level_nodes.push_back(*changed);
+			}
+		}
+
+		if(_level_nodes.empty())
+		{
+			if(changed == _changed.end())
+				break;
+
+			continue;
+		}
+
+		_moved.assign(_level_nodes.size(), 0);
+		if(_level_nodes.size() < parallel_level_size || ts.get_threads_count() < 2)
+		{
+			for(std::size_t k = 0; k < _level_nodes.size(); ++k)
+				resolve_node(k);
+		}
+		else
+		{
+			core::parallel_for(ts, std::size_t(0), _level_nodes.size(), parallel_grain, resolve_node);
+		}
+
+		_next_level_nodes.clear();
+		for(std::size_t k = 0; k < _level_nodes.size(); ++k)
+		{
+			const auto i = _level_nodes[k];
+			_queued[i] = 0;
+			if(!_moved[k])
+				continue;
+
+			for(auto child = _child_begin[i]; child < _child_begin[i + 1]; ++child)
+			{
+				_queued[child] = 1;
+				_next_level_nodes.push_back(child);
+			}
+		}
+		_level_nodes.swap(_next_level_nodes);
+	}
+}
+
+void scene_graph::receive(entity)
+{
+	_layout_dirty = true;
+}
+
+void scene_graph::receive(const std::vector<entity>&)
+{
+	_layout_dirty = true;
+}
+
+void scene_graph::receive(entity, chandle<component> comp)
+{
+	auto ptr = comp.lock();
+	if(ptr && dynamic_cast<transform_component*>(ptr.get()))
+		_layout_dirty = true;
+}
+
 bool scene_graph::initialize()
 {
-	runtime::on_frame_update.connect(this, &scene_graph::frame_update);
+	// Rebuilding walks all entities, which is not safe next to anything else.
+	auto& scheduler = core::get_subsystem<system_scheduler>();
+	scheduler.add_system(system_stage::update, "scene_graph",
+						 system_access().write<transform_component>().structural(), this,
+						 &scene_graph::frame_update);
+
+	on_entity_created.connect(this, &scene_graph::receive);
+	on_entity_destroyed.connect(this, &scene_graph::receive);
+	on_entities_created.connect(this, &scene_graph::receive);
+	on_entities_destroyed.connect(this, &scene_graph::receive);
+	on_component_added.connect(this, &scene_graph::receive);
+	on_component_removed.connect(this, &scene_graph::receive);
 
 	transform_component::static_id();
 
@@ -60,6 +242,14 @@ bool scene_graph::initialize()
 
 void scene_graph::dispose()
 {
-	runtime::on_frame_update.disconnect(this, &scene_graph::frame_update);
+	on_entity_created.disconnect(this, &scene_graph::receive);
+	on_entity_destroyed.disconnect(this, &scene_graph::receive);
+	on_entities_created.disconnect(this, &scene_graph::receive);
+	on_entities_destroyed.disconnect(this, &scene_graph::receive);
+	on_component_added.disconnect(this, &scene_graph::receive);
+	on_component_removed.disconnect(this, &scene_graph::receive);
+
+	auto& scheduler = core::get_subsystem<system_scheduler>();
+	scheduler.remove_system(system_stage::update, this, &scene_graph::frame_update);
 }
 }
@@ -1,21 +1,30 @@
 #pragma once
 
 #include "../ecs.h"
+#include <cstdint>
 #include <vector>
 
+class transform_component;
+
 namespace runtime
 {
 class scene_graph : public core::subsystem
 {
 public:
+	/// parent of a root node
+	static const std::uint32_t npos = std::uint32_t(-1);
+	/// levels with fewer nodes are resolved on the calling thread
+	static const std::size_t parallel_level_size = 1024;
+	/// nodes per job when a level is split across the task_system workers
+	static const std::size_t parallel_grain = 256;
+
 	bool initialize();
 	void dispose();
 	//-----------------------------------------------------------------------------
 	//  Name : frame_update (virtual )
 	/// <summary>
-	///
-	///
-	///
+	/// Rebuilds the hierarchy when it changed, then resolves the world
+	/// transforms of the nodes that moved and of everything below them.
 	/// </summary>
 	//-----------------------------------------------------------------------------
 	void frame_update(std::chrono::duration<float> dt);
@@ -23,9 +32,7 @@ public:
 	//-----------------------------------------------------------------------------
 	//  Name : getRoots ()
 	/// <summary>
-	///
-	///
-	///
+	/// Entities without a parent, in entity index order.
 	/// </summary>
 	//-----------------------------------------------------------------------------
 	const std::vector<entity>& get_roots() const
@@ -33,8 +40,95 @@ public:
 		return _roots;
 	}
 
+	//-----------------------------------------------------------------------------
+	//  Name : get_nodes ()
+	/// <summary>
+	/// Entities having a transform_component that are reachable from a root,
+	/// in breadth first order, so every parent comes before its children.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	const std::vector<entity>& get_nodes() const
+	{
+		return _nodes;
+	}
+
+	//-----------------------------------------------------------------------------
+	//  Name : get_parents ()
+	/// <summary>
+	/// Position of the parent of each node in get_nodes, npos for roots.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	const std::vector<std::uint32_t>& get_parents() const
+	{
+		return _parents;
+	}
+
+	//-----------------------------------------------------------------------------
+	//  Name : get_levels ()
+	/// <summary>
+	/// Position of the first node of each depth in get_nodes, followed by the
+	/// number of nodes.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	const std::vector<std::uint32_t>& get_levels() const
+	{
+		return _levels;
+	}
+
+	void receive(entity e);
+	void receive(const std::vector<entity>& entities);
+	void receive(entity e, chandle<component> comp);
+
 private:
+	//-----------------------------------------------------------------------------
+	//  Name : rebuild ()
+	/// <summary>
+	/// Collects the roots and lays the transform hierarchy out breadth first.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	void rebuild(entity_component_system& ecs);
+
+	//-----------------------------------------------------------------------------
+	//  Name : resolve_all ()
+	/// <summary>
+	/// Resolves every node, one level after the other. Large levels are
+	/// resolved on the task_system.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	void resolve_all();
+
+	//-----------------------------------------------------------------------------
+	//  Name : propagate ()
+	/// <summary>
+	/// Resolves the changed nodes and, as long as they move, their children,
+	/// one level after the other. Large levels are resolved on the task_system.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	void propagate();
+
 	/// scene roots
 	std::vector<entity> _roots;
+	/// transform hierarchy in breadth first order
+	std::vector<entity> _nodes;
+	std::vector<transform_component*> _transforms;
+	std::vector<std::uint32_t> _parents;
+	/// position of the first child of each node, followed by the number of nodes
+	std::vector<std::uint32_t> _child_begin;
+	std::vector<std::uint32_t> _levels;
+	/// nodes touched since the last frame_update
+	std::vector<std::uint32_t> _changed;
+	/// nodes already in _level_nodes, cleared as they are resolved
+	std::vector<std::uint8_t> _queued;
+	/// nodes of the level being resolved and of the next one
+	std::vector<std::uint32_t> _level_nodes;
+	std::vector<std::uint32_t> _next_level_nodes;
+	/// whether the world transform of each of _level_nodes changed
+	std::vector<std::uint8_t> _moved;
+	/// entities or transforms were added or removed since the last rebuild
+	bool _layout_dirty = true;
+	/// transform_component::get_hierarchy_version at the last rebuild
+	std::uint32_t _hierarchy_version = 0;
+	/// everything is resolved after a rebuild
+	bool _resolve_all = true;
 };
 }
@@ -32,7 +32,10 @@ static bool deserialize_t(std::istream& stream, std::vector<runtime::entity>& ou
 	{
 		IArchive ar(stream);
 
-		try_load(ar, cereal::make_nvp("data", out_data));
+		{
+			runtime::entity_load_scope scope(core::get_subsystem<runtime::entity_component_system>());
+			try_load(ar, cereal::make_nvp("data", out_data));
+		}
 
 		stream.clear();
 		stream.seekg(0);
@@ -0,0 +1,258 @@
+#include "world_snapshot.h"
+
+#include "core/logging/logging.h"
+#include <algorithm>
+
+namespace runtime
+{
+namespace
+{
+std::array<const details::snapshot_hooks*, MAX_COMPONENTS>& get_snapshot_hooks_table()
+{
+	static std::array<const details::snapshot_hooks*, MAX_COMPONENTS> hooks{};
+	return hooks;
+}
+
+// Families reported for missing their component_snapshot.
+std::bitset<MAX_COMPONENTS>& get_reported_families()
+{
+	static std::bitset<MAX_COMPONENTS> reported;
+	return reported;
+}
+
+std::vector<bool> get_alive(const std::vector<std::uint32_t>& versions, const std::vector<std::uint32_t>& free_list)
+{
+	// Version 0 is a reserved id that was not created yet.
+	std::vector<bool> alive(versions.size(), false);
+	for(std::size_t index = 0; index < versions.size(); ++index)
+		alive[index] = versions[index] != 0;
+	for(auto index : free_list)
+		alive[index] = false;
+	return alive;
+}
+}
+
+namespace details
+{
+void register_snapshot_hooks(std::size_t family, const snapshot_hooks* hooks)
+{
+	expects(family < MAX_COMPONENTS);
+	get_snapshot_hooks_table()[family] = hooks;
+}
+
+const snapshot_hooks* get_snapshot_hooks(std::size_t family)
+{
+	return family < MAX_COMPONENTS ? get_snapshot_hooks_table()[family] : nullptr;
+}
+}
+
+world_snapshot entity_component_system::take_snapshot() const
+{
+	world_snapshot snapshot;
+	snapshot.instance_id_ = instance_id_;
+	snapshot.index_counter_ = index_counter_.load(std::memory_order_relaxed);
+	snapshot.size_ = size_;
+	snapshot.entity_version_ = entity_version_;
+	snapshot.entity_component_mask_ = entity_component_mask_;
+	snapshot.alive_ = get_alive(entity_version_, free_list_);
+	snapshot.free_list_ = free_list_;
+	snapshot.entity_name_ids_ = entity_name_ids_;
+	snapshot.names_ = names_;
+
+	std::vector<component*> raw;
+	for(std::size_t family = 0; family < component_pools_.size(); ++family)
+	{
+		const auto& pool = component_pools_[family];
+		if(!pool || pool->live == 0)
+			continue;
+
+		world_snapshot::family_data data;
+		data.family = family;
+		data.indices.reserve(pool->live);
+		data.components.reserve(pool->live);
+		for(std::uint32_t index = 0; index < capacity(); ++index)
+		{
+			if(!snapshot.alive_[index] || !entity_component_mask_[index].test(family))
+				continue;
+
+			data.indices.emplace_back(index);
+			data.components.emplace_back(pool->get(index));
+		}
+
+		// Components without hooks are still brought back, with whatever state
+		// they have when restored.
+		auto hooks = details::get_snapshot_hooks(family);
+		if(hooks)
+		{
+			raw.clear();
+			for(const auto& comp : data.components)
+				raw.emplace_back(comp.get());
+			data.states = hooks->save(raw);
+		}
+		else if(!get_reported_families().test(family))
+		{
+			get_reported_families().set(family);
+			APPLOG_WARNING("Component type {} has no registered component_snapshot, its state is not "
+						   "restored with the world snapshot.",
+						   pool->type_name);
+		}
+		snapshot.families_.emplace_back(std::move(data));
+	}
+
+	return snapshot;
+}
+
+void entity_component_system::restore(const world_snapshot& snapshot)
+{
+	expects(snapshot.instance_id_ == instance_id_ && "snapshot of another entity_component_system");
+
+	// Indices set aside for reserve_id are neither alive nor free.
+	return_reserved_ids();
+
+	const auto saved_capacity = static_cast<std::uint32_t>(snapshot.entity_version_.size());
+	const auto saved_alive = [&snapshot, saved_capacity](std::uint32_t index) {
+		return index < saved_capacity && snapshot.alive_[index];
+	};
+	const auto saved_id = [&snapshot](std::uint32_t index) {
+		return entity::id_t(index, snapshot.entity_version_[index]);
+	};
+
+	std::vector<component*> raw;
+	bool restored = false;
+	while(!restored)
+	{
+		// Components let go of are released at the end of the pass. Their
+		// destructors may destroy other entities, which are brought back by
+		// another pass.
+		std::vector<std::shared_ptr<component>> dropped;
+
+		// Entities created since, including the ones reusing a saved index.
+		std::vector<entity::id_t> stale;
+		auto alive = get_alive(entity_version_, free_list_);
+		for(std::uint32_t index = 0; index < capacity(); ++index)
+		{
+			if(!alive[index] || (saved_alive(index) && snapshot.entity_version_[index] == entity_version_[index]))
+				continue;
+
+			stale.emplace_back(create_id(index));
+			auto components = all_components_shared(stale.back());
+			std::move(components.begin(), components.end(), std::back_inserter(dropped));
+		}
+		destroy_many(stale);
+		for(const auto& id : stale)
+			alive[id.index()] = false;
+
+		// Components assigned since to the entities that are left.
+		for(std::uint32_t index = 0; index < capacity(); ++index)
+		{
+			if(!alive[index])
+				continue;
+
+			const auto added = entity_component_mask_[index] & ~snapshot.entity_component_mask_[index];
+			if(added.none())
+				continue;
+
+			for(std::size_t family = 0; family < MAX_COMPONENTS; ++family)
+			{
+				if(!added.test(family))
+					continue;
+
+				// Chunk components are destroyed right away.
+				if(!chunk_families_.test(family))
+					dropped.emplace_back(component_pools_[family]->get(index));
+				remove(create_id(index), family);
+			}
+		}
+
+		// Entities destroyed since come back with their old id.
+		if(saved_capacity > 0)
+			accomodate_entity(saved_capacity - 1);
+		if(index_counter_.load(std::memory_order_relaxed) < snapshot.index_counter_)
+			index_counter_.store(snapshot.index_counter_, std::memory_order_relaxed);
+		alive.resize(capacity(), false);
+
+		std::vector<entity> revived;
+		for(std::uint32_t index = 0; index < saved_capacity; ++index)
+		{
+			if(!snapshot.alive_[index])
+			{
+				// Keeps ids handed out since invalid.
+				entity_version_[index] = std::max(entity_version_[index], snapshot.entity_version_[index]);
+				continue;
+			}
+			if(alive[index])
+				continue;
+
+			entity_version_[index] = snapshot.entity_version_[index];
+			update_queries(index, component_mask_t(), false, component_mask_t(), true);
+			++size_;
+			revived.emplace_back(this, saved_id(index));
+		}
+
+		// Indices freed since go first, so that the saved ones are reused in
+		// the saved order.
+		std::vector<bool> listed(capacity(), false);
+		for(auto index : snapshot.free_list_)
+			listed[index] = true;
+
+		std::vector<std::uint32_t> free_list;
+		free_list.reserve(free_list_.size() + snapshot.free_list_.size());
+		for(auto index : free_list_)
+		{
+			if(saved_alive(index) || listed[index])
+				continue;
+
+			listed[index] = true;
+			free_list.emplace_back(index);
+		}
+		free_list.insert(free_list.end(), snapshot.free_list_.begin(), snapshot.free_list_.end());
+		free_list_ = std::move(free_list);
+
+		if(!revived.empty())
+			on_entities_created(revived);
+
+		for(const auto& data : snapshot.families_)
+		{
+			auto& pool = accomodate_component(data.family);
+			for(std::size_t i = 0; i < data.indices.size(); ++i)
+			{
+				const auto index = data.indices[i];
+				const auto& comp = data.components[i];
+				if(entity_component_mask_[index].test(data.family))
+				{
+					if(pool.get_raw(index) == comp.get())
+						continue;
+
+					dropped.emplace_back(pool.get(index));
+				}
+				assign(saved_id(index), comp);
+			}
+
+			auto hooks = details::get_snapshot_hooks(data.family);
+			if(hooks && data.states)
+			{
+				raw.clear();
+				for(const auto& comp : data.components)
+					raw.emplace_back(comp.get());
+				hooks->restore(*data.states, raw);
+			}
+
+			for(const auto& comp : data.components)
+				comp->touch();
+		}
+
+		names_ = snapshot.names_;
+		for(std::uint32_t index = 0; index < saved_capacity; ++index)
+		{
+			if(snapshot.alive_[index])
+				entity_name_ids_[index] = snapshot.entity_name_ids_[index];
+		}
+
+		dropped.clear();
+
+		restored = true;
+		for(std::uint32_t index = 0; index < saved_capacity && restored; ++index)
+			restored = !snapshot.alive_[index] || valid(saved_id(index));
+	}
+}
+}
@@ -0,0 +1,140 @@
+#pragma once
+
+#include "ecs.h"
+
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace runtime
+{
+namespace details
+{
+/// Saved states of the components of one family.
+struct snapshot_states
+{
+	virtual ~snapshot_states() = default;
+};
+
+/// Type erased component_snapshot of one component type.
+struct snapshot_hooks
+{
+	virtual ~snapshot_hooks() = default;
+	virtual std::unique_ptr<snapshot_states> save(const std::vector<component*>& components) const = 0;
+	virtual void restore(const snapshot_states& states, const std::vector<component*>& components) const = 0;
+};
+
+void register_snapshot_hooks(std::size_t family, const snapshot_hooks* hooks);
+const snapshot_hooks* get_snapshot_hooks(std::size_t family);
+
+template <typename C>
+struct component_snapshot_hooks : snapshot_hooks
+{
+	using traits = component_snapshot<C>;
+	using state_t = typename std::decay<decltype(traits::save(std::declval<const C&>()))>::type;
+
+	struct states : snapshot_states
+	{
+		std::vector<state_t> data;
+	};
+
+	std::unique_ptr<snapshot_states> save(const std::vector<component*>& components) const override
+	{
+		std::unique_ptr<states> result(new states());
+		result->data.reserve(components.size());
+		for(auto comp : components)
+			result->data.emplace_back(traits::save(static_cast<const C&>(*comp)));
+		return std::move(result);
+	}
+
+	void restore(const snapshot_states& saved, const std::vector<component*>& components) const override
+	{
+		const auto& data = static_cast<const states&>(saved).data;
+		expects(data.size() == components.size());
+		for(std::size_t i = 0; i < components.size(); ++i)
+			traits::restore(static_cast<C&>(*components[i]), data[i]);
+	}
+};
+}
+
+//-----------------------------------------------------------------------------
+//  Name : register_component_snapshot ()
+/// <summary>
+/// Makes world snapshots save and restore the state of C through its
+/// component_snapshot specialization. Meant to initialize a static in the
+/// translation unit of the component.
+/// </summary>
+//-----------------------------------------------------------------------------
+template <typename C>
+bool register_component_snapshot()
+{
+	static const details::component_snapshot_hooks<C> hooks;
+	details::register_snapshot_hooks(rtti::type_index_sequential_t::id<component, C>(), &hooks);
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Main Class Declarations
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+//  Name : world_snapshot (Class)
+/// <summary>
+/// State of an entity_component_system at one point in time, taken with
+/// entity_component_system::take_snapshot and put back with restore. It
+/// keeps the component objects alive, so restoring gives the entities their
+/// ids and their components their identity back and existing handles stay
+/// valid. Entities and components created after the snapshot are destroyed
+/// by restore, and components get their saved state back through their
+/// component_snapshot, one save call per component. Components of a type
+/// without one registered keep their current state on restore, which is
+/// logged once per type.
+/// </summary>
+//-----------------------------------------------------------------------------
+class world_snapshot
+{
+public:
+	world_snapshot() = default;
+	world_snapshot(world_snapshot&&) = default;
+	world_snapshot& operator=(world_snapshot&&) = default;
+
+	/// number of entities in the snapshot
+	inline std::size_t size() const
+	{
+		return size_;
+	}
+
+	inline bool empty() const
+	{
+		return size_ == 0;
+	}
+
+private:
+	friend class entity_component_system;
+	typedef std::bitset<MAX_COMPONENTS> component_mask_t;
+
+	struct family_data
+	{
+		std::size_t family = 0;
+		/// entity indices and their components, in index order
+		std::vector<std::uint32_t> indices;
+		std::vector<std::shared_ptr<component>> components;
+		/// saved states of the components
+		std::unique_ptr<details::snapshot_states> states;
+	};
+
+	// instance the snapshot was taken from
+	std::uint64_t instance_id_ = 0;
+	std::uint32_t index_counter_ = 0;
+	std::size_t size_ = 0;
+	std::vector<std::uint32_t> entity_version_;
+	std::vector<component_mask_t> entity_component_mask_;
+	std::vector<bool> alive_;
+	std::vector<std::uint32_t> free_list_;
+	std::vector<name_table::name_id> entity_name_ids_;
+	// the table only grows until dispose, which replaces it
+	std::shared_ptr<name_table> names_;
+	std::vector<family_data> families_;
+};
+}
@@ -3,6 +3,8 @@
 #include "core/serialization/binary_archive.h"
 #include "core/serialization/types/vector.hpp"
 
+#include <algorithm>
+
 namespace runtime
 {
 std::map<std::uint64_t, runtime::entity>& get_serialization_map()
@@ -12,6 +14,41 @@ std::map<std::uint64_t, runtime::entity>& get_serialization_map()
 	return serialization_map;
 }
 
+namespace
+{
+/// innermost entity_load_scope of the thread
+thread_local entity_load_scope* current_load_scope = nullptr;
+}
+
+entity_load_scope::entity_load_scope(entity_component_system& ecs)
+	: _ecs(ecs)
+	, _outer(current_load_scope)
+{
+	current_load_scope = this;
+}
+
+entity_load_scope::~entity_load_scope()
+{
+	current_load_scope = _outer;
+
+	// Component hooks may have destroyed some of them meanwhile.
+	_created.erase(std::remove_if(std::begin(_created), std::end(_created),
+								  [](const entity& e) { return !e.valid(); }),
+				   std::end(_created));
+	if(!_created.empty())
+		on_entities_created(_created);
+}
+
+entity entity_load_scope::create(entity_component_system& ecs)
+{
+	auto scope = current_load_scope;
+	if(scope == nullptr || &scope->_ecs != &ecs)
+		return ecs.create();
+
+	scope->_created.emplace_back(ecs.create_unannounced());
+	return scope->_created.back();
+}
+
 SAVE(entity)
 {
 	// TODO check for validity
@@ -54,7 +91,7 @@ LOAD(entity)
 		else
 		{
 			auto& ecs = core::get_subsystem<entity_component_system>();
-			obj = ecs.create();
+			obj = entity_load_scope::create(ecs);
 			serialization_map[id] = obj;
 
 			try_load(ar, cereal::make_nvp("name", name));
@@ -8,6 +8,41 @@ namespace runtime
 
 std::map<std::uint64_t, runtime::entity>& get_serialization_map();
 
+//-----------------------------------------------------------------------------
+//  Name : entity_load_scope (Class)
+/// <summary>
+/// Entities loaded while the scope lives are announced with a single
+/// on_entities_created when it ends, instead of one on_entity_created each.
+/// Scopes nest, the innermost one of the calling thread collects.
+/// </summary>
+//-----------------------------------------------------------------------------
+class entity_load_scope
+{
+public:
+	explicit entity_load_scope(entity_component_system& ecs);
+	~entity_load_scope();
+
+	entity_load_scope(const entity_load_scope&) = delete;
+	entity_load_scope& operator=(const entity_load_scope&) = delete;
+
+	//-----------------------------------------------------------------------------
+	//  Name : create ()
+	/// <summary>
+	/// Creates an entity to load into. It is announced when the innermost
+	/// scope of the thread ends, right away when there is none.
+	/// </summary>
+	//-----------------------------------------------------------------------------
+	static entity create(entity_component_system& ecs);
+
+private:
+	/// the loaded ecs
+	entity_component_system& _ecs;
+	/// entities created and not announced yet
+	std::vector<entity> _created;
+	/// scope this one is nested in
+	entity_load_scope* _outer = nullptr;
+};
+
 SAVE_EXTERN(entity);
 LOAD_EXTERN(entity);
 }
@@ -1,7 +1,9 @@
 #include "app.h"
 #include "../assets/asset_manager.h"
 #include "../ecs/ecs.h"
+#include "../ecs/system_scheduler.h"
 #include "../ecs/systems/bone_system.h"
+#include "../ecs/systems/bounds_system.h"
 #include "../ecs/systems/camera_system.h"
 #include "../ecs/systems/deferred_rendering.h"
 #include "../ecs/systems/scene_graph.h"
@@ -47,8 +49,10 @@ void app::start(cmd_line::options_parser& parser)
 	core::add_subsystem<input>();
 	core::add_subsystem<asset_manager>();
 	core::add_subsystem<entity_component_system>();
+	core::add_subsystem<system_scheduler>();
 	core::add_subsystem<scene_graph>();
 	core::add_subsystem<bone_system>();
+	core::add_subsystem<bounds_system>();
 	core::add_subsystem<camera_system>();
 	core::add_subsystem<deferred_rendering>();
 }
@@ -101,7 +105,11 @@ void app::run_one_frame()
 	auto& renderer = core::get_subsystem<runtime::renderer>();
 
 	sim.run_one_frame();
-	tasks.run_on_owner_thread();
+
+	// Time given each frame to tasks that must run on the main thread,
+	// like uploading loaded resources to the gpu.
+	using namespace std::literals;
+	tasks.run_on_owner_thread(4ms);
 
 	auto dt = sim.get_delta_time();
 